@@ -0,0 +1,37 @@
+#version 330 core
+
+//the static batch variant of default.vert: the vertices were moved to the world space when the batch was built
+//so there is no model matrix, and the tint of the object each vertex came from is read per vertex
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 tex_coord;
+layout(location = 3) in vec3 normals;
+layout(location = 8) in vec4 vertexTint;
+
+out Varyings {
+    vec4 color;
+    vec2 tex_coord;
+    vec3 normal;
+    vec3 position;
+} vs_out;
+
+//the depth pre-pass draws with these vertex shaders and the color pass tests its depth for equality, so the position must be computed the same way every time
+invariant gl_Position;
+
+//camera data shared by every draw of the frame (it matches our::FrameBlock)
+layout(std140) uniform Frame {
+    mat4 Camera;
+    mat4 SkyCamera;
+    vec3 cameraPosition;
+    vec3 areaLight;
+};
+
+void main(){
+    vs_out.position = position;
+    gl_Position = Camera * vec4(position, 1.0);
+
+    //the renderer sets material.tint to white for static batches, so the tint of each object is applied here
+    vs_out.color = color * vertexTint;
+    vs_out.tex_coord = tex_coord;
+    vs_out.normal = normals;
+}
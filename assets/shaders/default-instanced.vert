@@ -0,0 +1,48 @@
+#version 330 core
+
+//the instanced variant of default.vert: the object index comes from the instance buffer instead of a uniform
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 tex_coord;
+layout(location = 3) in vec3 normals;
+layout(location = 4) in uint instanceObject;
+
+out Varyings {
+    vec4 color;
+    vec2 tex_coord;
+    vec3 normal;
+    vec3 position;
+} vs_out;
+
+//the depth pre-pass draws with these vertex shaders and the color pass tests its depth for equality, so the position must be computed the same way every time
+invariant gl_Position;
+
+//camera data shared by every draw of the frame (it matches our::FrameBlock)
+layout(std140) uniform Frame {
+    mat4 Camera;
+    mat4 SkyCamera;
+    vec3 cameraPosition;
+    vec3 areaLight;
+};
+
+//the data of every object drawn this frame, OBJECT_DATA_TEXELS texels per object (it matches our::OBJECT_DATA_TEXELS):
+//the columns of the model matrix, the columns of the normal matrix (computed once per object on the CPU) and the tint
+#define OBJECT_DATA_TEXELS 8
+uniform samplerBuffer objectData;
+
+void main(){
+    int base = int(instanceObject) * OBJECT_DATA_TEXELS;
+    mat4 transform = mat4(texelFetch(objectData, base), texelFetch(objectData, base + 1),
+                          texelFetch(objectData, base + 2), texelFetch(objectData, base + 3));
+    mat3 normalMatrix = mat3(texelFetch(objectData, base + 4).xyz, texelFetch(objectData, base + 5).xyz, texelFetch(objectData, base + 6).xyz);
+
+    gl_Position = transform * vec4(position, 1.0);
+    vs_out.position = gl_Position.xyz;
+
+    gl_Position = Camera * gl_Position;
+
+    //the renderer sets material.tint to white for lit draws, so the tint of each instance is applied here
+    vs_out.color = color * texelFetch(objectData, base + 7);
+    vs_out.tex_coord = tex_coord;
+    vs_out.normal = normalMatrix * normals;
+}
@@ -24,42 +24,40 @@ uniform struct Material {
 } material;
 
 
-//lighting
-uniform int spotLightsCount = 0;
-uniform struct SpotLight {
-    vec3 position;
-    float intensity;
-    vec3 ambientColor;
-    vec3 diffuseColor;
-    vec3 specularColor;
-    vec3 attenuation;
-} spotLights [MAX_LIGHTS];
-
-uniform int directionalLightCount = 0;
-uniform struct DirectionalLight {
-    vec3 direction;
-    float intensity;
-    vec3 ambientColor;
-    vec3 diffuseColor;
-    vec3 specularColor;
-} directionalLights [MAX_LIGHTS];
-
-uniform int coneLightsCount = 0;
-uniform struct ConeLight {
+//lighting (the global lights of the frame are filled once in a uniform buffer, the structs match our::LightsBlock)
+struct DirectionalLight {
     vec3 direction;
     float intensity;
-    vec3 position;
     vec3 ambientColor;
     vec3 diffuseColor;
     vec3 specularColor;
-    vec2 range;
-    int smoothing; // 0 = disable , 1 = max , 2 = smooth step from low to high
-    vec3 attenuation;
-} coneLights [MAX_LIGHTS];
+};
+
+layout(std140) uniform Lights {
+    int directionalLightCount;
+    int clusteredLightCount;
+    vec3 clusteredAmbient;  // the ambient colors of all the spot and cone lights
+    vec3 cameraForward;
+    vec4 clusterScale;      // xy: gl_FragCoord to tile, zw: log of the view depth to slice
+    ivec4 clusterCount;
+    DirectionalLight directionalLights [MAX_LIGHTS];
+};
+
+//the spot and cone lights are binned into clusters by our::LightClusters, each fragment only reads the lights of its cluster
+#define CLUSTERED_LIGHT_TEXELS 5
+uniform samplerBuffer clusterLights;   // CLUSTERED_LIGHT_TEXELS texels per light
+uniform usamplerBuffer clusterGrid;    // the offset and count of the lights of every cluster in clusterIndices
+uniform usamplerBuffer clusterIndices; // the lights of every cluster
+
+//camera data shared by every draw of the frame (it matches our::FrameBlock)
+layout(std140) uniform Frame {
+    mat4 Camera;
+    mat4 SkyCamera;
+    vec3 cameraPosition;
+    vec3 areaLight;
+};
 
 uniform int isSkybox = 0; //sky boxes are not affected by normals or spot lights when renderered
-uniform vec3 areaLight = vec3(1,1,1);
-uniform vec3 cameraPosition = vec3(15,15,15);
 
 void main(){
     //calculate the base color
@@ -98,55 +96,56 @@ void main(){
         specularLight += sD * sF * directionalLights[i].specularColor * directionalLights[i].intensity;
     }
 
-    //calculate the total spot light
-    vec3 spotLight = vec3(0,0,0);
-    for (int i = 0;i < spotLightsCount;i++){
-        vec3 diff = fs_in.position - spotLights[i].position;
+    //find the cluster of the fragment (the same way our::LightClusters bins the lights)
+    float viewDepth = dot(fs_in.position - cameraPosition, cameraForward);
+    ivec3 cell = ivec3(
+        int(gl_FragCoord.x * clusterScale.x),
+        int(gl_FragCoord.y * clusterScale.y),
+        int(floor(log(max(viewDepth, 1e-6)) * clusterScale.z + clusterScale.w))
+    );
+    cell = clamp(cell, ivec3(0), clusterCount.xyz - 1);
+    uvec2 cluster = texelFetch(clusterGrid, cell.x + clusterCount.x * (cell.y + clusterCount.y * cell.z)).xy;
+
+    //calculate the total spot and cone light (a spot light is a cone light with a negative smoothing and no cone)
+    ambientLight += clusteredAmbient;
+    vec3 pointLight = vec3(0,0,0);
+    for (uint i = 0u;i < cluster.y;i++){
+        int texel = int(texelFetch(clusterIndices, int(cluster.x + i)).x) * CLUSTERED_LIGHT_TEXELS;
+        vec4 positionIntensity = texelFetch(clusterLights, texel);
+        vec4 diffuseSmoothing  = texelFetch(clusterLights, texel + 1);
+        vec4 specularRangeMax  = texelFetch(clusterLights, texel + 2);
+        vec3 attenuation       = texelFetch(clusterLights, texel + 3).xyz;
+
+        vec3 diff = fs_in.position - positionIntensity.xyz;
         vec3 ndiff = normalize(diff);
+        float div = 1.0;
+        int smoothing = int(diffuseSmoothing.w);
+        if (smoothing >= 0){
+            vec4 directionRangeMin = texelFetch(clusterLights, texel + 4);
+            div = max(0 , dot(ndiff , directionRangeMin.xyz));
+            if (div < directionRangeMin.w || div > specularRangeMax.w) continue;
+            div = smoothing == 1 ? 1 : div;
+            if (smoothing == 2){
+                div = smoothstep(directionRangeMin.w , specularRangeMax.w , div);
+            }
+        }
+
         float len2 = dot(diff, diff);
         vec3 decay = vec3(len2 , sqrt(len2) , 1.0);
-        float divider = dot(spotLights[i].attenuation, decay);
+        float divider = dot(attenuation, decay);
+        float intensity = positionIntensity.w / divider * div;
 
-        ambientLight += spotLights[i].ambientColor;
-        spotLight += max(dot(-fNormal, ndiff), 0) * spotLights[i].diffuseColor * spotLights[i].intensity / divider;
+        pointLight += max(dot(-fNormal, ndiff), 0) * diffuseSmoothing.rgb * intensity;
 
         vec3 ref = reflect(ndiff , fNormal);
         float sF = max(dot(ref , point2Cam) , 0.0);
         float sD = max(dot(-fNormal, ndiff), 0);
         sF = pow(sF , material.specularIntensity);
-        specularLight += sD * sF * spotLights[i].specularColor * spotLights[i].intensity / divider;
-    }
-
-    //calculate the total cone light
-    vec3 coneLight = vec3(0,0,0);
-    for (int i = 0;i < coneLightsCount;i++){
-        vec3 diff = fs_in.position - coneLights[i].position;
-        vec3 ndiff = normalize(diff);
-        float div = max(0 , dot(ndiff , normalize(coneLights[i].direction)));
-
-        float len2 = dot(diff, diff);
-        vec3 decay = vec3(len2 , sqrt(len2) , 1.0);
-        float divider = dot(coneLights[i].attenuation, decay);
-
-        ambientLight += coneLights[i].ambientColor;
-
-        if (div >= coneLights[i].range.x && div <= coneLights[i].range.y){
-            div = coneLights[i].smoothing == 1 ? 1 : div;
-            if (coneLights[i].smoothing == 2){
-                div = smoothstep(coneLights[i].range.x , coneLights[i].range.y , div);
-            }
-
-            coneLight += max( dot(-fNormal, ndiff) , 0) * coneLights[i].diffuseColor * coneLights[i].intensity / divider * div;
-            vec3 ref = reflect(ndiff , fNormal);
-            float sF = max(dot(ref , point2Cam) , 0.0);
-            float sD = max(dot(-fNormal, ndiff), 0);
-            sF = pow(sF , material.specularIntensity);
-            specularLight += sD * sF * coneLights[i].specularColor * coneLights[i].intensity / divider * div;
-        }
+        specularLight += sD * sF * specularRangeMax.rgb * intensity;
     }
 
     vec3 totalLight = (specularLight * material.specularReflectivity) +
-                    ((directionalLight + spotLight + coneLight) * material.diffuseReflectivity) +
+                    ((directionalLight + pointLight) * material.diffuseReflectivity) +
                     ((areaLight + ambientLight) * material.ambientReflectivity);
     frag_color   = baseColor * vec4(totalLight , 1.0);
     bright_color = vec4(baseColor.rgb * material.emission , baseColor.a);
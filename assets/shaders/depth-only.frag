@@ -0,0 +1,6 @@
+#version 330 core
+
+// The fragment shader of the depth pre-pass. The pre-pass only writes the depth (its color mask is off)
+// and it is paired with the vertex shaders of the lit objects, so there is nothing to compute here
+void main(){
+}
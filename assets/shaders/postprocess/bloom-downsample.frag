@@ -0,0 +1,21 @@
+#version 330
+
+// The previous level of the bloom chain (or the bright color of the scene for the first level)
+uniform sampler2D tex_0;
+
+// Read "assets/shaders/fullscreen.vert" to know what "tex_coord" holds;
+in vec2 tex_coord;
+out vec4 frag_color;
+
+// The downsample filter of the dual filter blur: the output is half the size of the input, so each output pixel covers 2x2 input texels.
+// The center sample and the 4 samples at the corners of the pixel are bilinear, so 5 taps read a 4x4 area of the input
+// weighted towards its center.
+void main(){
+    vec2 half_texel = 0.5 / vec2(textureSize(tex_0, 0));
+    vec4 sum = texture(tex_0, tex_coord) * 4.0;
+    sum += texture(tex_0, tex_coord - half_texel);
+    sum += texture(tex_0, tex_coord + half_texel);
+    sum += texture(tex_0, tex_coord + vec2(half_texel.x, -half_texel.y));
+    sum += texture(tex_0, tex_coord - vec2(half_texel.x, -half_texel.y));
+    frag_color = sum / 8.0;
+}
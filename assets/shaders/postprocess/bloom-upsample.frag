@@ -0,0 +1,24 @@
+#version 330
+
+// The smaller level of the bloom chain
+uniform sampler2D tex_0;
+
+// Read "assets/shaders/fullscreen.vert" to know what "tex_coord" holds;
+in vec2 tex_coord;
+out vec4 frag_color;
+
+// The upsample filter of the dual filter blur: the output is twice the size of the input.
+// It reads 4 bilinear samples on the edges of a one texel radius (weighted by 1) and 4 on its diagonals (weighted by 2),
+// so the blur keeps growing while going back up the chain without any extra pass.
+void main(){
+    vec2 half_texel = 0.5 / vec2(textureSize(tex_0, 0));
+    vec4 sum = texture(tex_0, tex_coord + vec2(-half_texel.x * 2.0, 0.0));
+    sum += texture(tex_0, tex_coord + vec2(half_texel.x * 2.0, 0.0));
+    sum += texture(tex_0, tex_coord + vec2(0.0, half_texel.y * 2.0));
+    sum += texture(tex_0, tex_coord + vec2(0.0, -half_texel.y * 2.0));
+    sum += texture(tex_0, tex_coord + vec2(-half_texel.x, half_texel.y)) * 2.0;
+    sum += texture(tex_0, tex_coord + vec2(half_texel.x, half_texel.y)) * 2.0;
+    sum += texture(tex_0, tex_coord + vec2(half_texel.x, -half_texel.y)) * 2.0;
+    sum += texture(tex_0, tex_coord + vec2(-half_texel.x, -half_texel.y)) * 2.0;
+    frag_color = sum / 12.0;
+}
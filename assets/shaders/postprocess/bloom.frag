@@ -8,11 +8,12 @@ out vec4 frag_color;
 
 uniform float exposure; //not used for now ..
 uniform float gamma = 2.2;
+uniform float intensity = 1.0; // The strength of the bloom added to the scene
 
 void main(){
     vec3 hdrColor = texture(tex_0, tex_coord).rgb;
     vec3 bloomColor = texture(tex_1, tex_coord).rgb;
 
-    hdrColor += bloomColor; // additive blending
+    hdrColor += bloomColor * intensity; // additive blending
     frag_color = vec4(hdrColor, 1.0);
 }
\ No newline at end of file
@@ -7,21 +7,34 @@ uniform sampler2D tex;
 in vec2 tex_coord;
 out vec4 frag_color;
 
-// How far (in the texture space) is the distance (on the x-axis) between
-// the pixels from which the red/green (or green/blue) channels are sampled
-#define STRENGTH 0.005
-
 // Chromatic aberration mimics some old cameras where the lens disperses light
 // differently based on its wavelength. In this shader, we will implement a
 // cheap version of that effect 
 
-void main(){
-    //TODO: Modify this shader to apply chromatic abberation
-    // To apply this effect, we only read the green channel from the correct pixel (as defined by tex_coord)
+// Returns the color of the input at the given texture coordinate
+vec4 source(vec2 uv){
+    return texture(tex, uv);
+}
+
+// The code between the fusable markers is copied by the post-process plan when this effect is fused with its neighbours.
+// When fused, "source" runs the previous effects at the shifted coordinates, so the result is the same as running the passes one by one.
+//#fusable begin
+vec4 effect(vec2 uv){
+    // How far (in the texture space) is the distance (on the x-axis) between
+    // the pixels from which the red/green (or green/blue) channels are sampled
+    const float STRENGTH = 0.005;
+
+    // We only read the green channel from the correct pixel (as defined by uv)
     // To get the red channel, we move by amount STRENGTH to the left then sample another pixel from which we take the red channel
     // To get the blue channel, we move by amount STRENGTH to the right then sample another pixel from which we take the blue channel
-    frag_color.ga = texture(tex, tex_coord).ga;
-    frag_color.r  = texture(tex, tex_coord + vec2(-STRENGTH,0)).r;
-    frag_color.b  = texture(tex, tex_coord + vec2(STRENGTH,0)).b;
+    vec4 color;
+    color.ga = source(uv).ga;
+    color.r  = source(uv + vec2(-STRENGTH,0)).r;
+    color.b  = source(uv + vec2(STRENGTH,0)).b;
+    return color;
+}
+//#fusable end
 
-}
\ No newline at end of file
+void main(){
+    frag_color = effect(tex_coord);
+}
@@ -7,10 +7,23 @@ uniform sampler2D tex;
 in vec2 tex_coord;
 out vec4 frag_color;
 
-void main(){
-    // To apply the grayscale effect, we compute the average of the red/blue/green channels
+// Returns the color of the input at the given texture coordinate
+vec4 source(vec2 uv){
+    return texture(tex, uv);
+}
+
+// The code between the fusable markers is copied by the post-process plan when this effect is fused with its neighbours
+// (see "PostprocessPlan"), "effect" and "source" are renamed so the effect reads the output of the one before it.
+//#fusable begin
+vec4 effect(vec2 uv){
+    // To turn the color to grayscale, we compute the average of the red/blue/green channels
     // and set that average value to all the channels
-    frag_color = texture(tex, tex_coord);
-    float gray = dot(frag_color.rgb, vec3(1.0/3.0, 1.0/3.0, 1.0/3.0));
-    frag_color.rgb = vec3(gray);
-}
\ No newline at end of file
+    vec4 color = source(uv);
+    float gray = dot(color.rgb, vec3(1.0/3.0, 1.0/3.0, 1.0/3.0));
+    return vec4(vec3(gray), color.a);
+}
+//#fusable end
+
+void main(){
+    frag_color = effect(tex_coord);
+}
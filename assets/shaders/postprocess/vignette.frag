@@ -11,13 +11,24 @@ out vec4 frag_color;
 // Vignette is a postprocessing effect that darkens the corners of the screen
 // to grab the attention of the viewer towards the center of the screen
 
-void main(){
-    //TODO: Modify this shader to apply vignette
+// Returns the color of the input at the given texture coordinate
+vec4 source(vec2 uv){
+    return texture(tex, uv);
+}
+
+// The code between the fusable markers is copied by the post-process plan when this effect is fused with its neighbours
+//#fusable begin
+vec4 effect(vec2 uv){
     // To apply vignette, divide the scene color
     // by 1 + the squared length of the 2D pixel location the NDC space
-    // Hint: remember that the NDC space ranges from -1 to 1
-    // while the texture coordinate space ranges from 0 to 1
-    // We have the pixel's texture coordinate, how can we compute its location in the NDC space?
-    frag_color = texture(tex, tex_coord);
-    frag_color.rgb = frag_color.rgb / (1.0 + dot(tex_coord.xy * 2 - 1, tex_coord.xy * 2 - 1));
-}
\ No newline at end of file
+    // (the NDC space ranges from -1 to 1 while the texture coordinate space ranges from 0 to 1)
+    vec4 color = source(uv);
+    vec2 ndc = uv * 2 - 1;
+    color.rgb = color.rgb / (1.0 + dot(ndc, ndc));
+    return color;
+}
+//#fusable end
+
+void main(){
+    frag_color = effect(tex_coord);
+}
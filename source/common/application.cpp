@@ -24,6 +24,7 @@
 #endif
 
 #include "texture/screenshot.hpp"
+#include "gl-state-cache.hpp"
 #include "../globals.h"
 
 std::string default_screenshot_filepath() {
@@ -295,6 +296,8 @@ int our::Application::run(int run_for_frames) {
         glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
 #endif
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); // Render the ImGui to the framebuffer
+        // ImGui changes the OpenGL state without the state cache, so the cache can't trust what it remembers anymore
+        our::GLStateCache::getInstance().invalidate();
 #if defined(ENABLE_OPENGL_DEBUG_MESSAGES)
         // Re-enable the debug messages
         glEnable(GL_DEBUG_OUTPUT);
@@ -14,7 +14,11 @@ namespace our {
         switchSpeed  = data.value("switchSpeed" , Distance);
         Divisions    = data.value("Divisions" , Distance);
         speed        = data.value("speed" , Distance);
-        follow       = data.value("follow" , follow);
+        if (data.contains("follow")){
+            follow.clear();
+            for (const std::string& name : data["follow"].get<std::vector<std::string>>())
+                follow.push_back(internName(name));
+        }
         inputEnabled = data.value("inputEnabled" , inputEnabled);
         BaseAngle    = data.value("BaseAngle" , BaseAngle);
         BasePosition = data.value("BasePosition" , BasePosition);
@@ -40,24 +44,24 @@ namespace our {
             _currentPos++;
             _switchDirection = 1;
             _switchProgress = 1;
-            Events::onPaimonCameraChange(getOwner()->name);
+            Events::onPaimonCameraChange(getOwner()->getNameId());
         }
 
         if (action == "move_right"){
             _currentPos--;
             _switchDirection = -1;
             _switchProgress = 1;
-            Events::onPaimonCameraChange(getOwner()->name);
+            Events::onPaimonCameraChange(getOwner()->getNameId());
         }
 
         if (action == "follow"){
-            follow.push_back(data.value("target" , ""));
+            follow.push_back(internName(data.value("target" , "")));
         }
 
 
 
         if (action == "unfollow"){
-            auto it = std::find(follow.begin(), follow.end(), data.value("target" , ""));
+            auto it = std::find(follow.begin(), follow.end(), internName(data.value("target" , "")));
             if (it != follow.end()){
                 follow.erase(it);
             }
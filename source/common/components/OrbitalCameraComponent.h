@@ -6,6 +6,7 @@
 #define GFX_LAB_ORBITALCAMERACOMPONENT_H
 
 #include "ecs/component.hpp"
+#include "ecs/name-id.hpp"
 #include "glm/vec3.hpp"
 #include "components/actions/action-receiver.h"
 
@@ -28,7 +29,7 @@ namespace our {
 
         glm::vec3 BaseAngle = glm::vec3(-45 , -45 , 0);
         glm::vec3 BasePosition = glm::vec3(0 , 0 , 0);
-        std::vector<std::string> follow;
+        std::vector<NameId> follow; // The interned names of the entities the camera follows
 
         static std::string getID() { return "Orbital Camera Component"; }
         void deserialize(const nlohmann::json& data) override;
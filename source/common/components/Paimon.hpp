@@ -6,6 +6,7 @@
 #define GFX_LAB_PAIMON_HPP
 
 #include "Ground.hpp"
+#include "ecs/component-ref.hpp"
 #include "systems/common.h"
 
 namespace our {
@@ -14,7 +15,7 @@ namespace our {
     public:
         float speed = 8;
         float rotateSpeed = 800;
-        Ground* ground = nullptr;
+        ComponentRef<Ground> ground; // The block paimon is standing on (reads as nullptr if the block is removed)
         static std::string getID() { return "Paimon"; }
         void deserialize(const nlohmann::json& data) override;
     };
@@ -13,6 +13,7 @@ void our::EventController::deserialize(const nlohmann::json &data) {
         EventTrigger trigger;
         trigger.type             = static_cast<our::EventType>(k.value("trigger", 0));
         trigger.associatedObject = k.value("object", "");
+        trigger.associatedObjectId = internName(trigger.associatedObject);
         trigger.maxTrigger       = k.value("maxTrigger" , trigger.maxTrigger);
 
         std::vector<EventAction> actions;
@@ -20,6 +21,7 @@ void our::EventController::deserialize(const nlohmann::json &data) {
         for (auto a : act){
             EventAction aa;
             aa.target          = a.value("target" , "");
+            aa.targetId        = internName(aa.target);
             aa.receiverID      = a.value("receiverID" , "");
             aa.triggerCount    = a.value("triggerCount" , 1);
             aa.triggerDelay    = a.value("triggerDelay" , 0.f);
@@ -34,5 +36,5 @@ void our::EventController::deserialize(const nlohmann::json &data) {
 
 
 bool our::EventTrigger::operator==(const our::EventTrigger &other) const {
-    return (other.associatedObject == this->associatedObject && other.type == this->type);
+    return (other.associatedObjectId == this->associatedObjectId && other.type == this->type);
 }
@@ -7,6 +7,7 @@
 
 
 #include "ecs/component.hpp"
+#include "ecs/name-id.hpp"
 #include "glm/vec3.hpp"
 #include "components/actions/action-receiver.h"
 
@@ -24,6 +25,7 @@ namespace our {
 
         EventType type;
         std::string associatedObject;
+        NameId associatedObjectId = EMPTY_NAME; // the interned id of associatedObject
         int maxTrigger = -1;
 
         bool operator==(const EventTrigger& other) const;
@@ -31,6 +33,7 @@ namespace our {
 
     struct EventAction{
         std::string target;       // the target that this event will be delivered to
+        NameId targetId;          // the interned id of target
         std::string receiverID;   // the target component that this event will be delivered to
         float triggerInterval;    // the delay of the consecutive triggers
         int triggerCount;         // the number of times this event is triggered
@@ -48,7 +51,7 @@ namespace std {
     template <>
     struct hash<our::EventTrigger> {
         size_t operator()(const our::EventTrigger& obj) const {
-            return std::hash<std::string>()(obj.associatedObject);
+            return std::hash<our::NameId>()(obj.associatedObjectId);
         }
     };
 }
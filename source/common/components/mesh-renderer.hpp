@@ -13,6 +13,7 @@ namespace our {
         Mesh* mesh; // The mesh that should be drawn
         int shapeID = -1;
         Material* material; // The material used to draw the mesh
+        bool staticBatched = false; // True while the mesh is drawn as a part of a static batch (see "StaticBatcher"), so the renderer skips it
 
         // The ID of this component type is "Mesh Renderer"
         static std::string getID() { return "Mesh Renderer"; }
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace our {
+
+    // A chunk allocator hands out uninitialized slots big enough to hold a T.
+    // The slots are allocated in fixed size chunks, so objects allocated together are close to each other in memory,
+    // they never move once allocated and creating or destroying an object never calls the global allocator
+    // (except when a new chunk is needed).
+    // The allocator only manages memory: constructing and destructing the objects is the job of its user.
+    template<typename T, size_t ChunkSize = 64>
+    class ChunkAllocator {
+        struct Chunk {
+            alignas(T) unsigned char storage[sizeof(T) * ChunkSize];
+        };
+
+        std::vector<std::unique_ptr<Chunk>> chunks; // The memory of the slots
+        std::vector<T*> freeSlots;                  // The slots inside the chunks that are not used
+
+        // Pushes the slots of the chunk to the free list in reverse so that they get used in memory order
+        void pushFreeSlots(Chunk& chunk) {
+            auto* slots = reinterpret_cast<T*>(chunk.storage);
+            for (size_t i = ChunkSize; i > 0; i--) {
+                freeSlots.push_back(slots + (i - 1));
+            }
+        }
+
+    public:
+        ChunkAllocator() = default;
+
+        // Returns an unused slot (the object still needs to be constructed in it using placement new)
+        T* allocate() {
+            if (freeSlots.empty()) {
+                chunks.push_back(std::make_unique<Chunk>());
+                pushFreeSlots(*chunks.back());
+            }
+            T* slot = freeSlots.back();
+            freeSlots.pop_back();
+            return slot;
+        }
+
+        // Gives the slot back to the allocator (the object in it should be already destructed)
+        void deallocate(T* slot) {
+            freeSlots.push_back(slot);
+        }
+
+        // Marks every slot as unused in one go without giving the chunks back to the system,
+        // so the next objects (e.g. the entities of the next level) reuse the same memory.
+        // The objects in the slots should be already destructed.
+        void reset() {
+            freeSlots.clear();
+            for (size_t i = chunks.size(); i > 0; i--) {
+                pushFreeSlots(*chunks[i - 1]);
+            }
+        }
+
+        ChunkAllocator(const ChunkAllocator&) = delete;
+        ChunkAllocator& operator=(const ChunkAllocator&) = delete;
+    };
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "world.hpp"
+
+namespace our {
+
+    // A component reference is a pointer to a component that knows when its owner has been removed.
+    // It keeps the id of the owner entity next to the pointer, and every access validates the id against the world,
+    // so once the owner is marked for removal (or deleted) the reference reads as nullptr instead of dangling.
+    // NOTE: the reference follows the lifetime of the owner entity, so a component should not be deleted on its own
+    // while it is still referenced.
+    template<typename T>
+    class ComponentRef {
+        T* component = nullptr; // The referenced component
+        World* world = nullptr; // The world of the owner entity
+        EntityId owner;         // The id of the owner entity when the reference was taken
+
+    public:
+        ComponentRef() = default;
+        ComponentRef(T* component) : component(component) {
+            if (component != nullptr){
+                Entity* entity = component->getOwner();
+                world = entity->getWorld();
+                owner = entity->getId();
+            }
+        }
+
+        // Returns the component or nullptr if the reference is empty or the owner entity has been removed
+        T* get() const {
+            if (component == nullptr || world->resolve(owner) == nullptr) return nullptr;
+            return component;
+        }
+
+        T* operator->() const { return get(); }
+        operator T*() const { return get(); }
+    };
+
+}
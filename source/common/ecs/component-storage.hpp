@@ -0,0 +1,192 @@
+#pragma once
+
+#include "component.hpp"
+#include "chunk-allocator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace our {
+
+    // Every component type gets a small dense integer the first time it is used.
+    // This integer is used to index the per-type pools and to identify a component type without RTTI.
+    using ComponentTypeId = std::uint32_t;
+
+    namespace detail {
+        inline std::atomic<ComponentTypeId> nextComponentTypeId{0};
+    }
+
+    template<typename T>
+    ComponentTypeId getComponentTypeId() {
+        static const ComponentTypeId id = detail::nextComponentTypeId++;
+        return id;
+    }
+
+    // A set of component types stored as one bit per component type id
+    constexpr size_t MAX_COMPONENT_TYPES = 64;
+    using ComponentMask = std::bitset<MAX_COMPONENT_TYPES>;
+
+    // Returns a mask that contains all the given component types
+    template<typename... T>
+    ComponentMask makeComponentMask() {
+        ComponentMask mask;
+        (mask.set(getComponentTypeId<T>()), ...);
+        assert(mask.count() == sizeof...(T) && "Too many component types for a ComponentMask");
+        return mask;
+    }
+
+    // Returns the component as a "T*" if it is a T, otherwise returns nullptr.
+    // For concrete component types, this is a single integer comparison against the stored type id.
+    // Abstract types (e.g. ActionReceiver) can only be matched through their derived types, so they fall back to dynamic_cast.
+    // NOTE: this means a concrete component type should not be queried through another concrete component type it inherits from.
+    template<typename T>
+    T* componentCast(Component* component) {
+        if constexpr (std::is_abstract<T>::value) {
+            return dynamic_cast<T*>(component);
+        } else {
+            return component->getTypeId() == getComponentTypeId<T>() ? static_cast<T*>(component) : nullptr;
+        }
+    }
+
+    // A component listener is told whenever a component of type T is created or destroyed (see "World::addComponentListener").
+    // It lets a system keep its own data about the components (e.g. the render proxies) without scanning the pool every frame.
+    template<typename T>
+    class ComponentListener {
+    public:
+        // Called right after the component is created. Its owner is set and it is deserialized after this call,
+        // so the listener should only remember it and read it later
+        virtual void onComponentCreated(T* component) = 0;
+        // Called right before the component is destructed (also for every component when the pool is cleared)
+        virtual void onComponentDestroyed(T* component) = 0;
+        virtual ~ComponentListener() = default;
+    };
+
+    class ComponentPoolBase {
+    public:
+        // Destructs the given component and gives its slot back to the pool
+        virtual void destroy(Component* component) = 0;
+        // Destructs all the components in the pool but keeps its memory for the next components
+        virtual void clear() = 0;
+        virtual ~ComponentPoolBase() = default;
+    };
+
+    // A pool that stores all the components of type T in fixed size chunks.
+    // Components never move once created (so pointers to them stay valid till they are destroyed),
+    // and all the live components are also kept in a packed array so that iterating over a type is a linear scan.
+    template<typename T>
+    class ComponentPool : public ComponentPoolBase {
+        ChunkAllocator<T> allocator; // The memory of the components
+        std::vector<T*> components;  // The live components packed together
+        std::vector<ComponentListener<T>*> listeners; // Told about every created and destroyed component
+
+    public:
+        ComponentPool() = default;
+
+        // Creates a new component in the pool and returns a pointer to it
+        T* create() {
+            T* component = new (allocator.allocate()) T();
+            component->storageIndex = (std::uint32_t) components.size();
+            components.push_back(component);
+            for (auto listener : listeners) listener->onComponentCreated(component);
+            return component;
+        }
+
+        void destroy(Component* component) override {
+            T* t = static_cast<T*>(component);
+            for (auto listener : listeners) listener->onComponentDestroyed(t);
+            // Swap the last component into the place of the removed one to keep the array packed
+            auto index = t->storageIndex;
+            components[index] = components.back();
+            components[index]->storageIndex = index;
+            components.pop_back();
+            t->~T();
+            allocator.deallocate(t);
+        }
+
+        void clear() override {
+            for (auto listener : listeners) {
+                for (auto component : components) listener->onComponentDestroyed(component);
+            }
+            // Trivially destructible components need no work at all, the others are destructed in one linear sweep
+            if constexpr (!std::is_trivially_destructible<T>::value) {
+                for (auto component : components) {
+                    component->~T();
+                }
+            }
+            components.clear();
+            allocator.reset();
+        }
+
+        // Returns all the live components of type T
+        const std::vector<T*>& getAll() const { return components; }
+
+        void addListener(ComponentListener<T>* listener) { listeners.push_back(listener); }
+        void removeListener(ComponentListener<T>* listener) {
+            listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+        }
+
+        ~ComponentPool() override {
+            clear();
+        }
+
+        ComponentPool(const ComponentPool&) = delete;
+        ComponentPool& operator=(const ComponentPool&) = delete;
+    };
+
+    // This class holds one pool for each component type
+    class ComponentStorage {
+        std::vector<std::unique_ptr<ComponentPoolBase>> pools; // Indexed by the component type id
+        std::mutex poolsMutex; // Guards the creation of the pools since systems may run in parallel
+    public:
+        ComponentStorage() = default;
+
+        // Returns the pool of type T (and creates it if it does not exist yet)
+        template<typename T>
+        ComponentPool<T>& getPool() {
+            static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
+            static_assert(!std::is_abstract<T>::value, "Only concrete component types have a pool");
+            auto id = getComponentTypeId<T>();
+            std::lock_guard<std::mutex> lock(poolsMutex);
+            if (id >= pools.size()) pools.resize(id + 1);
+            if (!pools[id]) pools[id] = std::make_unique<ComponentPool<T>>();
+            return *static_cast<ComponentPool<T>*>(pools[id].get());
+        }
+
+        // Creates a component of type T in its pool
+        template<typename T>
+        T* create() {
+            T* component = getPool<T>().create();
+            component->typeId = getComponentTypeId<T>();
+            return component;
+        }
+
+        // Destroys the component and gives its memory back to its pool
+        void destroy(Component* component) {
+            ComponentPoolBase* pool;
+            {
+                std::lock_guard<std::mutex> lock(poolsMutex);
+                pool = pools[component->getTypeId()].get();
+            }
+            pool->destroy(component);
+        }
+
+        // Destroys all the components of all the types. The pools keep their memory so they can be refilled without allocating
+        void clear() {
+            for (auto& pool : pools) {
+                if (pool) pool->clear();
+            }
+        }
+
+        ComponentStorage(const ComponentStorage&) = delete;
+        ComponentStorage& operator=(const ComponentStorage&) = delete;
+    };
+
+}
@@ -2,6 +2,7 @@
 
 #include <json/json.hpp>
 #include <string>
+#include <cstdint>
 
 namespace our {
 
@@ -11,6 +12,8 @@ namespace our {
     };
 
     class Entity; // A forward declaration of the Entity Class
+    class ComponentStorage; // A forward declaration of the ComponentStorage Class
+    template<typename T> class ComponentPool; // A forward declaration of the ComponentPool Class
 
     // A component is a data container that can be added to an entity.
     // The role of the entity in the world is defined by the components it holds.
@@ -18,7 +21,11 @@ namespace our {
     // Thus any renderer system should look for an entity holding a camera component in order to compute the camera related uniforms (e.g. VP matrix)
     class Component {
         Entity* owner; // A pointer to the entity that owns this component
+        std::uint32_t typeId = 0; // The id of the concrete type of this component (see "component-storage.hpp")
+        std::uint32_t storageIndex = 0; // The index of this component inside the pool of its type
         friend Entity; // The entity is a friend since it is the only one allowed to set itself as an owner of a certain component.
+        friend ComponentStorage; // The storage sets the type id when it creates the component
+        template<typename T> friend class ComponentPool; // The pool keeps track of where the component is stored
     public:
         // This static method returns a unique string that identifies each type of components
         // This ID will be used as the key to store a component into the entity's component map 
@@ -29,6 +36,8 @@ namespace our {
         virtual void deserialize(const nlohmann::json& data) = 0;
         // Returns the owner of this component
         Entity* getOwner() const { return owner; }
+        // Returns the id of the concrete type of this component
+        std::uint32_t getTypeId() const { return typeId; }
         // Define a virtual destructor
         virtual ~Component(){}
     };
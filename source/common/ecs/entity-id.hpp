@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace our {
+
+    // An entity id is a 64-bit handle to an entity: the index of the entity's slot in its world and the generation of that slot.
+    // Whenever an entity is removed, the generation of its slot is incremented, so the old ids of the entity stop resolving
+    // even after the slot is reused by a new entity. Use "World::resolve" to turn an id back to an entity pointer.
+    struct EntityId {
+        static constexpr std::uint32_t INVALID_INDEX = std::numeric_limits<std::uint32_t>::max();
+
+        std::uint32_t index = INVALID_INDEX; // The index of the slot of the entity in its world
+        std::uint32_t generation = 0;        // The generation of the slot when the entity was created
+
+        bool isValid() const { return index != INVALID_INDEX; }
+
+        bool operator==(const EntityId& other) const { return index == other.index && generation == other.generation; }
+        bool operator!=(const EntityId& other) const { return !(*this == other); }
+    };
+
+}
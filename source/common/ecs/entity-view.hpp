@@ -0,0 +1,65 @@
+#pragma once
+
+#include "component-storage.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+namespace our {
+
+    class Entity; // A forward declaration of the Entity Class
+    class World; // A forward declaration of the World Class
+
+    // An entity view is a cached list of the entities that hold all the components in its signature.
+    // Views are created by "World::view" and the world keeps them up to date whenever a component is added or deleted
+    // or an entity is marked for removal, so iterating over a view never scans the rest of the world.
+    class EntityView {
+        ComponentMask signature; // The component types an entity must have to be in this view
+        std::vector<Entity*> entities; // The entities that currently match the signature
+        std::unordered_map<Entity*, size_t> indices; // The index of each entity inside "entities"
+
+        friend World; // Only the world is allowed to modify the content of the view
+
+        explicit EntityView(ComponentMask signature) : signature(signature) {}
+
+        void insert(Entity* entity) {
+            if (indices.count(entity)) return;
+            indices[entity] = entities.size();
+            entities.push_back(entity);
+        }
+
+        void erase(Entity* entity) {
+            auto it = indices.find(entity);
+            if (it == indices.end()) return;
+            // Swap the last entity into the place of the removed one to keep the array packed
+            size_t index = it->second;
+            indices.erase(it);
+            Entity* last = entities.back();
+            entities.pop_back();
+            if (last != entity) {
+                entities[index] = last;
+                indices[last] = index;
+            }
+        }
+
+        void clear() {
+            entities.clear();
+            indices.clear();
+        }
+
+    public:
+        using const_iterator = std::vector<Entity*>::const_iterator;
+
+        const_iterator begin() const { return entities.begin(); }
+        const_iterator end() const { return entities.end(); }
+        size_t size() const { return entities.size(); }
+        bool empty() const { return entities.empty(); }
+        // Returns the first entity in the view or nullptr if the view is empty
+        Entity* front() const { return entities.empty() ? nullptr : entities.front(); }
+        const ComponentMask& getSignature() const { return signature; }
+
+        EntityView(const EntityView&) = delete;
+        EntityView& operator=(const EntityView&) = delete;
+    };
+
+}
@@ -1,4 +1,5 @@
 #include "entity.hpp"
+#include "world.hpp"
 #include "../deserialize-utils.hpp"
 #include "../components/component-deserializer.hpp"
 
@@ -6,15 +7,65 @@
 
 namespace our {
 
+    // Every time a world matrix is recomputed, it takes a new version from this counter
+    // so the children of the entity can know that they need to recompute their world matrices too
+    static std::atomic<std::uint64_t> nextTransformVersion{1};
+
+    // Holds the transform lock of an entity while in scope
+    // Systems that run in parallel may validate the cache of the same entity (e.g. a shared parent) at the same time
+    struct TransformLockGuard {
+        std::atomic_flag& flag;
+        explicit TransformLockGuard(std::atomic_flag& flag) : flag(flag) {
+            while (flag.test_and_set(std::memory_order_acquire));
+        }
+        ~TransformLockGuard() { flag.clear(std::memory_order_release); }
+    };
+
+    // This function returns the transformation matrix from the entity's local space to its parent's space
+    // The matrix is only recomputed if "localTransform" was changed since the last time it was computed
+    const glm::mat4& Entity::getLocalMatrix() const {
+        TransformLockGuard lock(transformLock);
+        return validateLocalMatrix();
+    }
+
+    // Rebuilds the local matrix if needed. The transform lock must be held by the caller
+    const glm::mat4& Entity::validateLocalMatrix() const {
+        if (isLocalMatrixDirty()){
+            cachedTransform = localTransform;
+            localMatrix = localTransform.toMat4();
+            // Invalidate the world matrix since it depends on the local matrix
+            worldVersion = 0;
+        }
+        return localMatrix;
+    }
+
     // This function returns the transformation matrix from the entity's local space to the world space
     // Remember that you can get the transformation matrix from this entity to its parent from "localTransform"
     // To get the local to world matrix, you need to combine this entities matrix with its parent's matrix and
     // its parent's parent's matrix and so on till you reach the root.
-    glm::mat4 Entity::getLocalToWorldMatrix() const {
+    // The result is cached, so the matrix math is only done for the entities whose transform (or an ancestor's transform) changed.
+    const glm::mat4& Entity::getLocalToWorldMatrix() const {
         //TODO: (Req 8) Write this function
-        if (parent == nullptr)
-            return localTransform.toMat4();
-        return parent->getLocalToWorldMatrix() * localTransform.toMat4();
+        // An entity locks itself before locking its parent, so the locks are always taken from child to parent and can not deadlock
+        TransformLockGuard lock(transformLock);
+        const glm::mat4& local = validateLocalMatrix();
+        bool dirty = worldVersion == 0 || cachedParent != parent;
+        if (parent == nullptr){
+            if (dirty) worldMatrix = local;
+        } else {
+            // The parent is validated first so its version is up to date before we compare it
+            const glm::mat4& parentMatrix = parent->getLocalToWorldMatrix();
+            dirty = dirty || parent->worldVersion != cachedParentVersion;
+            if (dirty){
+                worldMatrix = parentMatrix * local;
+                cachedParentVersion = parent->worldVersion;
+            }
+        }
+        if (dirty){
+            cachedParent = parent;
+            worldVersion = nextTransformVersion++;
+        }
+        return worldMatrix;
     }
 
 
@@ -22,7 +73,7 @@ namespace our {
     // Deserializes the entity data and components from a json object
     void Entity::deserialize(const nlohmann::json& data){
         if(!data.is_object()) return;
-        name = data.value("name", name);
+        setName(data.value("name", name));
         localTransform.deserialize(data);
         if(data.contains("components")){
             if(const auto& components = data["components"]; components.is_array()){
@@ -34,7 +85,40 @@ namespace our {
     }
 
     glm::vec3 Entity::getWorldPosition() const {
-        return {getLocalToWorldMatrix() * glm::vec4(0,0,0,1) };
+        return glm::vec3(getLocalToWorldMatrix()[3]);
+    }
+
+    void Entity::onComponentsChanged() {
+        componentMask.reset();
+        for (auto component : components){
+            componentMask.set(component->getTypeId());
+        }
+        world->updateViews(this);
+    }
+
+    void Entity::setParent(Entity* newParent) {
+        if (newParent == parent) return;
+        if (newParent == this || (newParent != nullptr && newParent->hasAncestor(this))) return;
+        if (parent != nullptr){
+            // Swap the last child into our place to remove ourselves from the old parent's list
+            auto& siblings = parent->children;
+            Entity* last = siblings.back();
+            siblings[indexInParent] = last;
+            last->indexInParent = indexInParent;
+            siblings.pop_back();
+        }
+        parent = newParent;
+        if (parent != nullptr){
+            indexInParent = parent->children.size();
+            parent->children.push_back(this);
+        }
+    }
+
+    void Entity::setName(const std::string& newName) {
+        NameId oldId = nameId;
+        name = newName;
+        nameId = internName(newName);
+        if (oldId != nameId) world->onEntityRenamed(this, oldId);
     }
 
     bool Entity::hasAncestor(Entity *other) const {
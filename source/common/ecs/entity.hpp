@@ -1,8 +1,12 @@
 #pragma once
 
 #include "component.hpp"
+#include "component-storage.hpp"
 #include "transform.hpp"
-#include <list>
+#include "entity-id.hpp"
+#include "name-id.hpp"
+#include <vector>
+#include <atomic>
 #include <iterator>
 #include <string>
 #include <glm/glm.hpp>
@@ -13,24 +17,95 @@ namespace our {
 
     class Entity{
         World *world; // This defines what world own this entity
-        std::list<Component*> components; // A list of components that are owned by this entity
+        EntityId id; // The handle of this entity inside its world
+        std::uint32_t denseIndex = 0; // The index of this entity in the world's dense entity array
+        std::string name; // The name of the entity. It could be useful to refer to an entity by its name
+        NameId nameId = EMPTY_NAME; // The interned id of "name"
+        ComponentStorage* storage; // The storage of the world in which the components of this entity live
+        std::vector<Component*> components; // A list of components that are owned by this entity
+        ComponentMask componentMask; // The types of the components owned by this entity
+
+        // Recomputes the component mask and lets the world update its views
+        void onComponentsChanged();
+
+        // The cached transformation matrices of this entity. They are validated lazily whenever they are read:
+        // the local matrix is rebuilt only if "localTransform" differs from the transform it was built from,
+        // and the world matrix is rebuilt only if the local matrix changed or the parent's world matrix changed since the last time.
+        // Each rebuilt world matrix gets a new version so that the children can detect that their parent changed.
+        mutable Transform cachedTransform; // The transform from which "localMatrix" was computed
+        mutable glm::mat4 localMatrix = glm::mat4(1.0f); // The cached local to parent matrix
+        mutable glm::mat4 worldMatrix = glm::mat4(1.0f); // The cached local to world matrix
+        mutable std::uint64_t worldVersion = 0; // The version of "worldMatrix" (0 means it was never computed)
+        mutable const Entity* cachedParent = nullptr; // The parent that was used to compute "worldMatrix"
+        mutable std::uint64_t cachedParentVersion = 0; // The version of the parent's world matrix that was used to compute "worldMatrix"
+        mutable std::atomic_flag transformLock = ATOMIC_FLAG_INIT; // Guards the cached matrices when systems run in parallel
+
+        const glm::mat4& validateLocalMatrix() const; // Rebuilds the local matrix if needed (the lock must be held)
+
+        // Returns true if "localTransform" changed since the local matrix was computed.
+        // This only depends on the transform: a stale world matrix ("worldVersion" is 0) does not make the local matrix stale,
+        // otherwise a local matrix stored by "setLocalMatrix" would be recomputed (and replaced) by the next validation.
+        // The initial cached transform is the identity transform, which matches the initial identity local matrix
+        bool isLocalMatrixDirty() const { return localTransform != cachedTransform; }
+        // Stores a local matrix that was computed elsewhere (e.g. in a batch) for the current "localTransform"
+        // and invalidates the world matrix since it depends on the local matrix
+        void setLocalMatrix(const glm::mat4& matrix) const {
+            cachedTransform = localTransform;
+            localMatrix = matrix;
+            worldVersion = 0;
+        }
+        friend class TransformSystem; // The transform system computes the local matrices of the dirty entities in batches
+
+        Entity* parent = nullptr; // The parent of the entity. The transform of the entity is relative to its parent.
+                                  // If parent is null, the entity is a root entity (has no parent).
+        std::vector<Entity*> children; // The entities whose parent is this entity (in no particular order)
+        size_t indexInParent = 0; // The index of this entity inside its parent's "children" list
 
         friend World; // The world is a friend since it is the only class that is allowed to instantiate an entity
         Entity() = default; // The entity constructor is private since only the world is allowed to instantiate an entity
     public:
-        std::string name; // The name of the entity. It could be useful to refer to an entity by its name
-        Entity* parent;   // The parent of the entity. The transform of the entity is relative to its parent.
-                          // If parent is null, the entity is a root entity (has no parent).
         Transform localTransform; // The transform of this entity relative to its parent.
 
         bool enabled = true;
 
         bool hasAncestor(Entity* other) const;
 
+        Entity* getParent() const { return parent; } // Returns the parent of this entity (or nullptr if it is a root entity)
+        const std::vector<Entity*>& getChildren() const { return children; } // Returns the direct children of this entity
+
+        // Changes the parent of this entity and updates the children lists of the old and the new parent in O(1)
+        // Passing nullptr makes this entity a root entity. Parenting an entity to itself or to one of its descendants is ignored.
+        void setParent(Entity* newParent);
+
+        // Calls "function" for every descendant of this entity (the entity itself is not included)
+        // Parents are always visited before their children and the cost is proportional to the size of the subtree
+        template<typename Function>
+        void forEachDescendant(Function&& function) const {
+            std::vector<Entity*> stack(children.begin(), children.end());
+            while(!stack.empty()){
+                Entity* entity = stack.back();
+                stack.pop_back();
+                function(entity);
+                stack.insert(stack.end(), entity->children.begin(), entity->children.end());
+            }
+        }
+
         World* getWorld() const { return world; } // Returns the world to which this entity belongs
+        EntityId getId() const { return id; } // Returns the handle of this entity (use World::resolve to get the entity back)
+
+        const std::string& getName() const { return name; } // Returns the name of the entity
+        NameId getNameId() const { return nameId; } // Returns the interned id of the name (compare this instead of the string)
+        void setName(const std::string& newName); // Renames the entity and updates the world's name index
+
+        // Returns the types of the components owned by this entity
+        const ComponentMask& getComponentMask() const { return componentMask; }
 
-        glm::mat4 getLocalToWorldMatrix() const; // Computes and returns the transformation from the entities local space to the world space
-        glm::vec3 getWorldPosition() const; // Computes and returns the transformation from the entities local space to the world space
+        const glm::mat4& getLocalToWorldMatrix() const; // Returns the (cached) transformation from the entities local space to the world space
+        const glm::mat4& getLocalMatrix() const; // Returns the (cached) transformation from the entities local space to its parent's space
+        // Returns the version of the cached local to world matrix. It changes whenever the matrix is recomputed (0 means it is not valid),
+        // so comparing it with a version read before tells if the entity moved without reading the matrix (after the TransformSystem ran)
+        std::uint64_t getTransformVersion() const { return worldVersion; }
+        glm::vec3 getWorldPosition() const; // Returns the position of the entity in the world space
         void deserialize(const nlohmann::json&); // Deserializes the entity data and components from a json object
         
         // This template method create a component of type T,
@@ -40,9 +115,10 @@ namespace our {
             static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
             //TODO: (Req 8) Create an component of type T, set its "owner" to be this entity, then push it into the component's list
             // Don't forget to return a pointer to the new component
-            T* t = new T();
+            T* t = storage->create<T>();
             ((Component*) t)->owner = this;
             components.push_back(t);
+            onComponentsChanged();
             return t;
         }
 
@@ -52,12 +128,10 @@ namespace our {
         T* getComponent(){
             //TODO: (Req 8) Go through the components list and find the first component that can be dynamically cast to "T*".
             // Return the component you found, or return null of nothing was found.
-            auto it = components.begin();
-            while (it != components.end()){
-                if (dynamic_cast<T*>(*it)){
-                    return (T*) *it;
+            for (auto component : components){
+                if (T* t = componentCast<T>(component)){
+                    return t;
                 }
-                it++;
             }
             return nullptr;
         }
@@ -67,13 +141,10 @@ namespace our {
             //TODO: (Req 8) Go through the components list and find the first component that can be dynamically cast to "T*".
             // Return the component you found, or return null of nothing was found.
             std::vector<T*> out;
-            auto it = components.begin();
-            while (it != components.end()){
-                T* t = dynamic_cast<T*>(*it);
-                if (t){
+            for (auto component : components){
+                if (T* t = componentCast<T>(component)){
                     out.emplace_back(t);
                 }
-                it++;
             }
             return out;
         }
@@ -81,16 +152,14 @@ namespace our {
         //same but with a bit of optimization
         template<typename T,typename V>
         std::pair<T*,V*> getComponents(){
-            std::pair<T*,V*> out;
-            auto it = components.begin();
-            while (it != components.end()){
-                if (dynamic_cast<T*>(*it)){
-                    out.first = (T*) *it;
+            std::pair<T*,V*> out{nullptr, nullptr};
+            for (auto component : components){
+                if (T* t = componentCast<T>(component)){
+                    out.first = t;
                 }
-                if (dynamic_cast<V*>(*it)){
-                    out.second = (V*) *it;
+                if (V* v = componentCast<V>(component)){
+                    out.second = v;
                 }
-                it++;
             }
             return out;
         }
@@ -99,10 +168,8 @@ namespace our {
         // If no component of type T was found, it returns a nullptr 
         template<typename T>
         T* getComponent(size_t index){
-            auto it = components.begin();
-            std::advance(it, index);
-            if(it != components.end())
-                return dynamic_cast<T*>(*it);
+            if(index < components.size())
+                return componentCast<T>(components[index]);
             return nullptr;
         }
 
@@ -111,24 +178,22 @@ namespace our {
         void deleteComponent(){
             //TODO: (Req 8) Go through the components list and find the first component that can be dynamically cast to "T*".
             // If found, delete the found component and remove it from the components list
-            auto it = components.begin();
-            for (auto k : components){
-                if (dynamic_cast<Component*>(k)){
-                    delete k;
-                    components.remove(k);
+            for (auto it = components.begin(); it != components.end(); it++){
+                if (componentCast<T>(*it)){
+                    storage->destroy(*it);
+                    components.erase(it);
+                    onComponentsChanged();
                     break;
                 }
-                it++;
             }
         }
 
         // This template method searhes for a component of type T and deletes it
         void deleteComponent(size_t index){
-            auto it = components.begin();
-            std::advance(it, index);
-            if(it != components.end()) {
-                delete *it;
-                components.erase(it);
+            if(index < components.size()) {
+                storage->destroy(components[index]);
+                components.erase(components.begin() + index);
+                onComponentsChanged();
             }
         }
 
@@ -137,14 +202,13 @@ namespace our {
         void deleteComponent(T const* component){
             //TODO: (Req 8) Go through the components list and find the given component "component".
             // If found, delete the found component and remove it from the components list
-            auto it = components.begin();
-            for (auto k : components){
-                if (k == component){
-                    delete k;
+            for (auto it = components.begin(); it != components.end(); it++){
+                if (*it == component){
+                    storage->destroy(*it);
                     components.erase(it);
+                    onComponentsChanged();
                     break;
                 }
-                std::advance(it, 1);
             }
         }
 
@@ -152,7 +216,7 @@ namespace our {
         ~Entity(){
             //TODO: (Req 8) Delete all the components in "components".
             for (auto k : components){
-                delete k;
+                storage->destroy(k);
             }
         }
 
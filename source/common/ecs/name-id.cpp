@@ -0,0 +1,35 @@
+#include "name-id.hpp"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace our {
+
+    // The interning table is shared by all the worlds. The strings are kept in a deque so that references to them stay valid.
+    struct NameTable {
+        std::mutex mutex;
+        std::deque<std::string> names{""};
+        std::unordered_map<std::string, NameId> ids{{"", EMPTY_NAME}};
+    };
+
+    static NameTable& getNameTable() {
+        static NameTable table;
+        return table;
+    }
+
+    NameId internName(const std::string& name) {
+        auto& table = getNameTable();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        auto [it, inserted] = table.ids.emplace(name, (NameId) table.names.size());
+        if (inserted) table.names.push_back(name);
+        return it->second;
+    }
+
+    const std::string& getInternedName(NameId id) {
+        auto& table = getNameTable();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        return table.names[id];
+    }
+
+}
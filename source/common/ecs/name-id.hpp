@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace our {
+
+    // A name id is a small integer that stands for an interned string.
+    // Interning the same string always returns the same id, so names can be compared and hashed as integers.
+    using NameId = std::uint32_t;
+
+    // The id of the empty string
+    constexpr NameId EMPTY_NAME = 0;
+
+    // Returns the id of the given name (and adds it to the table if it was never interned before)
+    NameId internName(const std::string& name);
+
+    // Returns the string that was interned with the given id
+    const std::string& getInternedName(NameId id);
+
+}
@@ -0,0 +1,326 @@
+#include "transform-batch.hpp"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#define OUR_TRANSFORM_BATCH_AVX 1
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OUR_TRANSFORM_BATCH_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace our {
+
+    void TransformBatch::clear() {
+        for (auto* array : {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &scaleX, &scaleY, &scaleZ}) {
+            array->clear();
+        }
+    }
+
+    void TransformBatch::reserve(size_t count) {
+        for (auto* array : {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &scaleX, &scaleY, &scaleZ}) {
+            array->reserve(count);
+        }
+    }
+
+    void TransformBatch::push(const Transform& transform) {
+        positionX.push_back(transform.position.x);
+        positionY.push_back(transform.position.y);
+        positionZ.push_back(transform.position.z);
+        rotationX.push_back(transform.rotation.x);
+        rotationY.push_back(transform.rotation.y);
+        rotationZ.push_back(transform.rotation.z);
+        scaleX.push_back(transform.scale.x);
+        scaleY.push_back(transform.scale.y);
+        scaleZ.push_back(transform.scale.z);
+    }
+
+    // Computes one matrix with the same formula as glm::yawPitchRoll, but every rotation column is scaled
+    // and the translation is written directly instead of multiplying the three matrices
+    static void computeMatrix(const TransformBatch& batch, size_t i, glm::mat4& matrix) {
+        float sp = std::sin(batch.rotationX[i]), cp = std::cos(batch.rotationX[i]); // pitch
+        float sh = std::sin(batch.rotationY[i]), ch = std::cos(batch.rotationY[i]); // yaw
+        float sb = std::sin(batch.rotationZ[i]), cb = std::cos(batch.rotationZ[i]); // roll
+        float sx = batch.scaleX[i], sy = batch.scaleY[i], sz = batch.scaleZ[i];
+
+        matrix[0] = glm::vec4((ch * cb + sh * sp * sb) * sx, (sb * cp) * sx, (-sh * cb + ch * sp * sb) * sx, 0.0f);
+        matrix[1] = glm::vec4((-ch * sb + sh * sp * cb) * sy, (cb * cp) * sy, (sb * sh + ch * sp * cb) * sy, 0.0f);
+        matrix[2] = glm::vec4((sh * cp) * sz, (-sp) * sz, (ch * cp) * sz, 0.0f);
+        matrix[3] = glm::vec4(batch.positionX[i], batch.positionY[i], batch.positionZ[i], 1.0f);
+    }
+
+#ifdef OUR_TRANSFORM_BATCH_SSE
+
+    // The largest angle for which the range reduction of "sincos4" keeps full float precision
+    static constexpr float SINCOS_MAX_ANGLE = 8192.0f;
+
+    // Computes the sine and cosine of 4 angles at once.
+    // This is the Cephes single precision algorithm: the angle is reduced to [-pi/4, pi/4] using the octant
+    // (with pi/4 split in three parts to keep the precision), then a polynomial is evaluated for both the sine and the cosine
+    // and the right one is picked (and negated) for every lane depending on its octant.
+    static inline void sincos4(__m128 x, __m128& s, __m128& c) {
+        const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+        __m128 signSin = _mm_and_ps(x, signMask);
+        x = _mm_andnot_ps(signMask, x); // abs
+
+        // The octant of the angle, rounded to an even number
+        __m128 y = _mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)); // 4 / pi
+        __m128i j = _mm_cvttps_epi32(y);
+        j = _mm_add_epi32(j, _mm_set1_epi32(1));
+        j = _mm_and_si128(j, _mm_set1_epi32(~1));
+        y = _mm_cvtepi32_ps(j);
+
+        // The sign of the sine flips for octants 4 to 7 and the sign of the cosine for octants 2 to 5
+        __m128i jSin = _mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29);
+        __m128i jCos = _mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29);
+        // Which polynomial gives the sine (and which gives the cosine) for octants 2,3,6,7
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+        signSin = _mm_xor_ps(signSin, _mm_castsi128_ps(jSin));
+
+        // x = x - y * pi/4 (extended precision)
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-0.78515625f)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-2.4187564849853515625e-4f)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-3.77489497744594108e-8f)));
+        __m128 z = _mm_mul_ps(x, x);
+
+        // The cosine polynomial
+        __m128 pc = _mm_set1_ps(2.443315711809948e-5f);
+        pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(-1.388731625493765e-3f));
+        pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(4.166664568298827e-2f));
+        pc = _mm_mul_ps(_mm_mul_ps(pc, z), z);
+        pc = _mm_sub_ps(pc, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+        pc = _mm_add_ps(pc, _mm_set1_ps(1.0f));
+
+        // The sine polynomial
+        __m128 ps = _mm_set1_ps(-1.9515295891e-4f);
+        ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(8.3321608736e-3f));
+        ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(-1.6666654611e-1f));
+        ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), x), x);
+
+        __m128 sinValue = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+        __m128 cosValue = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+        s = _mm_xor_ps(sinValue, signSin);
+        c = _mm_xor_ps(cosValue, _mm_castsi128_ps(jCos));
+    }
+
+    // Stores 4 matrices given their columns with one lane per transform ("columns[column][component]")
+    static inline void storeMatrices4(__m128 (&columns)[4][4], glm::mat4* matrices) {
+        // Transpose from one lane per transform to one vector per matrix column
+        for (auto& column : columns) {
+            _MM_TRANSPOSE4_PS(column[0], column[1], column[2], column[3]);
+        }
+        for (int k = 0; k < 4; k++) {
+            float* matrix = &matrices[k][0][0];
+            for (int column = 0; column < 4; column++) {
+                _mm_storeu_ps(matrix + 4 * column, columns[column][k]);
+            }
+        }
+    }
+
+    // Computes the matrices of 4 transforms starting from "i" and stores them in "matrices"
+    static inline void computeMatrices4(const TransformBatch& batch, size_t i, glm::mat4* matrices) {
+        __m128 sp, cp, sh, ch, sb, cb;
+        sincos4(_mm_loadu_ps(&batch.rotationX[i]), sp, cp);
+        sincos4(_mm_loadu_ps(&batch.rotationY[i]), sh, ch);
+        sincos4(_mm_loadu_ps(&batch.rotationZ[i]), sb, cb);
+        __m128 sx = _mm_loadu_ps(&batch.scaleX[i]);
+        __m128 sy = _mm_loadu_ps(&batch.scaleY[i]);
+        __m128 sz = _mm_loadu_ps(&batch.scaleZ[i]);
+
+        __m128 spsb = _mm_mul_ps(sp, sb), spcb = _mm_mul_ps(sp, cb);
+        __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+
+        // Every column is computed for the 4 transforms (one transform per lane)
+        __m128 c0x = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ch, cb), _mm_mul_ps(sh, spsb)), sx);
+        __m128 c0y = _mm_mul_ps(_mm_mul_ps(sb, cp), sx);
+        __m128 c0z = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ch, spsb), _mm_mul_ps(sh, cb)), sx);
+        __m128 c0w = zero;
+
+        __m128 c1x = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sh, spcb), _mm_mul_ps(ch, sb)), sy);
+        __m128 c1y = _mm_mul_ps(_mm_mul_ps(cb, cp), sy);
+        __m128 c1z = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sb, sh), _mm_mul_ps(ch, spcb)), sy);
+        __m128 c1w = zero;
+
+        __m128 c2x = _mm_mul_ps(_mm_mul_ps(sh, cp), sz);
+        __m128 c2y = _mm_sub_ps(zero, _mm_mul_ps(sp, sz));
+        __m128 c2z = _mm_mul_ps(_mm_mul_ps(ch, cp), sz);
+        __m128 c2w = zero;
+
+        __m128 c3x = _mm_loadu_ps(&batch.positionX[i]);
+        __m128 c3y = _mm_loadu_ps(&batch.positionY[i]);
+        __m128 c3z = _mm_loadu_ps(&batch.positionZ[i]);
+        __m128 c3w = one;
+
+        __m128 columns[4][4] = {
+                {c0x, c0y, c0z, c0w},
+                {c1x, c1y, c1z, c1w},
+                {c2x, c2y, c2z, c2w},
+                {c3x, c3y, c3z, c3w},
+        };
+        storeMatrices4(columns, matrices);
+    }
+
+    // Returns true if all 4 angles starting from "i" are small enough for "sincos4"
+    static inline bool anglesInRange(const TransformBatch& batch, size_t i) {
+        const __m128 limit = _mm_set1_ps(SINCOS_MAX_ANGLE);
+        const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+        __m128 inRange = _mm_cmple_ps(_mm_andnot_ps(signMask, _mm_loadu_ps(&batch.rotationX[i])), limit);
+        inRange = _mm_and_ps(inRange, _mm_cmple_ps(_mm_andnot_ps(signMask, _mm_loadu_ps(&batch.rotationY[i])), limit));
+        inRange = _mm_and_ps(inRange, _mm_cmple_ps(_mm_andnot_ps(signMask, _mm_loadu_ps(&batch.rotationZ[i])), limit));
+        return _mm_movemask_ps(inRange) == 0xF;
+    }
+
+    // Computes the matrices of the 4 transforms starting from "i" with "computeMatrices4" if their angles are in range
+    static inline void computeGroup4(const TransformBatch& batch, size_t i, glm::mat4* matrices) {
+        if (anglesInRange(batch, i)) {
+            computeMatrices4(batch, i, matrices);
+        } else {
+            // Huge angles (e.g. from an object that keeps spinning) need the precise range reduction of std::sin
+            for (size_t k = 0; k < 4; k++) computeMatrix(batch, i + k, matrices[k]);
+        }
+    }
+
+#ifdef OUR_TRANSFORM_BATCH_AVX
+
+    // The 8 wide version of "sincos4" (the same algorithm and constants).
+    // AVX has no 256 bit integer instructions, so the octant is kept in floats (it is a small even integer, so it is exact)
+    // and the lanes that change sign or swap the polynomials are found by comparing the octant modulo 8 instead of testing its bits
+    static inline void sincos8(__m256 x, __m256& s, __m256& c) {
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        __m256 signSin = _mm256_and_ps(x, signMask);
+        x = _mm256_andnot_ps(signMask, x); // abs
+
+        // The octant of the angle, rounded to an even number
+        __m256 y = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.27323954473516f)), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); // 4 / pi
+        y = _mm256_add_ps(y, _mm256_set1_ps(1.0f));
+        y = _mm256_mul_ps(_mm256_floor_ps(_mm256_mul_ps(y, _mm256_set1_ps(0.5f))), _mm256_set1_ps(2.0f));
+        __m256 octant = _mm256_sub_ps(y, _mm256_mul_ps(_mm256_floor_ps(_mm256_mul_ps(y, _mm256_set1_ps(0.125f))), _mm256_set1_ps(8.0f)));
+
+        // The sign of the sine flips for octants 4 to 7 and the sign of the cosine for octants 2 to 5
+        __m256 octant2 = _mm256_cmp_ps(octant, _mm256_set1_ps(2.0f), _CMP_EQ_OQ);
+        __m256 octant4 = _mm256_cmp_ps(octant, _mm256_set1_ps(4.0f), _CMP_EQ_OQ);
+        __m256 octant6 = _mm256_cmp_ps(octant, _mm256_set1_ps(6.0f), _CMP_EQ_OQ);
+        __m256 flipSin = _mm256_and_ps(_mm256_or_ps(octant4, octant6), signMask);
+        __m256 flipCos = _mm256_and_ps(_mm256_or_ps(octant2, octant4), signMask);
+        // Which polynomial gives the sine (and which gives the cosine) for octants 2,3,6,7
+        __m256 swap = _mm256_or_ps(octant2, octant6);
+        signSin = _mm256_xor_ps(signSin, flipSin);
+
+        // x = x - y * pi/4 (extended precision)
+        x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(-0.78515625f)));
+        x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(-2.4187564849853515625e-4f)));
+        x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(-3.77489497744594108e-8f)));
+        __m256 z = _mm256_mul_ps(x, x);
+
+        // The cosine polynomial
+        __m256 pc = _mm256_set1_ps(2.443315711809948e-5f);
+        pc = _mm256_add_ps(_mm256_mul_ps(pc, z), _mm256_set1_ps(-1.388731625493765e-3f));
+        pc = _mm256_add_ps(_mm256_mul_ps(pc, z), _mm256_set1_ps(4.166664568298827e-2f));
+        pc = _mm256_mul_ps(_mm256_mul_ps(pc, z), z);
+        pc = _mm256_sub_ps(pc, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+        pc = _mm256_add_ps(pc, _mm256_set1_ps(1.0f));
+
+        // The sine polynomial
+        __m256 ps = _mm256_set1_ps(-1.9515295891e-4f);
+        ps = _mm256_add_ps(_mm256_mul_ps(ps, z), _mm256_set1_ps(8.3321608736e-3f));
+        ps = _mm256_add_ps(_mm256_mul_ps(ps, z), _mm256_set1_ps(-1.6666654611e-1f));
+        ps = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(ps, z), x), x);
+
+        // (selected with masks like in "sincos4": GCC turns a blend by a comparison into integer vector code, which AVX lacks)
+        __m256 sinValue = _mm256_or_ps(_mm256_and_ps(swap, pc), _mm256_andnot_ps(swap, ps));
+        __m256 cosValue = _mm256_or_ps(_mm256_and_ps(swap, ps), _mm256_andnot_ps(swap, pc));
+        s = _mm256_xor_ps(sinValue, signSin);
+        c = _mm256_xor_ps(cosValue, flipCos);
+    }
+
+    // Computes the matrices of 8 transforms starting from "i" and stores them in "matrices"
+    static inline void computeMatrices8(const TransformBatch& batch, size_t i, glm::mat4* matrices) {
+        __m256 sp, cp, sh, ch, sb, cb;
+        sincos8(_mm256_loadu_ps(&batch.rotationX[i]), sp, cp);
+        sincos8(_mm256_loadu_ps(&batch.rotationY[i]), sh, ch);
+        sincos8(_mm256_loadu_ps(&batch.rotationZ[i]), sb, cb);
+        __m256 sx = _mm256_loadu_ps(&batch.scaleX[i]);
+        __m256 sy = _mm256_loadu_ps(&batch.scaleY[i]);
+        __m256 sz = _mm256_loadu_ps(&batch.scaleZ[i]);
+
+        __m256 spsb = _mm256_mul_ps(sp, sb), spcb = _mm256_mul_ps(sp, cb);
+        __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+
+        // Every column is computed for the 8 transforms (one transform per lane), with the same formula as "computeMatrices4"
+        __m256 columns[4][4] = {
+                {
+                        _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(ch, cb), _mm256_mul_ps(sh, spsb)), sx),
+                        _mm256_mul_ps(_mm256_mul_ps(sb, cp), sx),
+                        _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(ch, spsb), _mm256_mul_ps(sh, cb)), sx),
+                        zero
+                },
+                {
+                        _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(sh, spcb), _mm256_mul_ps(ch, sb)), sy),
+                        _mm256_mul_ps(_mm256_mul_ps(cb, cp), sy),
+                        _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(sb, sh), _mm256_mul_ps(ch, spcb)), sy),
+                        zero
+                },
+                {
+                        _mm256_mul_ps(_mm256_mul_ps(sh, cp), sz),
+                        _mm256_sub_ps(zero, _mm256_mul_ps(sp, sz)),
+                        _mm256_mul_ps(_mm256_mul_ps(ch, cp), sz),
+                        zero
+                },
+                {
+                        _mm256_loadu_ps(&batch.positionX[i]),
+                        _mm256_loadu_ps(&batch.positionY[i]),
+                        _mm256_loadu_ps(&batch.positionZ[i]),
+                        one
+                },
+        };
+
+        for (int column = 0; column < 4; column++) {
+            // The same transpose as _MM_TRANSPOSE4_PS, done in both 128 bit halves at once:
+            // the lower half of "transposed[k]" is the column of transform k and the upper half the one of transform k + 4
+            const __m256* c = columns[column];
+            __m256 xy0 = _mm256_unpacklo_ps(c[0], c[1]), zw0 = _mm256_unpacklo_ps(c[2], c[3]);
+            __m256 xy1 = _mm256_unpackhi_ps(c[0], c[1]), zw1 = _mm256_unpackhi_ps(c[2], c[3]);
+            __m256 transposed[4] = {
+                    _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0)),
+                    _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2)),
+                    _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0)),
+                    _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2)),
+            };
+            for (int k = 0; k < 4; k++) {
+                _mm_storeu_ps(&matrices[k][column][0], _mm256_castps256_ps128(transposed[k]));
+                _mm_storeu_ps(&matrices[k + 4][column][0], _mm256_extractf128_ps(transposed[k], 1));
+            }
+        }
+    }
+
+#endif
+
+#endif
+
+    void TransformBatch::computeMatrices(size_t begin, size_t end, glm::mat4* matrices) const {
+        size_t i = begin;
+#ifdef OUR_TRANSFORM_BATCH_AVX
+        for (; i + 8 <= end; i += 8) {
+            if (anglesInRange(*this, i) && anglesInRange(*this, i + 4)) {
+                computeMatrices8(*this, i, matrices + i);
+            } else {
+                // The half that is in range (if any) can still use the 4 wide version
+                computeGroup4(*this, i, matrices + i);
+                computeGroup4(*this, i + 4, matrices + i + 4);
+            }
+        }
+#endif
+#ifdef OUR_TRANSFORM_BATCH_SSE
+        for (; i + 4 <= end; i += 4) {
+            computeGroup4(*this, i, matrices + i);
+        }
+#endif
+        // The remaining transforms (or all of them without SSE)
+        for (; i < end; i++) {
+            computeMatrix(*this, i, matrices[i]);
+        }
+    }
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "transform.hpp"
+
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace our {
+
+    // A transform batch stores many transforms in SoA form (one array per component) so that their matrices
+    // can be computed 4 at a time using SIMD instructions (8 at a time when the compiler targets AVX).
+    class TransformBatch {
+    public:
+        std::vector<float> positionX, positionY, positionZ;
+        std::vector<float> rotationX, rotationY, rotationZ; // Euler angles in radians (y: yaw, x: pitch, z: roll)
+        std::vector<float> scaleX, scaleY, scaleZ;
+
+        size_t size() const { return positionX.size(); }
+        void clear();
+        void reserve(size_t count);
+        void push(const Transform& transform);
+
+        // Computes the matrices of the transforms in [begin, end) and writes them to "matrices[begin]"..."matrices[end - 1]".
+        // The result is the same as Transform::toMat4 (translation * yawPitchRoll * scale) but the TRS is composed directly,
+        // the sines and cosines are computed for 4 (or 8) transforms at once and no intermediate matrices are multiplied.
+        // If SSE is not available, a scalar version of the same formula is used.
+        void computeMatrices(size_t begin, size_t end, glm::mat4* matrices) const;
+    };
+
+}
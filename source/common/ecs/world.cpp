@@ -10,7 +10,7 @@ namespace our {
         for(const auto& entityData : data){
             //TODO: (Req 8) Create an entity, make its parent "parent" and call its deserialize with "entityData".
             auto k = add();
-            k->parent = parent;
+            k->setParent(parent);
             k->deserialize(entityData);
             if(entityData.contains("children")){
                 //TODO: (Req 8) Recursively call this world's "deserialize" using the children data
@@ -20,4 +20,15 @@ namespace our {
         }
     }
 
+    void World::updateViews(Entity* entity) {
+        if (markedForRemoval.count(entity)) return;
+        for (auto& [signature, view] : views){
+            if ((entity->getComponentMask() & signature) == signature){
+                view->insert(entity);
+            } else {
+                view->erase(entity);
+            }
+        }
+    }
+
 }
\ No newline at end of file
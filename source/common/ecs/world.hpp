@@ -1,15 +1,67 @@
 #pragma once
 
 #include <unordered_set>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <mutex>
 #include "entity.hpp"
+#include "entity-view.hpp"
+#include "chunk-allocator.hpp"
 
 namespace our {
 
     // This class holds a set of entities
     class World {
-        std::unordered_set<Entity*> entities; // These are the entities held by this world
+        ComponentStorage components; // The components of all the entities in this world, stored in per-type pools
+        ChunkAllocator<Entity> entityAllocator; // The memory in which the entities of this world live
+        std::vector<Entity*> entities; // These are the entities held by this world packed in a dense array
+        // A slot maps an entity id to its entity. The generation of a slot is incremented whenever its entity is removed
+        struct EntitySlot {
+            Entity* entity = nullptr;
+            std::uint32_t generation = 0;
+        };
+        std::vector<EntitySlot> slots; // The slots indexed by "EntityId::index"
+        std::vector<std::uint32_t> freeSlots; // The indices of the slots that have no entity
         std::unordered_set<Entity*> markedForRemoval; // These are the entities that are awaiting to be deleted
                                                       // when deleteMarkedEntities is called
+        std::unordered_map<ComponentMask, std::unique_ptr<EntityView>> views; // The cached views indexed by their signature
+        std::mutex viewsMutex; // Guards the creation of the views since systems may run in parallel
+        std::unordered_map<NameId, std::vector<Entity*>> nameIndex; // The entities that have each name (unnamed entities are not indexed)
+
+        // This removes the entity from the list of entities that have the given name
+        void removeFromNameIndex(Entity* entity, NameId name) {
+            if (name == EMPTY_NAME) return;
+            auto it = nameIndex.find(name);
+            if (it == nameIndex.end()) return;
+            auto& named = it->second;
+            named.erase(std::find(named.begin(), named.end(), entity));
+            if (named.empty()) nameIndex.erase(it);
+        }
+
+        // This removes the entity from every cached view
+        void removeFromViews(Entity* entity) {
+            for (auto& [signature, view] : views){
+                view->erase(entity);
+            }
+        }
+
+        // This removes the entity from the dense array and frees its slot,
+        // then destructs the entity and gives its memory back to the entity allocator
+        void destroyEntity(Entity* entity) {
+            // Swap the last entity into the place of the removed one to keep the array packed
+            Entity* last = entities.back();
+            entities[entity->denseIndex] = last;
+            last->denseIndex = entity->denseIndex;
+            entities.pop_back();
+
+            slots[entity->id.index].entity = nullptr;
+            freeSlots.push_back(entity->id.index);
+
+            entity->~Entity();
+            entityAllocator.deallocate(entity);
+        }
+
     public:
 
         World() = default;
@@ -26,52 +78,170 @@ namespace our {
         Entity* add() {
             //TODO: (Req 8) Create a new entity, set its world member variable to this,
             // and don't forget to insert it in the suitable container.
-            auto* t = new Entity();
+            auto* t = new (entityAllocator.allocate()) Entity();
             t->parent = nullptr;
             t->world = this;
-            entities.emplace(t);
+            t->storage = &components;
+
+            std::uint32_t index;
+            if (!freeSlots.empty()){
+                index = freeSlots.back();
+                freeSlots.pop_back();
+            } else {
+                index = (std::uint32_t) slots.size();
+                slots.emplace_back();
+            }
+            slots[index].entity = t;
+            t->id = {index, slots[index].generation};
+
+            t->denseIndex = (std::uint32_t) entities.size();
+            entities.push_back(t);
             return t;
         }
 
-        // This returns and immutable reference to the set of all entites in the world.
-        const std::unordered_set<Entity*>& getEntities() {
+        // This returns and immutable reference to the array of all entites in the world.
+        // The entities are packed contiguously so iterating over them is a linear sweep.
+        const std::vector<Entity*>& getEntities() {
             return entities;
         }
 
+        // This returns the entity with the given id or nullptr if the id is invalid or
+        // the entity has been marked for removal (or deleted). This costs an index and a comparison.
+        Entity* resolve(EntityId id) const {
+            if (id.index >= slots.size()) return nullptr;
+            const EntitySlot& slot = slots[id.index];
+            return slot.generation == id.generation ? slot.entity : nullptr;
+        }
+
+        // This returns all the components of type T in this world (the components of all the entities are included)
+        // The components are packed in a per-type pool, so iterating over them does not touch the other entities
+        template<typename T>
+        const std::vector<T*>& getAllComponents() {
+            return components.getPool<T>().getAll();
+        }
+
+        // The listener is told whenever a component of type T is created or destroyed in this world.
+        // The components that already exist are not reported, so they should be read with "getAllComponents" when the listener is added.
+        // The listener must be removed before it is destructed (unless the world is destructed first)
+        template<typename T>
+        void addComponentListener(ComponentListener<T>* listener) {
+            components.getPool<T>().addListener(listener);
+        }
+        template<typename T>
+        void removeComponentListener(ComponentListener<T>* listener) {
+            components.getPool<T>().removeListener(listener);
+        }
+
+        // This returns a cached view of all the entities that hold every one of the given component types.
+        // The view is created (by scanning the world once) the first time it is requested,
+        // then it is kept up to date incrementally as components are added or deleted and as entities are marked for removal.
+        // Entities that are marked for removal are not included in any view.
+        template<typename... T>
+        const EntityView& view() {
+            static_assert(sizeof...(T) > 0, "A view needs at least one component type");
+            auto signature = makeComponentMask<T...>();
+            std::lock_guard<std::mutex> lock(viewsMutex);
+            if (auto it = views.find(signature); it != views.end()){
+                return *it->second;
+            }
+            auto view = std::unique_ptr<EntityView>(new EntityView(signature));
+            for (auto entity : entities){
+                if (!markedForRemoval.count(entity) && (entity->getComponentMask() & signature) == signature){
+                    view->insert(entity);
+                }
+            }
+            return *views.emplace(signature, std::move(view)).first->second;
+        }
+
+        // This returns the first component of type T in the world (or nullptr if there is none) in O(1).
+        // It is meant for components that only exist once per world such as the camera or paimon.
+        template<typename T>
+        T* getSingleton() {
+            auto& all = getAllComponents<T>();
+            return all.empty() ? nullptr : all.front();
+        }
+
+        // This is called by the entity whenever its components change to update the views that contain it
+        void updateViews(Entity* entity);
+
+        // This returns the entities with the given name in O(1). Entities that are marked for removal are not included.
+        const std::vector<Entity*>& getEntitiesByName(NameId name) const {
+            static const std::vector<Entity*> none;
+            auto it = nameIndex.find(name);
+            return it == nameIndex.end() ? none : it->second;
+        }
+
+        // This is called by the entity whenever it is renamed to keep the name index up to date
+        void onEntityRenamed(Entity* entity, NameId oldName) {
+            if (markedForRemoval.count(entity)) return;
+            removeFromNameIndex(entity, oldName);
+            if (entity->getNameId() != EMPTY_NAME) nameIndex[entity->getNameId()].push_back(entity);
+        }
+
         // This marks an entity for removal by adding it to the "markedForRemoval" set.
         // The elements in the "markedForRemoval" set will be removed and deleted when "deleteMarkedEntities" is called.
+        // The descendants of the entity are marked too, so the cost is proportional to the size of its subtree.
         void markForRemoval(Entity* entity){
             //TODO: (Req 8) If the entity is in this world, add it to the "markedForRemoval" set.
-            auto it = entities.begin();
-            while (it != entities.end()){
-                if (*it == entity) //remove the entity if found
-                    markedForRemoval.emplace(*it);
-
-                if ((*it) ->parent == entity) //remove its children if it has any
-                    markForRemoval(*it);
-
-                it++;
-            }
+            if (entity == nullptr || entity->world != this) return;
+            auto mark = [this](Entity* e){
+                if (markedForRemoval.emplace(e).second){
+                    removeFromViews(e);
+                    removeFromNameIndex(e, e->getNameId());
+                    // Invalidate the ids of the entity right away, the slot is freed when the entity is deleted
+                    slots[e->id.index].generation++;
+                }
+            };
+            mark(entity);
+            entity->forEachDescendant(mark); //remove its children if it has any
         }
 
         // This removes the elements in "markedForRemoval" from the "entities" set.
         // Then each of these elements are deleted.
         void deleteMarkedEntities(){
             //TODO: (Req 8) Remove and delete all the entities that have been marked for removal
+            // First detach the marked entities from the parents that will stay alive and
+            // the children that will stay alive from the marked entities, so no entity keeps a dangling pointer
+            for (auto k : markedForRemoval){
+                if (k->parent && !markedForRemoval.count(k->parent))
+                    k->setParent(nullptr);
+            }
             for (auto k : markedForRemoval){
-                entities.erase(k);
-                delete k;
+                for (size_t i = k->children.size(); i-- > 0;){
+                    if (!markedForRemoval.count(k->children[i]))
+                        k->children[i]->setParent(nullptr);
+                }
+            }
+            for (auto k : markedForRemoval){
+                destroyEntity(k);
             }
             markedForRemoval.clear();
         }
 
         //This deletes all entities in the world
+        // The components are destroyed in one linear sweep per type and all the memory is kept
+        // in the pools so that the next level (e.g. after a restart) is built without going to the heap
         void clear(){
             //TODO: (Req 8) Delete all the entites and make sure that the containers are empty
+            components.clear();
             for (auto k : entities){
-                delete k;
+                k->components.clear(); // their components are already destroyed
+                k->~Entity();
             }
             entities.clear();
+            entityAllocator.reset();
+            // All the slots become free and every id handed out so far becomes stale
+            freeSlots.clear();
+            for (size_t i = slots.size(); i > 0; i--){
+                slots[i - 1].entity = nullptr;
+                slots[i - 1].generation++;
+                freeSlots.push_back((std::uint32_t)(i - 1));
+            }
+            markedForRemoval.clear();
+            for (auto& [signature, view] : views){
+                view->clear();
+            }
+            nameIndex.clear();
         }
 
         //Since the world owns all of its entities, they should be deleted alongside it.
@@ -0,0 +1,126 @@
+#include "gl-state-cache.hpp"
+
+namespace our {
+
+    GLStateCache& GLStateCache::getInstance() {
+        static GLStateCache instance;
+        return instance;
+    }
+
+    void GLStateCache::invalidate() {
+        program = vertexArray = framebuffer = activeUnit = UNKNOWN;
+        for (GLuint unit = 0; unit < TRACKED_TEXTURE_UNITS; unit++) {
+            textures[unit] = samplers[unit] = UNKNOWN;
+        }
+        for (auto& capability : capabilities) capability = -1;
+        culledFace = frontFaceWinding = depthFunction = blendEquationMode = blendSource = blendDestination = UNKNOWN;
+        blendConstantColor = glm::vec4(-1.0f); // Not a valid blend color (it is clamped to [0, 1])
+        colorWriteMask = depthWriteMask = -1;
+    }
+
+    void GLStateCache::useProgram(GLuint newProgram) {
+        if (change(program, newProgram)) glUseProgram(newProgram);
+    }
+
+    void GLStateCache::bindVertexArray(GLuint newVertexArray) {
+        if (change(vertexArray, newVertexArray)) glBindVertexArray(newVertexArray);
+    }
+
+    void GLStateCache::bindFramebuffer(GLuint newFramebuffer) {
+        if (change(framebuffer, newFramebuffer)) glBindFramebuffer(GL_FRAMEBUFFER, newFramebuffer);
+    }
+
+    void GLStateCache::activeTexture(GLuint unit) {
+        if (change(activeUnit, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    void GLStateCache::bindTexture(GLuint texture) {
+        // If the active unit is unknown or not tracked, the binding can't be compared
+        if (activeUnit >= TRACKED_TEXTURE_UNITS) {
+            counters.issued++;
+            glBindTexture(GL_TEXTURE_2D, texture);
+            return;
+        }
+        if (change(textures[activeUnit], texture)) glBindTexture(GL_TEXTURE_2D, texture);
+    }
+
+    void GLStateCache::bindSampler(GLuint unit, GLuint sampler) {
+        if (unit >= TRACKED_TEXTURE_UNITS) {
+            counters.issued++;
+            glBindSampler(unit, sampler);
+            return;
+        }
+        if (change(samplers[unit], sampler)) glBindSampler(unit, sampler);
+    }
+
+    void GLStateCache::setCapability(Capability capability, GLenum glCapability, bool enabled) {
+        if (!change(capabilities[capability], enabled ? 1 : 0)) return;
+        if (enabled) glEnable(glCapability);
+        else glDisable(glCapability);
+    }
+
+    void GLStateCache::cullFace(GLenum face) {
+        if (change(culledFace, face)) glCullFace(face);
+    }
+
+    void GLStateCache::frontFace(GLenum winding) {
+        if (change(frontFaceWinding, winding)) glFrontFace(winding);
+    }
+
+    void GLStateCache::depthFunc(GLenum function) {
+        if (change(depthFunction, function)) glDepthFunc(function);
+    }
+
+    void GLStateCache::blendEquation(GLenum equation) {
+        if (change(blendEquationMode, equation)) glBlendEquation(equation);
+    }
+
+    void GLStateCache::blendFunc(GLenum sourceFactor, GLenum destinationFactor) {
+        if (blendSource == sourceFactor && blendDestination == destinationFactor) {
+            counters.elided++;
+            return;
+        }
+        blendSource = sourceFactor;
+        blendDestination = destinationFactor;
+        counters.issued++;
+        glBlendFunc(sourceFactor, destinationFactor);
+    }
+
+    void GLStateCache::blendColor(glm::vec4 color) {
+        if (change(blendConstantColor, color)) glBlendColor(color.r, color.g, color.b, color.a);
+    }
+
+    void GLStateCache::colorMask(glm::bvec4 mask) {
+        int bits = (mask.r ? 1 : 0) | (mask.g ? 2 : 0) | (mask.b ? 4 : 0) | (mask.a ? 8 : 0);
+        if (change(colorWriteMask, bits)) glColorMask(mask.r, mask.g, mask.b, mask.a);
+    }
+
+    void GLStateCache::depthMask(bool mask) {
+        if (change(depthWriteMask, mask ? 1 : 0)) glDepthMask(mask);
+    }
+
+    void GLStateCache::forgetProgram(GLuint deletedProgram) {
+        if (program == deletedProgram) program = UNKNOWN;
+    }
+
+    void GLStateCache::forgetVertexArray(GLuint deletedVertexArray) {
+        if (vertexArray == deletedVertexArray) vertexArray = UNKNOWN;
+    }
+
+    void GLStateCache::forgetFramebuffer(GLuint deletedFramebuffer) {
+        if (framebuffer == deletedFramebuffer) framebuffer = UNKNOWN;
+    }
+
+    void GLStateCache::forgetTexture(GLuint deletedTexture) {
+        for (auto& texture : textures) {
+            if (texture == deletedTexture) texture = UNKNOWN;
+        }
+    }
+
+    void GLStateCache::forgetSampler(GLuint deletedSampler) {
+        for (auto& sampler : samplers) {
+            if (sampler == deletedSampler) sampler = UNKNOWN;
+        }
+    }
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/vec4.hpp>
+#include <cstddef>
+
+namespace our {
+
+    // The GL state cache keeps a shadow copy of the OpenGL state that the engine changes often
+    // (the bound program, vertex array, framebuffer, textures and samplers, the enabled capabilities and the pipeline parameters)
+    // and drops the calls that would set a value that is already set. Every OpenGL state change of the engine should go through it,
+    // otherwise the shadow copy would be wrong. Code that changes the state without the cache (e.g. ImGui) must call "invalidate" after it.
+    // All the functions must be called from the thread that owns the OpenGL context.
+    class GLStateCache {
+    public:
+        // The number of texture units whose bindings are tracked (units above it are always set)
+        static constexpr GLuint TRACKED_TEXTURE_UNITS = 16;
+
+        // The number of calls that reached OpenGL and the number of calls that were dropped since the last "resetCounters"
+        struct Counters {
+            size_t issued = 0;
+            size_t elided = 0;
+        };
+
+    private:
+        // A value that no real state has, so the first call after "invalidate" always reaches OpenGL
+        static constexpr GLuint UNKNOWN = ~GLuint(0);
+        // The enabled capabilities are stored as 0 (disabled), 1 (enabled) or -1 (unknown)
+        enum Capability { CULL_FACE, DEPTH_TEST, BLEND, CAPABILITY_COUNT };
+
+        GLuint program, vertexArray, framebuffer, activeUnit;
+        GLuint textures[TRACKED_TEXTURE_UNITS];
+        GLuint samplers[TRACKED_TEXTURE_UNITS];
+        int capabilities[CAPABILITY_COUNT];
+        GLenum culledFace, frontFaceWinding, depthFunction, blendEquationMode, blendSource, blendDestination;
+        glm::vec4 blendConstantColor;
+        int colorWriteMask; // The 4 color mask bits or -1 if unknown
+        int depthWriteMask; // 0, 1 or -1 if unknown
+        Counters counters;
+
+        GLStateCache() { invalidate(); }
+
+        // Returns true (and counts an issued call) if "current" differs from "value" then stores the value.
+        // Otherwise counts an elided call and returns false
+        template<typename T>
+        bool change(T& current, const T& value) {
+            if (current == value) {
+                counters.elided++;
+                return false;
+            }
+            current = value;
+            counters.issued++;
+            return true;
+        }
+
+        void setCapability(Capability capability, GLenum glCapability, bool enabled);
+
+    public:
+        // Returns the cache of the OpenGL context of the application
+        static GLStateCache& getInstance();
+
+        // Forgets the whole shadow state, the next call of every function reaches OpenGL
+        void invalidate();
+
+        void useProgram(GLuint program);
+        void bindVertexArray(GLuint vertexArray);
+        void bindFramebuffer(GLuint framebuffer);
+        // Selects the texture unit used by "bindTexture" (it takes the unit index, not GL_TEXTURE0 + index)
+        void activeTexture(GLuint unit);
+        // Binds the texture to GL_TEXTURE_2D of the active texture unit
+        void bindTexture(GLuint texture);
+        void bindSampler(GLuint unit, GLuint sampler);
+
+        void setCullFaceEnabled(bool enabled) { setCapability(CULL_FACE, GL_CULL_FACE, enabled); }
+        void setDepthTestEnabled(bool enabled) { setCapability(DEPTH_TEST, GL_DEPTH_TEST, enabled); }
+        void setBlendEnabled(bool enabled) { setCapability(BLEND, GL_BLEND, enabled); }
+        void cullFace(GLenum face);
+        void frontFace(GLenum winding);
+        void depthFunc(GLenum function);
+        void blendEquation(GLenum equation);
+        void blendFunc(GLenum sourceFactor, GLenum destinationFactor);
+        void blendColor(glm::vec4 color);
+        void colorMask(glm::bvec4 mask);
+        void depthMask(bool mask);
+
+        // These must be called before an object is deleted: OpenGL unbinds a deleted object and may give its name to a new object,
+        // so a binding of that name can not be assumed to still be current
+        void forgetProgram(GLuint program);
+        void forgetVertexArray(GLuint vertexArray);
+        void forgetFramebuffer(GLuint framebuffer);
+        void forgetTexture(GLuint texture);
+        void forgetSampler(GLuint sampler);
+
+        const Counters& getCounters() const { return counters; }
+        void resetCounters() { counters = Counters(); }
+
+        GLStateCache(const GLStateCache&) = delete;
+        GLStateCache& operator=(const GLStateCache&) = delete;
+    };
+
+}
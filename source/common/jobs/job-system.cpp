@@ -0,0 +1,120 @@
+#include "job-system.hpp"
+
+namespace our {
+
+    // The job system the current thread is a worker of (if any) and the index of its queue in that job system.
+    // The job system is stored too since a worker of one job system may submit to another one
+    static thread_local const JobSystem* currentWorkerSystem = nullptr;
+    static thread_local size_t currentWorkerIndex = 0;
+
+    JobSystem::JobSystem(size_t workerCount) {
+        // One queue per worker plus a shared queue for the threads that are not workers
+        for (size_t i = 0; i <= workerCount; i++) {
+            queues.push_back(std::make_unique<JobQueue>());
+        }
+        for (size_t i = 0; i < workerCount; i++) {
+            workers.emplace_back([this, i]() { workerLoop(i); });
+        }
+    }
+
+    JobSystem::~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        sleepCondition.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    JobSystem& JobSystem::getInstance() {
+        unsigned int cores = std::thread::hardware_concurrency();
+        // On a single core (or if the count is unknown) there are no workers and every job runs on the thread that waits for it
+        static JobSystem instance(cores > 1 ? cores - 1 : 0);
+        return instance;
+    }
+
+    size_t JobSystem::getCurrentQueue() const {
+        return currentWorkerSystem == this ? currentWorkerIndex : workers.size();
+    }
+
+    void JobSystem::submit(Job job, JobCounter* counter) {
+        if (counter != nullptr) {
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+            job = [job = std::move(job), counter]() {
+                job();
+                counter->pending.fetch_sub(1, std::memory_order_release);
+            };
+        }
+        auto& queue = *queues[getCurrentQueue()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(std::move(job));
+        }
+        {
+            // Taking the sleep lock makes sure a worker that just found no work is either
+            // already waiting (and gets notified) or will see the new job before it sleeps
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queuedJobs.fetch_add(1, std::memory_order_release);
+        }
+        sleepCondition.notify_one();
+    }
+
+    bool JobSystem::popJob(size_t queueIndex, Job& job) {
+        // First try the newest job of our own queue
+        {
+            auto& queue = *queues[queueIndex];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty()) {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+                queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        // Then steal the oldest job of another queue
+        for (size_t offset = 1; offset < queues.size(); offset++) {
+            auto& queue = *queues[(queueIndex + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty()) {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+                queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool JobSystem::runPendingJob() {
+        Job job;
+        if (!popJob(getCurrentQueue(), job)) return false;
+        job();
+        return true;
+    }
+
+    void JobSystem::wait(JobCounter& counter) {
+        while (!counter.isDone()) {
+            // Help with the work instead of blocking. If there is nothing to take, the remaining jobs are running on other threads
+            if (!runPendingJob()) std::this_thread::yield();
+        }
+    }
+
+    void JobSystem::workerLoop(size_t index) {
+        currentWorkerSystem = this;
+        currentWorkerIndex = index;
+        Job job;
+        while (true) {
+            if (popJob(index, job)) {
+                job();
+                job = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepCondition.wait(lock, [this]() { return stopping || queuedJobs.load(std::memory_order_acquire) > 0; });
+            if (stopping) return;
+        }
+    }
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace our {
+
+    // A job counter tracks a group of jobs. It is incremented when a job of the group is submitted
+    // and decremented when that job finishes, so the group is done when the counter reaches zero.
+    class JobCounter {
+        std::atomic<size_t> pending{0};
+        friend class JobSystem;
+    public:
+        JobCounter() = default;
+        // Returns true if all the jobs of the group are done
+        bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+        JobCounter(const JobCounter&) = delete;
+        JobCounter& operator=(const JobCounter&) = delete;
+    };
+
+    // The job system is a work stealing thread pool shared by the whole engine.
+    // Every worker has its own queue: it pushes and pops jobs at the back of its queue (so it works on the newest, cache-hot jobs first)
+    // and when its queue is empty, it steals the oldest job from the front of another queue.
+    // All the threads that are not workers (e.g. the main thread) share one extra queue that they submit to and pop from first,
+    // and the workers steal from it like from any other queue. "wait" runs jobs while waiting instead of blocking,
+    // so the waiting thread helps finishing the work and nested waits can not deadlock.
+    // A job system without workers is valid: the jobs stay in the shared queue till a thread waits for them (or calls "runPendingJob"),
+    // so every submitted job must be waited for.
+    class JobSystem {
+    public:
+        using Job = std::function<void()>;
+
+    private:
+        struct JobQueue {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+        };
+
+        std::vector<std::unique_ptr<JobQueue>> queues; // One queue per worker followed by the queue of the other threads
+        std::vector<std::thread> workers;
+        std::atomic<long> queuedJobs{0};      // The number of jobs waiting in all the queues (may briefly be off by the jobs being pushed)
+        std::atomic<bool> stopping{false};
+        std::mutex sleepMutex;                // Used with "sleepCondition" to let the workers sleep when there is no work
+        std::condition_variable sleepCondition;
+
+        size_t getCurrentQueue() const;       // Returns the queue of the calling thread
+        bool popJob(size_t queueIndex, Job& job); // Pops a job from the given queue or steals one from the others
+        void workerLoop(size_t index);
+
+    public:
+        // Creates a job system with its own workers. The engine uses the shared instance from "getInstance",
+        // separate job systems are meant for tests and benchmarks (e.g. to compare different worker counts)
+        explicit JobSystem(size_t workerCount);
+        ~JobSystem();
+
+        // Returns the job system of the engine (it is created with one worker per core except the main thread on first use,
+        // so it has no workers on a single core and the calling thread runs everything)
+        static JobSystem& getInstance();
+
+        // Returns the number of worker threads (the calling thread is not included)
+        size_t getWorkerCount() const { return workers.size(); }
+
+        // Submits a job. If a counter is given, it is incremented now and decremented when the job is done
+        void submit(Job job, JobCounter* counter = nullptr);
+
+        // Runs queued jobs (from any queue) on the calling thread till the counter reaches zero.
+        // Without workers, this is where the jobs of the counter run (the calling thread runs them all one after another)
+        void wait(JobCounter& counter);
+
+        // Runs one queued job on the calling thread if there is any. Returns false if there was nothing to run
+        bool runPendingJob();
+
+        // Calls "function(i)" for every i in [begin, end). The range is split into batches of "batchSize" indices
+        // that run in parallel, and the function returns after all of them are done.
+        // "function" is called concurrently so it must only write data that belongs to its own index.
+        template<typename Function>
+        void parallelFor(size_t begin, size_t end, size_t batchSize, Function&& function) {
+            if (begin >= end) return;
+            if (batchSize == 0) batchSize = 1;
+            // A single batch is not worth the round trip through the queues
+            if (end - begin <= batchSize || workers.empty()) {
+                for (size_t i = begin; i < end; i++) function(i);
+                return;
+            }
+            JobCounter counter;
+            for (size_t batchBegin = begin; batchBegin < end; batchBegin += batchSize) {
+                size_t batchEnd = batchBegin + batchSize < end ? batchBegin + batchSize : end;
+                submit([&function, batchBegin, batchEnd]() {
+                    for (size_t i = batchBegin; i < batchEnd; i++) function(i);
+                }, &counter);
+            }
+            wait(counter);
+        }
+
+        // The job system should not be copyable
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+    };
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace our {
+
+    // A triple buffer hands values from one producer thread to one consumer thread without locks and without ever making either side wait.
+    // The producer fills its buffer and publishes it, which swaps it with the shared buffer. The consumer acquires the shared buffer
+    // if a value was published since its last acquire, which swaps it with the buffer it was reading.
+    // So the producer always has a buffer to write, the consumer keeps reading its buffer till it acquires a newer one,
+    // and if the producer publishes twice before the consumer acquires, the older value is simply overwritten (the consumer gets the latest).
+    // The buffers are reused, so the containers in them keep their capacity from one value to the next.
+    template<typename T>
+    class TripleBuffer {
+        // Set in "shared" when the shared buffer holds a value that the consumer hasn't acquired yet
+        static constexpr uint8_t FRESH = 4;
+        static constexpr uint8_t INDEX_MASK = 3;
+
+        T buffers[3];
+        std::atomic<uint8_t> shared{2}; // The index of the shared buffer and the FRESH flag
+        uint8_t writeIndex = 0;          // Only used by the producer
+        uint8_t readIndex = 1;           // Only used by the consumer
+
+    public:
+        // Returns the buffer the producer writes (it belongs to the producer till "publish")
+        T& getWriteBuffer() { return buffers[writeIndex]; }
+        // Makes the written buffer the latest value and gives the producer another buffer to write
+        void publish() {
+            // Release makes the writes to the buffer visible to the consumer that acquires it
+            writeIndex = shared.exchange(writeIndex | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+
+        // Takes the latest published value if there is a new one. Returns false (and keeps the current read buffer) otherwise
+        bool acquire() {
+            // Only the producer sets the flag, so if it is set here it is still set at the exchange (maybe for an even newer value)
+            if ((shared.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+            readIndex = shared.exchange(readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+            return true;
+        }
+        // Returns the buffer the consumer reads (the value it acquired last)
+        const T& getReadBuffer() const { return buffers[readIndex]; }
+
+        // Drops the published value, so the next "acquire" fails till a new one is published.
+        // Neither the producer nor the consumer may be using the buffer at the same time
+        void reset() {
+            shared.store(shared.load(std::memory_order_relaxed) & INDEX_MASK, std::memory_order_relaxed);
+        }
+    };
+
+}
@@ -10,8 +10,12 @@ namespace our {
         //TODO: (Req 7) Write this function
         shader->use();
         pipelineState.setup();
+        setupUniforms(shader);
     }
 
+    // The base material has no uniforms
+    void Material::setupStaticUniforms(const ShaderProgram*) const {}
+
     // This function read the material data from a json object
     void Material::deserialize(const nlohmann::json& data){
         if(!data.is_object()) return;
@@ -35,12 +39,10 @@ namespace our {
         return material;
     }
 
-    // This function should call the setup of its parent and
-    // set the "tint" uniform to the value in the member variable tint 
-    void TintedMaterial::setup() const {
-        //TODO: (Req 7) Write this function
-        Material::setup();
-        shader->set("tint",tint);
+    // This function should set the "tint" uniform to the given tint
+    // (it is the member variable tint when called from "setupUniforms", or a copy of it taken earlier by the renderer)
+    void TintedMaterial::setupTint(const ShaderProgram* program, const glm::vec4& value) const {
+        program->set("tint",value);
     }
 
     // This function read the material data from a json object
@@ -60,15 +62,15 @@ namespace our {
     // This function should call the setup of its parent and
     // set the "alphaThreshold" uniform to the value in the member variable alphaThreshold
     // Then it should bind the texture and sampler to a texture unit and send the unit number to the uniform variable "tex" 
-    void TexturedMaterial::setup() const {
+    void TexturedMaterial::setupStaticUniforms(const ShaderProgram* program) const {
         //TODO: (Req 7) Write this function
-        TintedMaterial::setup();
-        shader->set("alphaThreshold",alphaThreshold);
-        glActiveTexture(GL_TEXTURE0);  //activate the texture no 0
+        TintedMaterial::setupStaticUniforms(program);
+        program->set("alphaThreshold",alphaThreshold);
+        GLStateCache::getInstance().activeTexture(0);  //activate the texture no 0
         texture->bind();                      //bind our texture data to texture no 0
         if (sampler != nullptr)
             sampler->bind(0);       //bind our sample  to texture no 0
-        shader->set("tex",0);   //set our Texture2D "tex" to use texture no 0
+        program->set("tex",0);   //set our Texture2D "tex" to use texture no 0
     }
 
     // This function read the material data from a json object
@@ -91,28 +93,38 @@ namespace our {
     }
 
 
-    void DefaultMaterial::setup() const {
-        Material::setup();
-        shader->set("material.tint" , this->tint);
-        shader->set("material.emission" , emission);
+    void DefaultMaterial::setupStaticUniforms(const ShaderProgram* program) const {
+        Material::setupStaticUniforms(program);
+        program->set("material.emission" , emission);
 
         if (texture != nullptr){
-            glActiveTexture(GL_TEXTURE0);
+            GLStateCache::getInstance().activeTexture(0);
             texture->bind();
             if (sampler != nullptr){
                 sampler->bind(0);
             }
-            shader->set("material.hasTexture" , (GLint) 1);
-            shader->set("material.tex",0);   //set our Texture2D "tex" to use texture no 0
+            program->set("material.hasTexture" , (GLint) 1);
+            program->set("material.tex",0);   //set our Texture2D "tex" to use texture no 0
         }else{
-            shader->set("material.hasTexture" , (GLint) 0);
+            program->set("material.hasTexture" , (GLint) 0);
         }
 
-        shader->set("isSkybox" , isSkybox ? (GLint) 1 : (GLint) 0);
-        shader->set("material.ambientReflectivity" , ambientReflectivity);
-        shader->set("material.diffuseReflectivity" , diffuseReflectivity);
-        shader->set("material.specularReflectivity" , specularReflectivity);
-        shader->set("material.specularIntensity" , specularIntensity);
+        program->set("isSkybox" , isSkybox ? (GLint) 1 : (GLint) 0);
+        program->set("material.ambientReflectivity" , ambientReflectivity);
+        program->set("material.diffuseReflectivity" , diffuseReflectivity);
+        program->set("material.specularReflectivity" , specularReflectivity);
+        program->set("material.specularIntensity" , specularIntensity);
+    }
+
+    void DefaultMaterial::setupTint(const ShaderProgram* program, const glm::vec4& value) const {
+        program->set("material.tint" , value);
+    }
+
+    bool DefaultMaterial::isInstanceCompatible(const DefaultMaterial& other) const {
+        return shader == other.shader && pipelineState == other.pipelineState && transparent == other.transparent &&
+               texture == other.texture && sampler == other.sampler && isSkybox == other.isSkybox &&
+               ambientReflectivity == other.ambientReflectivity && diffuseReflectivity == other.diffuseReflectivity &&
+               specularReflectivity == other.specularReflectivity && specularIntensity == other.specularIntensity && emission == other.emission;
     }
 
     void DefaultMaterial::deserialize(const nlohmann::json &data) {
@@ -146,15 +158,15 @@ namespace our {
     }
 
 
-    void MultiTexturedMaterial::setup() const {
-        TintedMaterial::setup();
+    void MultiTexturedMaterial::setupStaticUniforms(const ShaderProgram* program) const {
+        TintedMaterial::setupStaticUniforms(program);
 
         for (GLint i = 0; i < textures.size(); i++) {
-            glActiveTexture(GL_TEXTURE0 + i);
+            GLStateCache::getInstance().activeTexture(i);
             textures[i]->bind();
             if (samplers[i] != nullptr)
                 samplers[i]->bind(i);
-            shader->set(std::string("tex_").append(std::to_string(i)),
+            program->set(std::string("tex_").append(std::to_string(i)),
                         i);
         }
     }
@@ -24,8 +24,24 @@ namespace our {
         ShaderProgram* shader;
         bool transparent;
         
-        // This function does 2 things: setup the pipeline state and set the shader program to be used
-        virtual void setup() const;
+        // This function does 3 things: setup the pipeline state, set the shader program to be used and send the material uniforms.
+        // The renderer can do these steps separately (see "setupUniforms") to skip the ones that didn't change since the previous draw
+        void setup() const;
+        // This function sends the uniforms of this material to the given program and binds its textures (the program must already be in use).
+        // The program is usually "shader" but the renderer may draw the material with a variant of it (e.g. an instanced one).
+        void setupUniforms(const ShaderProgram* program) const {
+            setupStaticUniforms(program);
+            setupTint(program, getTint());
+        }
+        // Sends the uniforms of this material except the tint and binds its textures.
+        // The tint is the only value of a material that the systems change while the game runs (e.g. to highlight a block),
+        // so these uniforms can be sent while the systems run, as the renderer does when it submits a frame packet.
+        // Materials that send uniforms to the shader override it (and call the function of their parent first)
+        virtual void setupStaticUniforms(const ShaderProgram* program) const;
+        // Returns the tint of the material (white for the materials that have no tint)
+        virtual glm::vec4 getTint() const { return glm::vec4(1.0f); }
+        // Sends the given tint to the tint uniform of the material (the materials that have no tint ignore it)
+        virtual void setupTint(const ShaderProgram*, const glm::vec4&) const {}
         // This function read a material from a json object
         virtual void deserialize(const nlohmann::json& data);
 
@@ -39,7 +55,8 @@ namespace our {
     public:
         glm::vec4 tint;
 
-        void setup() const override;
+        glm::vec4 getTint() const override { return tint; }
+        void setupTint(const ShaderProgram* program, const glm::vec4& value) const override;
         void deserialize(const nlohmann::json& data) override;
         TintedMaterial* copy() override;
     };
@@ -55,7 +72,7 @@ namespace our {
         Sampler* sampler;
         float alphaThreshold;
 
-        void setup() const override;
+        void setupStaticUniforms(const ShaderProgram* program) const override;
         void deserialize(const nlohmann::json& data) override;
         TexturedMaterial* copy() override;
     };
@@ -65,7 +82,7 @@ namespace our {
         std::vector<Texture2D*> textures;
         std::vector<Sampler*> samplers;
 
-        void setup() const override;
+        void setupStaticUniforms(const ShaderProgram* program) const override;
         void deserialize(const nlohmann::json& data) override;
         MultiTexturedMaterial* copy() override;
     };
@@ -82,7 +99,13 @@ namespace our {
         bool isSkybox;
         glm::vec4 tint;
 
-        void setup() const override;
+        // Returns true if drawing with this material and the other one only differs by the tint,
+        // so draws of both materials can be merged in one instanced draw with a tint per instance
+        bool isInstanceCompatible(const DefaultMaterial& other) const;
+
+        void setupStaticUniforms(const ShaderProgram* program) const override;
+        glm::vec4 getTint() const override { return tint; }
+        void setupTint(const ShaderProgram* program, const glm::vec4& value) const override;
         void deserialize(const nlohmann::json& data) override;
         DefaultMaterial* copy() override;
     };
@@ -1,39 +1,52 @@
 #include "pipeline-state.hpp"
 #include "../deserialize-utils.hpp"
+#include "../gl-state-cache.hpp"
 
 namespace our {
     void PipelineState::setup() const {
+        // The state cache drops the calls that set what is already set (e.g. when two materials share most of their options)
+        auto& state = GLStateCache::getInstance();
+
         //  face culling
+        state.setCullFaceEnabled(faceCulling.enabled);
         if (faceCulling.enabled) {
-            glEnable(GL_CULL_FACE);
-            glCullFace(faceCulling.culledFace);
-            glFrontFace(faceCulling.frontFace);
-        } else {
-            glDisable(GL_CULL_FACE);
+            state.cullFace(faceCulling.culledFace);
+            state.frontFace(faceCulling.frontFace);
         }
 
         //depth testing
+        state.setDepthTestEnabled(depthTesting.enabled);
         if (depthTesting.enabled) {
-            glEnable(GL_DEPTH_TEST);
-            glDepthFunc(depthTesting.function);
-        } else {
-            glDisable(GL_DEPTH_TEST);
+            state.depthFunc(depthTesting.function);
         }
 
         // blending
+        state.setBlendEnabled(blending.enabled);
         if (blending.enabled) {
-            glEnable(GL_BLEND);
-            glBlendEquation(blending.equation);
-            glBlendFunc(blending.sourceFactor, blending.destinationFactor);
-            glBlendColor(blending.constantColor.r, blending.constantColor.g, blending.constantColor.b, blending.constantColor.a);
-        } else {
-            glDisable(GL_BLEND);
+            state.blendEquation(blending.equation);
+            state.blendFunc(blending.sourceFactor, blending.destinationFactor);
+            state.blendColor(blending.constantColor);
         }
 
         // setcolor and depth mask
-        glColorMask(colorMask.r, colorMask.g, colorMask.b, colorMask.a);
-        glDepthMask(depthMask);
+        state.colorMask(colorMask);
+        state.depthMask(depthMask);
     }
+
+    bool PipelineState::operator==(const PipelineState& other) const {
+        if (faceCulling.enabled != other.faceCulling.enabled) return false;
+        if (faceCulling.enabled && (faceCulling.culledFace != other.faceCulling.culledFace || faceCulling.frontFace != other.faceCulling.frontFace)) return false;
+
+        if (depthTesting.enabled != other.depthTesting.enabled) return false;
+        if (depthTesting.enabled && depthTesting.function != other.depthTesting.function) return false;
+
+        if (blending.enabled != other.blending.enabled) return false;
+        if (blending.enabled && (blending.equation != other.blending.equation || blending.sourceFactor != other.blending.sourceFactor ||
+                                 blending.destinationFactor != other.blending.destinationFactor || blending.constantColor != other.blending.constantColor)) return false;
+
+        return colorMask == other.colorMask && depthMask == other.depthMask;
+    }
+
     // Given a json object, this function deserializes a PipelineState structure
     void PipelineState::deserialize(const nlohmann::json& data){
         // If the given json data does not represent a json object, return
@@ -42,6 +42,10 @@ namespace our {
         // For example, if faceCulling.enabled is true, you should call glEnable(GL_CULL_FACE), otherwise, you should call glDisable(GL_CULL_FACE)
         void setup() const ;
 
+        // Two pipeline states are equal if they configure OpenGL the same way (the renderer uses it to group draws by state)
+        bool operator==(const PipelineState& other) const;
+        bool operator!=(const PipelineState& other) const { return !(*this == other); }
+
         // Given a json object, this function deserializes a PipelineState structure
         void deserialize(const nlohmann::json& data);
     };
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "vertex.hpp"
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cfloat>
+
+namespace our {
+
+    // An axis aligned bounding box stored as its center and its half size (extent)
+    struct AABB {
+        glm::vec3 center = glm::vec3(0.0f);
+        glm::vec3 extent = glm::vec3(0.0f);
+
+        // Returns the box containing this box after transforming it by the given (affine) matrix.
+        // The center is transformed as a point and the extent by the absolute value of the rotation/scale part of the matrix (Arvo's method)
+        AABB transformed(const glm::mat4& matrix) const {
+            AABB result;
+            result.center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+            glm::mat3 absolute = glm::mat3(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2])));
+            result.extent = absolute * extent;
+            return result;
+        }
+    };
+
+    // A bounding sphere
+    struct BoundingSphere {
+        glm::vec3 center = glm::vec3(0.0f);
+        float radius = 0.0f;
+    };
+
+    // The bounding volumes of a mesh (or of one of its shapes) in the local space of the mesh
+    struct Bounds {
+        AABB box;
+        BoundingSphere sphere;
+    };
+
+    // Computes the bounds of the vertices referenced by elements[first]...elements[last].
+    // The sphere is centered on the box and its radius reaches the farthest vertex (it is tighter than the sphere around the box)
+    inline Bounds computeBounds(const std::vector<Vertex>& vertices, const std::vector<GLuint>& elements, size_t first, size_t last) {
+        Bounds bounds;
+        if (elements.empty() || first > last) return bounds;
+
+        glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+        for (size_t i = first; i <= last; i++) {
+            const glm::vec3& position = vertices[elements[i]].position;
+            minimum = glm::min(minimum, position);
+            maximum = glm::max(maximum, position);
+        }
+        bounds.box.center = (minimum + maximum) * 0.5f;
+        bounds.box.extent = (maximum - minimum) * 0.5f;
+
+        float radius2 = 0.0f;
+        for (size_t i = first; i <= last; i++) {
+            glm::vec3 offset = vertices[elements[i]].position - bounds.box.center;
+            radius2 = glm::max(radius2, glm::dot(offset, offset));
+        }
+        bounds.sphere.center = bounds.box.center;
+        bounds.sphere.radius = glm::sqrt(radius2);
+        return bounds;
+    }
+
+}
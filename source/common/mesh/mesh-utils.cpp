@@ -4,6 +4,8 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tinyobj/tiny_obj_loader.h>
 
+#include "../jobs/job-system.hpp"
+
 #include <iostream>
 #include <vector>
 #include <unordered_map>
@@ -40,37 +42,52 @@ our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename) {
     //TODO: maybe add material implementation or something ..
     std::vector<std::pair<unsigned int ,unsigned int>> shapes_ids; //defines the start & end index of each shape
 
+    // First, we read the data of every vertex from the "attrib" object. Each vertex is independent so this runs in parallel
+    std::vector<tinyobj::index_t> indices;
     for (const auto &shape : shapes) {
-        unsigned int start = elements.size();
-        for (const auto &index : shape.mesh.indices) {
-            Vertex vertex = {};
-            // Read the data for a vertex from the "attrib" object
-            vertex.position = {
-                    attrib.vertices[3 * index.vertex_index + 0],
-                    attrib.vertices[3 * index.vertex_index + 1],
-                    attrib.vertices[3 * index.vertex_index + 2]
+        indices.insert(indices.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+    }
+    std::vector<Vertex> raw_vertices(indices.size());
+    our::JobSystem::getInstance().parallelFor(0, indices.size(), 4096, [&](size_t i) {
+        const auto &index = indices[i];
+        Vertex vertex = {};
+        // Read the data for a vertex from the "attrib" object
+        vertex.position = {
+                attrib.vertices[3 * index.vertex_index + 0],
+                attrib.vertices[3 * index.vertex_index + 1],
+                attrib.vertices[3 * index.vertex_index + 2]
+        };
+
+        vertex.normal = {
+                attrib.normals[3 * index.normal_index + 0],
+                attrib.normals[3 * index.normal_index + 1],
+                attrib.normals[3 * index.normal_index + 2]
+        };
+
+        if (index.texcoord_index >= 0) {
+            vertex.tex_coord = {
+                    attrib.texcoords[2 * index.texcoord_index + 0],
+                    attrib.texcoords[2 * index.texcoord_index + 1]
             };
+        }
 
-            vertex.normal = {
-                    attrib.normals[3 * index.normal_index + 0],
-                    attrib.normals[3 * index.normal_index + 1],
-                    attrib.normals[3 * index.normal_index + 2]
-            };
 
-            if (index.texcoord_index >= 0) {
-                vertex.tex_coord = {
-                        attrib.texcoords[2 * index.texcoord_index + 0],
-                        attrib.texcoords[2 * index.texcoord_index + 1]
-                };
-            }
+        vertex.color = {
+                attrib.colors[3 * index.vertex_index + 0] * 255,
+                attrib.colors[3 * index.vertex_index + 1] * 255,
+                attrib.colors[3 * index.vertex_index + 2] * 255,
+                255
+        };
 
+        raw_vertices[i] = vertex;
+    });
 
-            vertex.color = {
-                    attrib.colors[3 * index.vertex_index + 0] * 255,
-                    attrib.colors[3 * index.vertex_index + 1] * 255,
-                    attrib.colors[3 * index.vertex_index + 2] * 255,
-                    255
-            };
+    // Then we remove the duplicated vertices. This pass is sequential to keep the same vertex order as before
+    size_t raw_index = 0;
+    for (const auto &shape : shapes) {
+        unsigned int start = elements.size();
+        for (size_t i = 0; i < shape.mesh.indices.size(); i++) {
+            const Vertex &vertex = raw_vertices[raw_index++];
 
             // See if we already stored a similar vertex
             auto it = vertex_map.find(vertex);
@@ -91,6 +108,10 @@ our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename) {
     std::cout << "Loaded : " << elements.size() << " elements, with : " << shapes_ids.size() << " Shapes" << std::endl;
     auto k = new our::Mesh(vertices, elements);
     k->shapes = shapes_ids;
+    k->bounds = our::computeBounds(vertices, elements, 0, elements.size() - 1);
+    for (const auto &[start, end] : shapes_ids) {
+        k->shapeBounds.push_back(our::computeBounds(vertices, elements, start, end));
+    }
     return k;
 }
 
@@ -129,5 +150,7 @@ our::Mesh* our::mesh_utils::sphere(const glm::ivec2& segments){
         }
     }
 
-    return new our::Mesh(vertices, elements);
+    auto mesh = new our::Mesh(vertices, elements);
+    mesh->bounds = our::computeBounds(vertices, elements, 0, elements.size() - 1);
+    return mesh;
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <glad/gl.h>
 #include "vertex.hpp"
+#include "bounds.hpp"
+#include "../gl-state-cache.hpp"
 #include "tinyobj/tiny_obj_loader.h"
 
 namespace our {
@@ -10,6 +12,10 @@ namespace our {
     #define ATTRIB_LOC_COLOR    1
     #define ATTRIB_LOC_TEXCOORD 2
     #define ATTRIB_LOC_NORMAL   3
+    // The per instance attribute used by instanced draws: the index of the object of each instance in the object data (see "default-instanced.vert")
+    #define ATTRIB_LOC_INSTANCE_OBJECT    4
+    // The per vertex tint of the static batches (see "Mesh::setTintBuffer")
+    #define ATTRIB_LOC_INSTANCE_TINT      8
 
     class Mesh {
         // Here, we store the object names of the 3 main components of a mesh:
@@ -18,9 +24,22 @@ namespace our {
         unsigned int VAO;
         // We need to remember the number of elements that will be draw by glDrawElements
         GLsizei elementCount;
+        // The instance buffer that the instance attributes of the vertex array read from (0 if they were never set)
+        GLuint instanceBuffer = 0;
     public:
 
         std::vector<std::pair<unsigned int ,unsigned int>> shapes; //defines the start & end index of each shape
+
+        // The bounds of the whole mesh and of each shape (in the local space), used by the renderer to skip invisible objects.
+        // They are filled by the functions of mesh_utils that create the mesh
+        Bounds bounds;
+        std::vector<Bounds> shapeBounds;
+
+        // Returns the bounds of the given shape (or of the whole mesh if id is -1)
+        const Bounds& getBounds(int id = -1) const
+        {
+            return id == -1 || id >= (int) shapeBounds.size() ? bounds : shapeBounds[id];
+        }
         std::vector<tinyobj::material_t> materials;
 
         // The constructor takes two vectors:
@@ -36,7 +55,7 @@ namespace our {
             // remember to store the number of elements in "elementCount" since you will need it for drawing
             // For the attribute locations, use the constants defined above: ATTRIB_LOC_POSITION, ATTRIB_LOC_COLOR, etc
             glGenVertexArrays(1, &VAO);
-            glBindVertexArray(VAO);
+            GLStateCache::getInstance().bindVertexArray(VAO);
             glGenBuffers(1, &VBO);
             glBindBuffer(GL_ARRAY_BUFFER, VBO);
             glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
@@ -60,7 +79,7 @@ namespace our {
 
             // Unbind the Vertex array
             // To prevent  other meshes from Adding data to this VAO
-            glBindVertexArray(0);
+            GLStateCache::getInstance().bindVertexArray(0);
 
             // Unbind Vertex buffer and element buffer
             // it is optional because just binding a new buffer unbind previous one
@@ -74,28 +93,86 @@ namespace our {
         {
             //TODO: (Req 2) Write this function
 
-            int count = elementCount;
-            unsigned long long offset = 0;
+            int count;
+            unsigned long long offset;
+            getRange(id, count, offset);
 
-            if (id != -1){
-                auto shape = shapes[id];
-                count = shape.second - shape.first + 1;
-                offset = (unsigned long long) (shape.first * sizeof( unsigned int));
+            // The vertex array stays bound after the draw so that drawing the same mesh again doesn't rebind it
+            GLStateCache::getInstance().bindVertexArray(VAO);
+            glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, (void *) offset);
+        }
+
+        // This function renders "instanceCount" instances of the mesh (or of one of its shapes) with one draw call.
+        // The instances are read from "buffer" which must contain an array of uint32_t (the object index of every instance),
+        // and the vertex shader must read it from the ATTRIB_LOC_INSTANCE_OBJECT attribute (see "default-instanced.vert")
+        void drawInstanced(int id, GLsizei instanceCount, GLuint buffer)
+        {
+            int count;
+            unsigned long long offset;
+            getRange(id, count, offset);
+
+            GLStateCache::getInstance().bindVertexArray(VAO);
+            // The instance attribute is part of the vertex array, so it is only set the first time (or if the buffer changes)
+            if (instanceBuffer != buffer){
+                glBindBuffer(GL_ARRAY_BUFFER, buffer);
+                glEnableVertexAttribArray(ATTRIB_LOC_INSTANCE_OBJECT);
+                glVertexAttribIPointer(ATTRIB_LOC_INSTANCE_OBJECT, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*) 0);
+                glVertexAttribDivisor(ATTRIB_LOC_INSTANCE_OBJECT, 1);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+                instanceBuffer = buffer;
             }
+            glDrawElementsInstanced(GL_TRIANGLES, count, GL_UNSIGNED_INT, (void *) offset, instanceCount);
+        }
 
-            glBindVertexArray(VAO);
-            glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, (void *) offset);
-            glBindVertexArray(0);
+        // Makes the vertex array read a tint per vertex from "buffer" (an array of glm::vec4 with one tint for every vertex).
+        // It uses the location of the instance tint without a divisor, so it is meant for meshes that are never drawn instanced
+        // (e.g. the static batches, see "default-batched.vert")
+        void setTintBuffer(GLuint buffer)
+        {
+            GLStateCache::getInstance().bindVertexArray(VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glEnableVertexAttribArray(ATTRIB_LOC_INSTANCE_TINT);
+            glVertexAttribPointer(ATTRIB_LOC_INSTANCE_TINT, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*) 0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        // Reads the vertex & element data back from the VRAM (the mesh doesn't keep a copy on the RAM).
+        // This stalls till the GPU is done with the buffers, so it should only be used while loading
+        void readBack(std::vector<Vertex>& vertices, std::vector<unsigned int>& elements) const
+        {
+            GLint size = 0;
+            glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+            glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+            vertices.resize(size / sizeof(Vertex));
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, vertices.size() * sizeof(Vertex), vertices.data());
+            // The element buffer is read through the copy target too since binding it to GL_ELEMENT_ARRAY_BUFFER would change the bound vertex array
+            glBindBuffer(GL_COPY_READ_BUFFER, EBO);
+            elements.resize(elementCount);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, elements.size() * sizeof(unsigned int), elements.data());
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
         }
 
         // this function should delete the vertex & element buffers and the vertex array object
         ~Mesh(){
             //TODO: (Req 2) Write this function
+            GLStateCache::getInstance().forgetVertexArray(VAO);
             glDeleteVertexArrays(1, &VAO);
             glDeleteBuffers(1, &VBO);
             glDeleteBuffers(1, &EBO);
         }
 
+        // Returns the element count and the byte offset of the given shape (or of the whole mesh if id is -1)
+        void getRange(int id, int& count, unsigned long long& offset) const
+        {
+            count = elementCount;
+            offset = 0;
+            if (id != -1){
+                auto shape = shapes[id];
+                count = shape.second - shape.first + 1;
+                offset = (unsigned long long) (shape.first * sizeof( unsigned int));
+            }
+        }
+
         Mesh(Mesh const &) = delete;
         Mesh &operator=(Mesh const &) = delete;
     };
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <utility>
+
+namespace our {
+
+    // An item to sort with "radixSort": a 64-bit key and the index of the sorted object in its own array
+    struct SortItem {
+        std::uint64_t key;
+        std::uint32_t index;
+    };
+
+    // Sorts the items by their keys (ascending and stable) using a least significant digit radix sort with 8-bit digits.
+    // The histograms of all the digits are computed in one pass over the items, then every digit that is not the same
+    // for all the items is scattered into "scratch" (the two buffers swap roles after each pass).
+    // Skipping the constant digits matters here since render keys usually have few distinct values in their high bits.
+    // "scratch" is only used as a buffer, passing the same vector every frame avoids reallocating it.
+    inline void radixSort(std::vector<SortItem>& items, std::vector<SortItem>& scratch) {
+        constexpr int DIGITS = 8;
+        constexpr int BUCKETS = 256;
+        const size_t count = items.size();
+        if (count < 2) return;
+        scratch.resize(count);
+
+        size_t histograms[DIGITS][BUCKETS] = {};
+        for (const auto& item : items) {
+            for (int digit = 0; digit < DIGITS; digit++) {
+                histograms[digit][(item.key >> (digit * 8)) & 0xFF]++;
+            }
+        }
+
+        for (int digit = 0; digit < DIGITS; digit++) {
+            auto& histogram = histograms[digit];
+            // If all the items have the same digit, this pass wouldn't change the order
+            if (histogram[(items[0].key >> (digit * 8)) & 0xFF] == count) continue;
+
+            // Turn the counts into the start offset of each bucket
+            size_t offset = 0;
+            for (auto& bucket : histogram) {
+                size_t bucketCount = bucket;
+                bucket = offset;
+                offset += bucketCount;
+            }
+            for (const auto& item : items) {
+                scratch[histogram[(item.key >> (digit * 8)) & 0xFF]++] = item;
+            }
+            std::swap(items, scratch);
+        }
+    }
+
+    // Maps a float to an unsigned integer with the same order, so floats can be sorted as integer keys.
+    // Positive floats get their sign bit set and negative floats get all their bits flipped (their bits grow as they get smaller)
+    inline std::uint32_t floatSortKey(float value) {
+        value += 0.0f; // -0 becomes +0 so that equal floats get equal keys
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+    }
+
+    // Sorts items that are almost sorted already (ascending and stable) with an insertion sort.
+    // It gives up after "maxShifts" moves and returns false, then the items are still a permutation of the input but not sorted.
+    inline bool insertionSort(std::vector<SortItem>& items, size_t maxShifts) {
+        size_t shifts = 0;
+        for (size_t i = 1; i < items.size(); i++) {
+            SortItem item = items[i];
+            size_t j = i;
+            for (; j > 0 && items[j - 1].key > item.key; j--) {
+                items[j] = items[j - 1];
+                if (++shifts > maxShifts) {
+                    items[j - 1] = item;
+                    return false;
+                }
+            }
+            items[j] = item;
+        }
+        return true;
+    }
+
+}
@@ -1,4 +1,5 @@
 #include "shader.hpp"
+#include "uniform-blocks.hpp"
 
 #include <iostream>
 #include <fstream>
@@ -8,7 +9,7 @@
 std::string checkForShaderCompilationErrors(GLuint shader);
 std::string checkForLinkingErrors(GLuint program);
 
-bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const
+bool our::ShaderProgram::attach(const std::string &filename, GLenum type)
 {
     // Here, we open the file and read a string from it containing the GLSL code of our shader
     std::ifstream file(filename);
@@ -18,9 +19,17 @@ bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const
         return false;
     }
     std::string sourceString = std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
-    const char *sourceCStr = sourceString.c_str();
     file.close();
 
+    if (!attachSource(sourceString, type)) return false;
+    attachedFiles[type] = filename;
+    return true;
+}
+
+bool our::ShaderProgram::attachSource(const std::string &sourceString, GLenum type)
+{
+    const char *sourceCStr = sourceString.c_str();
+
     // TODO: Complete this function
     // Note: The function "checkForShaderCompilationErrors" checks if there is
     //  an error in the given shader. You should use it to check if there is a
@@ -54,7 +63,7 @@ bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const
     return true;
 }
 
-bool our::ShaderProgram::link() const
+bool our::ShaderProgram::link()
 {
     // TODO: Complete this function
     // Note: The function "checkForLinkingErrors" checks if there is
@@ -71,9 +80,77 @@ bool our::ShaderProgram::link() const
         std::cerr << "ERROR: Shader program linking failed: " << errorLog << std::endl;
         return false;
     }
+
+    // Cache the uniform locations now so that setting a uniform never has to ask the driver
+    reflectUniforms();
+
+    // Connect the shared uniform blocks (if this program uses them) to their binding points
+    for (const auto& block : UNIFORM_BLOCK_BINDINGS)
+    {
+        GLuint blockIndex = glGetUniformBlockIndex(program, block.name);
+        if (blockIndex != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(program, blockIndex, block.bindingPoint);
+        }
+    }
+
+    // Same for the shared texture buffers, their samplers are set to their texture units once
+    for (const auto& binding : TEXTURE_BUFFER_BINDINGS)
+    {
+        GLint location = getUniformLocation(binding.name);
+        if (location != -1)
+        {
+            use();
+            set(location, (GLint) binding.textureUnit);
+        }
+    }
     return true;
 }
 
+void our::ShaderProgram::addUniformLocation(const std::string &name, GLint location)
+{
+    uniformNames.push_back(name);
+    uniformLocations[uniformNames.back()] = location;
+}
+
+void our::ShaderProgram::reflectUniforms()
+{
+    uniformLocations.clear();
+    uniformNames.clear();
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::string buffer(maxLength > 0 ? maxLength : 1, '\0');
+
+    for (GLint i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, (GLuint) i, (GLsizei) buffer.size(), &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), length);
+
+        // Uniforms inside a uniform block have no location (they are set through a buffer)
+        GLint location = glGetUniformLocation(program, name.c_str());
+        if (location == -1) continue;
+        addUniformLocation(name, location);
+
+        // An array of basic types is reported once as "name[0]" (arrays of structs are reported member by member instead),
+        // so its other elements and its plain name are added here
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+        {
+            std::string base = name.substr(0, name.size() - 3);
+            addUniformLocation(base, location);
+            for (GLint element = 1; element < size; element++)
+            {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                addUniformLocation(elementName, glGetUniformLocation(program, elementName.c_str()));
+            }
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////
 // Function to check for compilation and linking error in shaders //
 ////////////////////////////////////////////////////////////////////
@@ -2,12 +2,16 @@
 #define SHADER_HPP
 
 #include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
 
 #include <glad/gl.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include "../../globals.h"
+#include "../gl-state-cache.hpp"
 
 
 namespace our
@@ -19,6 +23,18 @@ namespace our
         // Shader Program Handle (OpenGL object name)
         GLuint program;
 
+        // The locations of all the active uniforms, filled by "link" using glGetActiveUniform.
+        // The keys point into "uniformNames" (a deque never moves its strings) so that a lookup does not need to construct a std::string.
+        std::deque<std::string> uniformNames;
+        std::unordered_map<std::string_view, GLint> uniformLocations;
+
+        // Reads the active uniforms of the linked program into "uniformLocations"
+        void reflectUniforms();
+        void addUniformLocation(const std::string& name, GLint location);
+
+        // The file of every attached shader stage (used to build variants of this program, e.g. an instanced one)
+        std::unordered_map<GLenum, std::string> attachedFiles;
+
     public:
         ShaderProgram()
         {
@@ -29,111 +45,104 @@ namespace our
         {
             // TODO: (Req 1) Delete a shader program
             if (program != 0)
+            {
+                GLStateCache::getInstance().forgetProgram(program);
                 glDeleteProgram(program);
+            }
         }
 
-        [[nodiscard]] bool attach(const std::string &filename, GLenum type) const;
+        [[nodiscard]] bool attach(const std::string &filename, GLenum type);
+        // Compiles the given GLSL code and attaches it (used for generated shaders, so no file is recorded for the stage)
+        [[nodiscard]] bool attachSource(const std::string &source, GLenum type);
+
+        // Returns the file that was attached for the given stage (GL_VERTEX_SHADER, GL_FRAGMENT_SHADER) or an empty string
+        [[nodiscard]] std::string getAttachedFile(GLenum type) const
+        {
+            auto it = attachedFiles.find(type);
+            return it == attachedFiles.end() ? std::string() : it->second;
+        }
 
-        [[nodiscard]] bool link() const;
+        // Links the program then reflects its active uniforms (so it must be called again if the program is relinked)
+        [[nodiscard]] bool link();
 
         void use() const
         {
-            glUseProgram(program);
+            GLStateCache::getInstance().useProgram(program);
         }
 
-        [[nodiscard]] GLint getUniformLocation(const std::string &name) const
+        // Returns the location of the uniform with the given name or -1 if the program has no active uniform with that name.
+        // The location comes from the table filled at link time, so no driver call is made.
+        // Hot call sites should call this once and keep the location instead of passing the name every time.
+        [[nodiscard]] GLint getUniformLocation(std::string_view name) const
         {
             // TODO: (Req 1) Return the location of the uniform with the given name
-            return glGetUniformLocation(program, name.c_str());
+            auto it = uniformLocations.find(name);
+            return it == uniformLocations.end() ? -1 : it->second;
         }
 
-        void set(const std::string &uniform, GLfloat value) const
+        // Returns the location of the uniform or -1 after reporting the missing uniform (unless the errors are suppressed)
+        [[nodiscard]] GLint getCheckedUniformLocation(std::string_view uniform) const
         {
-            // TODO: (Req 1) Send the given float value to the given uniform
-            GLint loc = getUniformLocation(uniform);
-            if (loc == -1 && !SUPPRESS_SHADER_ERRORS){
+            GLint location = getUniformLocation(uniform);
+            if (location == -1 && !SUPPRESS_SHADER_ERRORS)
+            {
                 std::cerr << "Uniform '" << uniform << "' does not exist in the shader program." << std::endl;
-                return;
             }
-            glUniform1f(loc, value);
+            return location;
         }
 
-        void set(const std::string &uniform, GLuint value) const
+        void set(std::string_view uniform, GLfloat value) const
         {
-            // TODO: (Req 1) Send the given unsigned integer value to the given uniform
-            // Get the location of the uniform
-            GLint location = getUniformLocation(uniform);
+            // TODO: (Req 1) Send the given float value to the given uniform
+            set(getCheckedUniformLocation(uniform), value);
+        }
 
-            // Check if the uniform exists
-            if (location == -1 && !SUPPRESS_SHADER_ERRORS)
-            {
-                std::cerr << "Uniform '" << uniform << "' does not exist in the shader program." << std::endl;
-                return;
-            }
-            // Send the value to the uniform
-            glUniform1ui(location, value);
+        void set(std::string_view uniform, GLuint value) const
+        {
+            // TODO: (Req 1) Send the given unsigned integer value to the given uniform
+            set(getCheckedUniformLocation(uniform), value);
         }
 
-        void set(const std::string &uniform, GLint value) const
+        void set(std::string_view uniform, GLint value) const
         {
             // TODO: (Req 1) Send the given integer value to the given uniform
-            GLint location = getUniformLocation(uniform);
-            if (location == -1 && !SUPPRESS_SHADER_ERRORS)
-            {
-                std::cerr << "Uniform '" << uniform << "' does not exist in the shader program." << std::endl;
-                return;
-            }
-            glUniform1i(location, value);
+            set(getCheckedUniformLocation(uniform), value);
         }
 
-        void set(const std::string &uniform, glm::vec2 value) const
+        void set(std::string_view uniform, glm::vec2 value) const
         {
             // TODO: (Req 1) Send the given 2D vector value to the given uniform
-            GLint location = getUniformLocation(uniform);
-            if (location == -1 && !SUPPRESS_SHADER_ERRORS)
-            {
-                std::cerr << "Uniform '" << uniform << "' does not exist in the shader program." << std::endl;
-                return;
-            }
-            glUniform2f(location, (float) value.x, (float) value.y);
+            set(getCheckedUniformLocation(uniform), value);
         }
 
-        void set(const std::string &uniform, glm::vec3 value) const
+        void set(std::string_view uniform, glm::vec3 value) const
         {
             // TODO: (Req 1) Send the given 3D vector value to the given uniform
-            GLint location = getUniformLocation(uniform);
-            if (location == -1 && !SUPPRESS_SHADER_ERRORS)
-            {
-                std::cerr << "Uniform '" << uniform << "' does not exist in the shader program." << std::endl;
-                return;
-            }
-            glUniform3f(location, value.x, value.y, value.z);
+            set(getCheckedUniformLocation(uniform), value);
         }
 
-        void set(const std::string &uniform, glm::vec4 value) const
+        void set(std::string_view uniform, glm::vec4 value) const
         {
             // TODO: (Req 1) Send the given 4D vector value to the given uniform
-            GLint location = getUniformLocation(uniform);
-            if (location == -1 && !SUPPRESS_SHADER_ERRORS)
-            {
-                std::cerr << "Uniform '" << uniform << "' does not exist in the shader program." << std::endl;
-                return;
-            }
-            glUniform4f(location, value.x, value.y, value.z, value.w);
+            set(getCheckedUniformLocation(uniform), value);
         }
 
-        void set(const std::string &uniform, glm::mat4 matrix) const
+        void set(std::string_view uniform, const glm::mat4& matrix) const
         {
             // TODO: (Req 1) Send the given matrix 4x4 value to the given uniform
-            GLint location = getUniformLocation(uniform);
-            if (location == -1 && !SUPPRESS_SHADER_ERRORS)
-            {
-                std::cerr << "Uniform '" << uniform << "' does not exist in the shader program." << std::endl;
-                return;
-            }
-            glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(matrix));
+            set(getCheckedUniformLocation(uniform), matrix);
         }
 
+        // These overloads take a location returned by "getUniformLocation".
+        // A location of -1 is silently ignored (by OpenGL itself), so a shader that doesn't use a uniform can still be given a value for it.
+        void set(GLint location, GLfloat value) const { if (location != -1) glUniform1f(location, value); }
+        void set(GLint location, GLuint value) const { if (location != -1) glUniform1ui(location, value); }
+        void set(GLint location, GLint value) const { if (location != -1) glUniform1i(location, value); }
+        void set(GLint location, glm::vec2 value) const { if (location != -1) glUniform2f(location, value.x, value.y); }
+        void set(GLint location, glm::vec3 value) const { if (location != -1) glUniform3f(location, value.x, value.y, value.z); }
+        void set(GLint location, glm::vec4 value) const { if (location != -1) glUniform4f(location, value.x, value.y, value.z, value.w); }
+        void set(GLint location, const glm::mat4& matrix) const { if (location != -1) glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(matrix)); }
+
         // TODO: (Req 1) Delete the copy constructor and assignment operator.
         // Question: Why do we delete the copy constructor and assignment operator?
         /*
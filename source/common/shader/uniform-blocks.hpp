@@ -0,0 +1,95 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+
+namespace our {
+
+    // The uniform blocks shared by the shaders and the binding point of each one.
+    // ShaderProgram::link binds every block of this list that the program declares to its binding point,
+    // so a buffer bound once to that point is seen by all the shaders.
+    // The structs below mirror the std140 layout of the blocks in "assets/shaders/default.vert" and "default.frag":
+    // a vec3 takes 16 bytes unless a scalar is packed right after it, and every struct in an array starts on 16 bytes.
+    struct UniformBlockBinding {
+        const char* name;
+        GLuint bindingPoint;
+    };
+
+    constexpr GLuint FRAME_BLOCK_BINDING = 0;
+    constexpr GLuint LIGHTS_BLOCK_BINDING = 1;
+
+    constexpr UniformBlockBinding UNIFORM_BLOCK_BINDINGS[] = {
+            {"Frame",  FRAME_BLOCK_BINDING},
+            {"Lights", LIGHTS_BLOCK_BINDING},
+    };
+
+    // The maximum number of directional lights that the default shader can receive (it must match MAX_LIGHTS in "default.frag")
+    constexpr int MAX_LIGHTS = 20;
+
+    // The camera data of a frame
+    struct FrameBlock {
+        glm::mat4 camera;         // The view projection matrix
+        glm::mat4 skyCamera;      // The view projection matrix used by the sky (it pushes the sky behind everything)
+        glm::vec3 cameraPosition; float pad0;
+        glm::vec3 areaLight;      float pad1;
+    };
+    static_assert(sizeof(FrameBlock) == 160, "FrameBlock must match the std140 layout of the Frame block");
+
+    struct DirectionalLightBlock {
+        glm::vec3 direction;     float intensity;
+        glm::vec3 ambientColor;  float pad0;
+        glm::vec3 diffuseColor;  float pad1;
+        glm::vec3 specularColor; float pad2;
+    };
+    static_assert(sizeof(DirectionalLightBlock) == 64, "DirectionalLightBlock must match the std140 layout of DirectionalLight");
+
+    // The cluster grid used to pick the spot and cone lights that can reach a fragment (see "LightClusters").
+    // The screen is split in CLUSTER_GRID_X * CLUSTER_GRID_Y tiles and the view depth in CLUSTER_GRID_Z exponential slices.
+    constexpr int CLUSTER_GRID_X = 16;
+    constexpr int CLUSTER_GRID_Y = 9;
+    constexpr int CLUSTER_GRID_Z = 24;
+
+    // The global lights of a frame and the parameters of the cluster grid (the spot and cone lights are read from texture buffers)
+    struct LightsBlock {
+        GLint directionalLightCount;
+        GLint clusteredLightCount;                  // The number of spot and cone lights in the light texture buffer
+        GLint pad0[2];
+        glm::vec3 clusteredAmbient;  float pad1;    // The sum of the ambient colors of the spot and cone lights (they light every fragment)
+        glm::vec3 cameraForward;     float pad2;    // The view depth of a fragment is dot(position - cameraPosition, cameraForward)
+        glm::vec4 clusterScale;                     // xy maps gl_FragCoord.xy to a tile, zw maps the log of the view depth to a slice
+        glm::ivec4 clusterCount;                    // The size of the cluster grid (w is unused)
+        DirectionalLightBlock directionalLights[MAX_LIGHTS];
+    };
+    static_assert(offsetof(LightsBlock, clusteredAmbient) == 16, "LightsBlock must match the std140 layout of the Lights block");
+    static_assert(offsetof(LightsBlock, clusterScale) == 48, "LightsBlock must match the std140 layout of the Lights block");
+    static_assert(offsetof(LightsBlock, directionalLights) == 80, "LightsBlock must match the std140 layout of the Lights block");
+
+    // The texture buffers shared by the shaders and the texture unit of each one.
+    // Like the uniform blocks, ShaderProgram::link sets every sampler of this list that the program declares to its unit,
+    // so the renderer binds each buffer once per frame. The units are the last of the 16 units guaranteed by OpenGL 3.3
+    // so they never collide with the textures of the materials.
+    struct TextureBufferBinding {
+        const char* name;
+        GLuint textureUnit;
+    };
+
+    constexpr GLuint OBJECT_DATA_TEXTURE_UNIT = 12;
+    constexpr GLuint CLUSTER_LIGHTS_TEXTURE_UNIT = 13;
+    constexpr GLuint CLUSTER_GRID_TEXTURE_UNIT = 14;
+    constexpr GLuint CLUSTER_INDICES_TEXTURE_UNIT = 15;
+
+    // The number of RGBA32F texels of an object in the object texture buffer (it must match OBJECT_DATA_TEXELS in the default vertex shaders).
+    //  0-3: the columns of the model matrix
+    //  4-6: the columns of the normal matrix (w is unused)
+    //  7:   the tint
+    constexpr int OBJECT_DATA_TEXELS = 8;
+
+    constexpr TextureBufferBinding TEXTURE_BUFFER_BINDINGS[] = {
+            {"objectData",     OBJECT_DATA_TEXTURE_UNIT},
+            {"clusterLights",  CLUSTER_LIGHTS_TEXTURE_UNIT},
+            {"clusterGrid",    CLUSTER_GRID_TEXTURE_UNIT},
+            {"clusterIndices", CLUSTER_INDICES_TEXTURE_UNIT},
+    };
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <cstddef>
+
+namespace our {
+
+    // This class defines an OpenGL uniform buffer.
+    // A uniform buffer holds the data of a uniform block (declared with "layout(std140) uniform Name { ... };" in GLSL)
+    // so that data shared by many draws is uploaded once instead of being sent with glUniform for every draw.
+    class UniformBuffer {
+        // The OpenGL object name of this buffer
+        GLuint name;
+        // The size of the buffer storage (in bytes), the storage is only reallocated if a larger size is needed
+        size_t capacity = 0;
+    public:
+        UniformBuffer() {
+            glGenBuffers(1, &name);
+        }
+
+        ~UniformBuffer() {
+            glDeleteBuffers(1, &name);
+        }
+
+        // Uploads "size" bytes from "data" to the start of the buffer.
+        // The storage is orphaned first so that the driver doesn't wait for the draws of the previous frame that still read the old data.
+        void setData(const void* data, size_t size) {
+            glBindBuffer(GL_UNIFORM_BUFFER, name);
+            if (size > capacity) capacity = size;
+            glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr) capacity, nullptr, GL_DYNAMIC_DRAW);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr) size, data);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        // Uploads the given std140 struct to the buffer
+        template<typename T>
+        void setData(const T& data) {
+            setData(&data, sizeof(T));
+        }
+
+        // Binds this buffer to the given uniform block binding point, every block bound to the same point (see "ShaderProgram::link") reads it
+        void bind(GLuint bindingPoint) const {
+            glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, name);
+        }
+
+        UniformBuffer(const UniformBuffer&) = delete;
+        UniformBuffer& operator=(const UniformBuffer&) = delete;
+    };
+
+}
@@ -11,6 +11,7 @@
 #include "components/camera.hpp"
 #include "application.hpp"
 #include "events-system-controller.hpp"
+#include "jobs/job-system.hpp"
 
 #include <glm/gtx/intersect.hpp>
 #include <queue>
@@ -24,7 +25,7 @@
 #define TYPE2_DIRECTION_ALIGNMENT   0.999
 #define BLOCK_WIDTH            1.0f
 
-#define PUSH(i, k) if (k.first >= 0) {groundMap[i].push_back(k);}
+#define PUSH(links, k) if (k.first >= 0) {links.push_back(k);}
 
 #define v3AB(a , b , v) v = glm::vec3(a * b * glm::vec4(v , 1.0))
 
@@ -74,6 +75,9 @@ namespace our{
         Application* app{};
         CameraComponent* camera{};
         World* world{};
+        // the size of the framebuffer this frame, used to turn screen positions into rays.
+        // It is set from the main thread before the systems run, since glfw must not be called from the workers
+        glm::ivec2 frameBufferSize{1, 1};
 
         void init(Application* a, World* mWorld){
             this->camera = nullptr;
@@ -81,9 +85,14 @@ namespace our{
             this->groundMap.clear();
             this->app = a;
             this->world = mWorld;
+            this->frameBufferSize = a->getFrameBufferSize();
             update();
         }
 
+        void setFrameBufferSize(glm::ivec2 size){
+            frameBufferSize = size;
+        }
+
         [[nodiscard]] inline Ground* findBlockNear(const glm::vec3& paimonPos,const glm::vec3& paimonUp) const{
             for (auto block : blocks){
                 if (glm::dot(paimonUp, block.up) < UP_TO_UP_ALIGNMENT) continue;
@@ -247,19 +256,19 @@ namespace our{
 
         Ground* ScreenToGroundCast(float screenX, float screenY){
             auto fSx = (float) screenX;
-            auto fSy = (float) app->getFrameBufferSize().y - (float) screenY;
+            auto fSy = (float) frameBufferSize.y - (float) screenY;
 
-            fSx /= (float) app->getFrameBufferSize().x;
+            fSx /= (float) frameBufferSize.x;
             fSx -= 0.5;
             fSx *= 2;
 
-            fSy /= (float) app->getFrameBufferSize().y;
+            fSy /= (float) frameBufferSize.y;
             fSy -= 0.5;
             fSy *= 2;
 
             //now we have the NDC coords
             glm::vec4 ndcVector = glm::vec4(fSx , fSy , 0 , 1);
-            glm::vec4 vsVector  = glm::inverse(camera->getProjectionMatrix(app->getFrameBufferSize())) * ndcVector;
+            glm::vec4 vsVector  = glm::inverse(camera->getProjectionMatrix(frameBufferSize)) * ndcVector;
 
             auto temp = vsVector;
             temp.z = -1;
@@ -392,20 +401,20 @@ namespace our{
             groundMap.clear();
 
             //first we need to get all of our objects ready
-            for (auto k : world->getEntities()){
+            if (camera == nullptr) camera = world->getSingleton<CameraComponent>();
+            for (auto k : world->view<Ground>()){
                 if (!k->enabled) continue;
-                if (camera == nullptr) camera = k->getComponent<CameraComponent>();
-                auto g = k->getComponent<Ground>();
-                if (g){
-                    ground_blocks.emplace_back(g);
-                    //((DefaultMaterial*) k->getComponent<MeshRendererComponent>()->material)->tint = glm::vec4(1, 0.5 , 0.5 , 1);
-                }
+                ground_blocks.emplace_back(k->getComponent<Ground>());
+                //((DefaultMaterial*) k->getComponent<MeshRendererComponent>()->material)->tint = glm::vec4(1, 0.5 , 0.5 , 1);
             }
 
             if (!camera) return;
 
             auto PV = camera->getViewMatrix();
-            for (auto k : ground_blocks){
+            // every block is projected independently so they are split between the workers of the job system
+            blocks.resize(ground_blocks.size());
+            JobSystem::getInstance().parallelFor(0, ground_blocks.size(), 64, [&](size_t i){
+                auto k = ground_blocks[i];
                 Entity* et = k->getOwner();
                 auto localToWorld = et->getLocalToWorldMatrix();
                 glm::vec4 pos =  localToWorld * glm::vec4(0, 0, 0 , 1.0);
@@ -418,8 +427,8 @@ namespace our{
                         k
                 };
 
-                blocks.emplace_back(b);
-            }
+                blocks[i] = b;
+            });
 
             glm::vec3 left         = glm::vec3(PV * glm::vec4(1,0,0 , 0.0));
             glm::vec3 top          = glm::vec3(PV * glm::vec4(0,1,0 , 0.0));
@@ -429,14 +438,13 @@ namespace our{
             forward      = glm::normalize(forward);
             top          = glm::normalize(top);
 
-            std::queue<int> next;
-            for (int i = 0;i < blocks.size();i++){
-                next.push(i);
-            }
-
-            while (!next.empty()){
-                auto index = next.front(); next.pop();
-                GroundBlock g = blocks[index];
+            // the links of every block only depend on the blocks array so each block is linked in parallel
+            // then the links are moved to the map in order to keep the same result as a sequential pass
+            std::vector<std::vector<std::pair<int,glm::vec3>>> links(blocks.size());
+            JobSystem::getInstance().parallelFor(0, blocks.size(), 16, [&](size_t i){
+                int index = (int) i;
+                auto& found = links[index];
+                const GroundBlock& g = blocks[index];
 
                 auto isLeftUp = true;
                 if (glm::abs(glm::dot(left , glm::vec3(0,1,0))) < glm::abs(glm::dot(forward , glm::vec3(0,1,0)))){
@@ -450,10 +458,10 @@ namespace our{
                 auto f = findBlockAlongDirection2(forward  , g.position , top, index );
                 auto b = findBlockAlongDirection2(-forward , g.position , top, index );
 
-                PUSH(index , l)
-                PUSH(index , r)
-                PUSH(index , f)
-                PUSH(index , b)
+                PUSH(found, l)
+                PUSH(found, r)
+                PUSH(found, f)
+                PUSH(found, b)
 
                 if (EnableAdvancedIllusions) {
                     auto lT = left;
@@ -477,14 +485,18 @@ namespace our{
                         auto bl1 = findBlockAlongDirection2(- directionUp + directionLeft, g.position, top, index);
                         auto bl2 = findBlockAlongDirection2(- directionUp - directionLeft, g.position, top, index);
 
-                        PUSH(index, f2)
-                        PUSH(index, b2)
-                        PUSH(index, fl1)
-                        PUSH(index, fl2)
-                        PUSH(index, bl1)
-                        PUSH(index, bl2)
+                        PUSH(found, f2)
+                        PUSH(found, b2)
+                        PUSH(found, fl1)
+                        PUSH(found, fl2)
+                        PUSH(found, bl1)
+                        PUSH(found, bl2)
                     }
                 }
+            });
+
+            for (int i = 0;i < (int) links.size();i++){
+                if (!links[i].empty()) groundMap[i] = std::move(links[i]);
             }
 
 
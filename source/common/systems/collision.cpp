@@ -13,41 +13,30 @@ namespace our {
     }
 
     void CollisionSystem::update(World *world , int& goldenCount , int& blueCount , int& redCount) {
-        glm::vec3 paimonPos;
-        Entity* paimon;
-        for (auto entity: world->getEntities()) {
-            if (entity->getComponent<Paimon>() != nullptr) {
-                paimonPos = entity->getWorldPosition();
-                paimon = entity;
-
-                break;
-            }
-        }
+        auto& paimons = world->getAllComponents<Paimon>();
+        if (paimons.empty()) return ;
+        glm::vec3 paimonPos = paimons.front()->getOwner()->getWorldPosition();
 
-        if (!paimon) return ;
-
-        for (auto entity: world->getEntities()) {
+        for (auto moraObject : world->getAllComponents<Mora>()) {
+            Entity* entity = moraObject->getOwner();
             glm::vec3 moraVec = entity->getWorldPosition();
-            Mora *moraObject = entity->getComponent<Mora>();
-
-            if (moraObject != nullptr) {
-                auto len = glm::length(paimonPos - moraVec + moraObject->offset);
-                if (len <  1.5f) {
-                    //moraObject->getOwner()->localTransform.position[1] = 100;
-                    //std::cout << "Mora Hit" << std::endl;
-                    our::Events::onPaimonPickMora(entity->name);
-                    world->markForRemoval(entity);
-                    switch (moraObject->type) {
-                        case GOLDEN:
-                            goldenCount++;
-                            break;
-                        case BLUE:
-                            blueCount++;
-                            break;
-                        case RED:
-                            redCount++;
-                            break;
-                    }
+
+            auto len = glm::length(paimonPos - moraVec + moraObject->offset);
+            if (len <  1.5f) {
+                //moraObject->getOwner()->localTransform.position[1] = 100;
+                //std::cout << "Mora Hit" << std::endl;
+                our::Events::onPaimonPickMora(entity->getNameId());
+                world->markForRemoval(entity);
+                switch (moraObject->type) {
+                    case GOLDEN:
+                        goldenCount++;
+                        break;
+                    case BLUE:
+                        blueCount++;
+                        break;
+                    case RED:
+                        redCount++;
+                        break;
                 }
             }
         }
@@ -3,7 +3,9 @@
 //
 #include "events-system-controller.hpp"
 #include "components/event-controller.h"
+#include "ecs/component-ref.hpp"
 #include "iostream"
+#include <list>
 
 static our::Application* mApp;
 static our::World* mWorld;
@@ -16,7 +18,7 @@ struct ActiveAction{
     int remainingTriggerCount;
     float nextTriggerDelay;
     float triggerInterval;
-    our::ActionReceiver* receiver = nullptr;
+    our::ComponentRef<our::ActionReceiver> receiver; // reads as nullptr once the receiver's entity is removed
 };
 
 static std::list<ActiveAction> activeActions;
@@ -28,21 +30,18 @@ void our::Events::Init(Application *app, World *world) {
     mApp = app;
     mWorld = world;
 
-    for (auto k : world->getEntities()){
-        auto comp = k->getComponent<EventController>();
-        if (comp != nullptr){
-            for (auto& j : comp->events) {
-                events.emplace_back(j);
-            }
+    for (auto comp : world->getAllComponents<EventController>()){
+        for (auto& j : comp->events) {
+            events.emplace_back(j);
         }
     }
     std::cout << "EVENTS| LOADED: " << events.size() << " event controller" << std::endl;
 
 }
 
-void triggerEven(const our::EventType type, const std::string& obj){
+void triggerEven(const our::EventType type, our::NameId obj){
     for (auto&[trigger, actions] : events){
-        if (trigger.type == type && obj == trigger.associatedObject){
+        if (trigger.type == type && obj == trigger.associatedObjectId){
             // we should trigger this event :)
             trigger.maxTrigger--;
             for (const auto& action : actions){
@@ -51,17 +50,15 @@ void triggerEven(const our::EventType type, const std::string& obj){
                 activeAction.remainingTriggerCount = action.triggerCount;
                 activeAction.nextTriggerDelay = action.triggerDelay;
                 activeAction.triggerInterval = action.triggerInterval;
-                // now search for the receiver
-                for (auto et : mWorld->getEntities()){
+                // now search for the receiver among the entities that have the target name
+                for (auto et : mWorld->getEntitiesByName(action.targetId)){
                     activeAction.receiver = nullptr;
 
-                    if (et->name == action.target){
-                        auto receivers = et->getAllComponents<our::ActionReceiver>();
-                        for (auto receiver : receivers){
-                            if (receiver->getReceiverID() == action.receiverID){
-                                activeAction.receiver = receiver;
-                                break;
-                            }
+                    auto receivers = et->getAllComponents<our::ActionReceiver>();
+                    for (auto receiver : receivers){
+                        if (receiver->getReceiverID() == action.receiverID){
+                            activeAction.receiver = receiver;
+                            break;
                         }
                     }
 
@@ -85,8 +82,12 @@ void our::Events::Update(float deltaTime) {
         act.nextTriggerDelay -= deltaTime;
         if (act.nextTriggerDelay < 0){
             //std::cout << "Triggering Event" << std::endl;
-            act.receiver->trigger(act.data);
-            act.remainingTriggerCount--;
+            if (auto receiver = act.receiver.get()){
+                receiver->trigger(act.data);
+                act.remainingTriggerCount--;
+            } else {
+                act.remainingTriggerCount = 0; // the receiver is gone so the action can never trigger again
+            }
             act.nextTriggerDelay = act.triggerInterval;
         }
     }
@@ -98,28 +99,28 @@ void our::Events::Update(float deltaTime) {
 
 void our::Events::onPaimonEnter(our::Ground *g) {
     //std::cout << "Enter Ground" << std::endl;
-    triggerEven(EventType::PAIMON_ENTER_GROUND , g->getOwner()->name);
+    triggerEven(EventType::PAIMON_ENTER_GROUND , g->getOwner()->getNameId());
 }
 
 void our::Events::onPaimonExit(our::Ground *g) {
     //std::cout << "Exit Ground" << std::endl;
-    triggerEven(EventType::PAIMON_EXIT_GROUND , g->getOwner()->name);
+    triggerEven(EventType::PAIMON_EXIT_GROUND , g->getOwner()->getNameId());
 }
 
-void our::Events::onPaimonInteract(const std::string& name) {
+void our::Events::onPaimonInteract(NameId name) {
     triggerEven(EventType::PAIMON_INTERACT , name);
 }
 
-void our::Events::onPaimonPickMora(const std::string &mora_name) {
+void our::Events::onPaimonPickMora(NameId mora_name) {
     triggerEven(EventType::PAIMON_PICK_MORA , mora_name);
 }
 
-void our::Events::onPaimonCameraChange(const std::string &name) {
+void our::Events::onPaimonCameraChange(NameId name) {
     triggerEven(EventType::PAIMON_CAMERA_CHANGE , name);
 }
 
 void our::Events::onPaimonEnterWorld() {
-    triggerEven(EventType::PAIMON_ENTER_WORLD , "");
+    triggerEven(EventType::PAIMON_ENTER_WORLD , EMPTY_NAME);
     std::cout << "ENTER WORLD" << std::endl;
 }
 
@@ -17,9 +17,9 @@ namespace our::Events{
     void onPaimonEnter(Ground* g);
     void onPaimonExit(Ground* g);
 
-    void onPaimonInteract(const std::string& name);
-    void onPaimonPickMora(const std::string& more_name);
-    void onPaimonCameraChange(const std::string& name);
+    void onPaimonInteract(NameId name);
+    void onPaimonPickMora(NameId mora_name);
+    void onPaimonCameraChange(NameId name);
 
 
     void onPaimonEnterWorld();
@@ -1,4 +1,3 @@
-#include <sstream>
 #include "forward-renderer.hpp"
 #include "../mesh/mesh-utils.hpp"
 #include "../texture/texture-utils.hpp"
@@ -10,6 +9,37 @@ namespace our {
         // First, we store the window size for later use
         this->windowSize = windowSize;
         this->areaLight = config.value("areaLight" , glm::vec3(1,1,1));
+        this->pipelined = config.value("pipelined", false);
+        // The packets of the last level refer to its assets, so they must never be submitted
+        packets.reset();
+        hasSubmittedPacket = false;
+        // Create the uniform buffers of the camera and the lights
+        this->frameUniformBuffer = new UniformBuffer();
+        this->lightsUniformBuffer = new UniformBuffer();
+        // Create the texture buffers of the clustered lights
+        lightClusters.create();
+        // Create the buffer of the instanced draws and the texture buffer of the object data
+        glGenBuffers(1, &instanceBuffer);
+        objectBuffer = new TextureBuffer(GL_RGBA32F);
+        GLint maxTexels = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        maxObjects = (uint32_t) maxTexels / OBJECT_DATA_TEXELS;
+        reportedObjectLimit = false;
+        // Create the depth-only programs if the depth pre-pass is enabled
+        this->depthPrepass = config.value("depthPrepass", false);
+        if(depthPrepass){
+            auto createDepthShader = [](const std::string& vertexShader){
+                auto shader = new ShaderProgram();
+                if(!shader->attach(vertexShader, GL_VERTEX_SHADER) ||
+                   !shader->attach("assets/shaders/depth-only.frag", GL_FRAGMENT_SHADER) || !shader->link()){
+                    std::cerr << "ERROR: Couldn't build the depth pre-pass shader of: " << vertexShader << std::endl;
+                }
+                return shader;
+            };
+            depthShader = createDepthShader("assets/shaders/default.vert");
+            depthInstancedShader = createDepthShader("assets/shaders/default-instanced.vert");
+            depthBatchedShader = createDepthShader("assets/shaders/default-batched.vert");
+        }
         // Then we check if there is a sky texture in the configuration
         if(config.contains("sky")){
             // First, we create a sphere which will be used to draw the sky
@@ -54,55 +84,462 @@ namespace our {
         }
 
         // Then we check if there is a postprocessing shader in the configuration
-        if(config.contains("postprocess")){
+        if(config.contains("postprocess") && (config["postprocess"].contains("bloom") || !config["postprocess"].value("effects", nlohmann::json::array()).empty())){
             //TODO: (Req 11) Create a framebuffer
-            const auto& postprocess = config["postprocess"];
-            int tex_count = postprocess.value("channels" , 1);
-
-            postprocessFramebuffer = new Framebuffer(windowSize);
-            postprocessFramebuffer->bind();
-            for (int i = 0;i < tex_count;i++)
-                postprocessFramebuffer->addColorTexture(GL_RGBA8);
-            postprocessFramebuffer->addDepthTexture(GL_DEPTH_COMPONENT24);
-            postprocessFramebuffer->unbind();
-
-            postprocessFramebuffer2 = new Framebuffer(windowSize);
-            postprocessFramebuffer2->bind();
-            for (int i = 0;i < tex_count;i++)
-                postprocessFramebuffer2->addColorTexture(GL_RGBA8);
-            postprocessFramebuffer2->addDepthTexture(GL_DEPTH_COMPONENT24);
-            postprocessFramebuffer2->unbind();
-
-            glGenVertexArrays(1, &postProcessVertexArray);
-
-            // Create a sampler to use for sampling the scene texture in the post processing shader
-            postprocessSampler = new Sampler();
-            postprocessSampler->set(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            postprocessSampler->set(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            postprocessSampler->set(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            postprocessSampler->set(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-            // Create the post-processing shader
-            auto effects = postprocess["effects"];
-            for (const auto& effect : effects) {
-                auto *postprocessShader = new ShaderProgram();
-                postprocessShader->attach("assets/shaders/fullscreen.vert", GL_VERTEX_SHADER);
-                postprocessShader->attach(effect.value<std::string>("target", ""), GL_FRAGMENT_SHADER);
-                postprocessShader->link();
-                postprocessShaders.emplace_back(postprocessShader);
-                postprocessData.emplace_back(effect["params"]);
-                std::cout << "Generated Postprocess Shader: " << effect.value<std::string>("target", "") << std::endl;
+            // The framebuffers, programs and uniforms of all the effects are created once here
+            postprocess = new PostprocessPlan();
+            postprocess->compile(windowSize, config["postprocess"]);
+        }
+    }
+
+    DrawUniforms::DrawUniforms(const ShaderProgram* shader){
+        transform = shader->getUniformLocation("transform");
+        objectIndex = shader->getUniformLocation("objectIndex");
+    }
+
+    const DrawUniforms& ForwardRenderer::getDrawUniforms(const ShaderProgram* shader){
+        auto it = drawUniforms.find(shader);
+        if(it == drawUniforms.end()){
+            it = drawUniforms.emplace(shader, DrawUniforms(shader)).first;
+        }
+        return it->second;
+    }
+
+    void ForwardRenderer::uploadFrameData(const FramePacket& packet){
+        frameUniformBuffer->setData(packet.frameData);
+        frameUniformBuffer->bind(FRAME_BLOCK_BINDING);
+    }
+
+    glm::vec2 ForwardRenderer::getVisibleDepthRange(const FramePacket& packet, const glm::vec3& cameraCenter, const glm::vec3& cameraForward, float near, float far){
+        // The depth range of the bounding spheres of the visible commands
+        glm::vec2 range(FLT_MAX, -FLT_MAX);
+        auto include = [&](const std::vector<RenderCommand>& commands){
+            for (const auto& command : commands){
+                const auto& sphere = command.mesh->getBounds(command.shapeID).sphere;
+                const glm::mat4& M = command.localToWorld;
+                float scale = std::sqrt(std::max({glm::dot(M[0], M[0]), glm::dot(M[1], M[1]), glm::dot(M[2], M[2])}));
+                float depth = glm::dot(glm::vec3(M * glm::vec4(sphere.center, 1.0f)) - cameraCenter, cameraForward);
+                range.x = std::min(range.x, depth - sphere.radius * scale);
+                range.y = std::max(range.y, depth + sphere.radius * scale);
+            }
+        };
+        include(packet.opaqueCommands);
+        include(packet.transparentCommands);
+        if (range.x > range.y) return {near, far};
+        return {std::max(range.x, near), std::min(range.y, far)};
+    }
+
+    void ForwardRenderer::gatherLights(FramePacket& packet, const CameraComponent* camera, const glm::vec3& cameraCenter, const glm::vec3& cameraForward, glm::vec2 depthRange){
+        // The shader can't receive more than MAX_LIGHTS directional lights, they light every fragment
+        auto& lightsData = packet.lightsData;
+        auto& directionalLights = scene.getDirectionalLights();
+        lightsData.directionalLightCount = (GLint) std::min<size_t>(directionalLights.size(), MAX_LIGHTS);
+        for (int i = 0;i < lightsData.directionalLightCount;i++){
+            auto& light = lightsData.directionalLights[i];
+            light.direction = directionalLights[i]->direction;
+            light.intensity = directionalLights[i]->intensity;
+            light.ambientColor = directionalLights[i]->ambientColor;
+            light.diffuseColor = directionalLights[i]->diffuseColor;
+            light.specularColor = directionalLights[i]->specularColor;
+        }
+
+        // The spot and cone lights are binned into the clusters of the view and read from the texture buffers
+        lightClusters.build(scene, camera->getViewMatrix(), camera->getProjectionMatrix(windowSize), windowSize,
+                            cameraCenter, cameraForward, depthRange, packet.clusters, lightsData);
+        packet.stats.clusteredLights = packet.clusters.getLightCount();
+        packet.stats.clusterLightIndices = packet.clusters.getIndexCount();
+    }
+
+    void ForwardRenderer::uploadLights(const FramePacket& packet){
+        lightClusters.upload(packet.clusters);
+        lightClusters.bind();
+
+        // Only the used part of the directional lights array is uploaded (the rest of the buffer is never read by the shader)
+        const auto& lightsData = packet.lightsData;
+        size_t lightsSize = offsetof(LightsBlock, directionalLights) + sizeof(DirectionalLightBlock) * lightsData.directionalLightCount;
+        lightsUniformBuffer->setData(&lightsData, lightsSize);
+        lightsUniformBuffer->bind(LIGHTS_BLOCK_BINDING);
+    }
+
+    uint32_t ForwardRenderer::getPipelineStateId(const PipelineState& state){
+        // There are only a few distinct pipeline states, so a linear search is enough
+        for (uint32_t id = 0; id < pipelineStates.size(); id++){
+            if (pipelineStates[id] == state) return id;
+        }
+        pipelineStates.push_back(state);
+        return (uint32_t) pipelineStates.size() - 1;
+    }
+
+    uint32_t ForwardRenderer::getObjectId(std::unordered_map<const void*, uint32_t>& ids, const void* object){
+        auto it = ids.find(object);
+        if (it == ids.end()){
+            it = ids.emplace(object, (uint32_t) ids.size()).first;
+        }
+        return it->second;
+    }
+
+    void ForwardRenderer::sortOpaqueCommands(FramePacket& packet, const glm::vec3& cameraCenter, const glm::vec3& cameraForward, float far){
+        // Packs an id into a key segment of the given width (ids that don't fit share the last value)
+        auto segment = [](uint32_t id, int bits) -> uint64_t {
+            uint64_t maxValue = (uint64_t(1) << bits) - 1;
+            return id < maxValue ? id : maxValue;
+        };
+
+        auto& opaqueCommands = packet.opaqueCommands;
+        sortItems.clear();
+        for (uint32_t i = 0; i < opaqueCommands.size(); i++){
+            const auto& command = opaqueCommands[i];
+            // Inside a state group, closer objects are drawn first so that the depth test rejects more of the hidden fragments
+            float depth = glm::dot(command.center - cameraCenter, cameraForward) / far;
+            uint32_t depthBucket = (uint32_t) (glm::clamp(depth, 0.0f, 1.0f) * 4095.0f);
+            // Instance groups use the lower half of the material ids and the other materials the upper half
+            uint32_t materialKey = command.instanceGroup != NO_INSTANCE_GROUP ?
+                                   std::min<uint32_t>(command.instanceGroup, 0x7FFF) :
+                                   0x8000 | std::min<uint32_t>(getObjectId(materialIds, command.material), 0x7FFF);
+
+            uint64_t key = segment(command.pipelineStateId, 8) << 56
+                         | segment(getObjectId(shaderIds, command.material->shader), 12) << 44
+                         | segment(materialKey, 16) << 28
+                         | segment(getObjectId(meshIds, command.mesh), 16) << 12
+                         | depthBucket;
+            sortItems.push_back({key, i});
+        }
+        radixSort(sortItems, sortScratch);
+
+        sortedCommands.clear();
+        for (const auto& item : sortItems){
+            sortedCommands.push_back(opaqueCommands[item.index]);
+        }
+        std::swap(opaqueCommands, sortedCommands);
+    }
+
+    bool ForwardRenderer::canDepthPrepass(const Material* material){
+        auto lit = dynamic_cast<const DefaultMaterial*>(material);
+        const auto& state = material->pipelineState;
+        return lit != nullptr && !lit->isSkybox && !material->transparent && state.depthTesting.enabled && state.depthMask &&
+               material->shader != nullptr && material->shader->getAttachedFile(GL_VERTEX_SHADER) == "assets/shaders/default.vert";
+    }
+
+    const DepthPrepassStates& ForwardRenderer::getDepthPrepassStates(uint32_t pipelineStateId){
+        if (pipelineStateId >= depthPrepassStates.size()){
+            depthPrepassStates.resize(pipelineStateId + 1, {UINT32_MAX, UINT32_MAX});
+        }
+        if (depthPrepassStates[pipelineStateId].depthOnly == UINT32_MAX){
+            // The state is copied since adding the derived states can reallocate "pipelineStates"
+            PipelineState depthOnly = pipelineStates[pipelineStateId];
+            depthOnly.colorMask = glm::bvec4(false);
+            PipelineState depthEqual = pipelineStates[pipelineStateId];
+            depthEqual.depthTesting.function = GL_EQUAL;
+            depthEqual.depthMask = false;
+            uint32_t depthOnlyId = getPipelineStateId(depthOnly);
+            uint32_t depthEqualId = getPipelineStateId(depthEqual);
+            // The vector can grow too (the new ids are larger than this one)
+            depthPrepassStates.resize(std::max<size_t>(depthPrepassStates.size(), pipelineStates.size()), {UINT32_MAX, UINT32_MAX});
+            depthPrepassStates[pipelineStateId] = {depthOnlyId, depthEqualId};
+        }
+        return depthPrepassStates[pipelineStateId];
+    }
+
+    void ForwardRenderer::sortDepthPrepass(FramePacket& packet, const glm::vec3& cameraCenter, const glm::vec3& cameraForward, glm::vec2 depthRange){
+        const uint64_t maxBucket = (uint64_t(1) << DEPTH_PREPASS_BUCKET_BITS) - 1;
+        float depthScale = depthRange.y > depthRange.x ? (float) maxBucket / (depthRange.y - depthRange.x) : 0.0f;
+
+        const auto& opaqueCommands = packet.opaqueCommands;
+        sortItems.clear();
+        for (uint32_t i = 0; i < opaqueCommands.size(); i++){
+            const auto& command = opaqueCommands[i];
+            if (!command.depthPrepass) continue;
+            float depth = glm::dot(command.center - cameraCenter, cameraForward);
+            uint64_t bucket = (uint64_t) glm::clamp((depth - depthRange.x) * depthScale, 0.0f, (float) maxBucket);
+            uint64_t stateId = std::min<uint32_t>(getDepthPrepassStates(command.pipelineStateId).depthOnly, 0xFF);
+            uint64_t meshId = std::min<uint32_t>(getObjectId(meshIds, command.mesh), 0xFFFF);
+            uint64_t shape = std::min<uint32_t>((uint32_t) (command.shapeID + 1), 0xFFFF);
+            uint64_t key = bucket << (64 - DEPTH_PREPASS_BUCKET_BITS)
+                         | stateId << 48
+                         | uint64_t(command.staticBatch ? 1 : 0) << 47
+                         | meshId << 31
+                         | shape << 15;
+            sortItems.push_back({key, i});
+        }
+        radixSort(sortItems, sortScratch);
+
+        packet.depthPrepassOrder.clear();
+        for (const auto& item : sortItems){
+            packet.depthPrepassOrder.push_back(item.index);
+        }
+    }
+
+    void ForwardRenderer::drawDepthPrepass(const FramePacket& packet){
+        const auto& opaqueCommands = packet.opaqueCommands;
+        const auto& depthPrepassOrder = packet.depthPrepassOrder;
+        uint32_t currentPipelineStateId = UINT32_MAX;
+        const ShaderProgram* currentShader = nullptr;
+        const DrawUniforms* uniforms = nullptr;
+
+        for (size_t n = 0; n < depthPrepassOrder.size();){
+            const auto& command = opaqueCommands[depthPrepassOrder[n]];
+            uint32_t stateId = packet.depthPrepassStates[command.pipelineStateId].depthOnly;
+
+            // Without a material, the instanced commands of the same mesh can be drawn together whatever their materials are.
+            // The others are drawn one by one, so each command uses the same vertex shader as in the color pass
+            size_t runEnd = n + 1;
+            if (command.instanced){
+                while (runEnd < depthPrepassOrder.size()){
+                    const auto& next = opaqueCommands[depthPrepassOrder[runEnd]];
+                    if (!next.instanced || next.mesh != command.mesh || next.shapeID != command.shapeID ||
+                        packet.depthPrepassStates[next.pipelineStateId].depthOnly != stateId) break;
+                    runEnd++;
+                }
+            }
+            ShaderProgram* program = command.staticBatch ? depthBatchedShader : command.instanced ? depthInstancedShader : depthShader;
+
+            if (stateId != currentPipelineStateId){
+                packet.pipelineStates[stateId].setup();
+                currentPipelineStateId = stateId;
+            }
+            if (program != currentShader){
+                program->use();
+                currentShader = program;
+                uniforms = &getDrawUniforms(program);
+            }
+
+            if (command.instanced){
+                instanceObjects.clear();
+                for (size_t k = n; k < runEnd; k++){
+                    instanceObjects.push_back(opaqueCommands[depthPrepassOrder[k]].objectIndex);
+                }
+                uploadInstanceData();
+                command.mesh->drawInstanced(command.shapeID, (GLsizei) instanceObjects.size(), instanceBuffer);
+            } else {
+                if (!command.staticBatch) program->set(uniforms->objectIndex, (GLint) command.objectIndex);
+                command.mesh->draw(command.shapeID);
+            }
+            stats.depthPrepassDrawCalls++;
+            n = runEnd;
+        }
+    }
+
+    void ForwardRenderer::markInstancedRuns(std::vector<RenderCommand>& commands){
+        for (size_t i = 0; i < commands.size();){
+            const auto& command = commands[i];
+            size_t runEnd = i + 1;
+            if (command.instanceGroup != NO_INSTANCE_GROUP){
+                while (runEnd < commands.size() && commands[runEnd].instanceGroup == command.instanceGroup &&
+                       commands[runEnd].mesh == command.mesh && commands[runEnd].shapeID == command.shapeID){
+                    runEnd++;
+                }
+            }
+            bool instanced = runEnd - i >= MIN_INSTANCES;
+            for (; i < runEnd; i++) commands[i].instanced = instanced;
+        }
+    }
+
+    uint32_t ForwardRenderer::getInstanceGroup(const Material* material){
+        auto defaultMaterial = dynamic_cast<const DefaultMaterial*>(material);
+        if (defaultMaterial == nullptr || defaultMaterial->isSkybox) return NO_INSTANCE_GROUP;
+        // There are only a few groups per level (e.g. all the copies of the ground material form one group)
+        for (uint32_t group = 0; group < instanceGroups.size(); group++){
+            if (instanceGroups[group]->isInstanceCompatible(*defaultMaterial)) return group;
+        }
+        instanceGroups.push_back(defaultMaterial);
+        return (uint32_t) instanceGroups.size() - 1;
+    }
+
+    ShaderProgram* ForwardRenderer::getShaderVariant(std::unordered_map<const ShaderProgram*, ShaderProgram*>& variants,
+                                                     const ShaderProgram* shader, const std::string& vertexShader){
+        auto it = variants.find(shader);
+        if (it != variants.end()) return it->second;
+
+        // Only the default vertex shader has variants, the fragment shader stays the same
+        ShaderProgram* variant = nullptr;
+        if (shader->getAttachedFile(GL_VERTEX_SHADER) == "assets/shaders/default.vert"){
+            variant = new ShaderProgram();
+            bool ok = variant->attach(vertexShader, GL_VERTEX_SHADER) &&
+                      variant->attach(shader->getAttachedFile(GL_FRAGMENT_SHADER), GL_FRAGMENT_SHADER) &&
+                      variant->link();
+            if (!ok){
+                delete variant;
+                variant = nullptr;
             }
+        }
+        variants.emplace(shader, variant);
+        return variant;
+    }
 
-            // Create a post processing material
-            postprocessMaterial = new MultiTexturedMaterial();
-            postprocessMaterial->shader = nullptr;
-            postprocessMaterial->pipelineState.depthMask = false;
+    void ForwardRenderer::uploadInstanceData(){
+        size_t size = instanceObjects.size() * sizeof(uint32_t);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        // The storage is orphaned so that the previous instanced draw can still read the old data
+        if (size > instanceBufferCapacity) instanceBufferCapacity = size;
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) instanceBufferCapacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr) size, instanceObjects.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    uint32_t ForwardRenderer::addObjectData(std::vector<glm::vec4>& texels, const glm::mat4& localToWorld, const glm::mat3& normalMatrix, const glm::vec4& tint){
+        uint32_t index = (uint32_t) (texels.size() / OBJECT_DATA_TEXELS);
+        for (int column = 0; column < 4; column++) texels.push_back(localToWorld[column]);
+        for (int column = 0; column < 3; column++) texels.emplace_back(normalMatrix[column], 0.0f);
+        texels.push_back(tint);
+        return index;
+    }
 
+    void ForwardRenderer::writeObjectData(FramePacket& packet, const glm::mat4& skyTransform) const {
+        auto& texels = packet.objectTexels;
+        texels.clear();
+        for (auto commands : {&packet.opaqueCommands, &packet.transparentCommands}){
+            for (auto& command : *commands){
+                // The tint is copied here, so a system changing it while the packet is submitted doesn't affect this frame
+                // (the lit shaders read it from the object data and the other ones get it from the command)
+                command.tint = command.material->getTint();
+                command.objectIndex = addObjectData(texels, command.localToWorld, command.normalMatrix, command.tint);
+            }
+        }
+        if (skyMaterial){
+            packet.skyObjectIndex = addObjectData(texels, skyTransform, glm::transpose(glm::inverse(glm::mat3(skyTransform))), skyMaterial->tint);
+        }
+    }
+
+    void ForwardRenderer::limitObjects(FramePacket& packet){
+        size_t capacity = skyMaterial ? std::max<uint32_t>(maxObjects, 1) - 1 : maxObjects;
+        size_t count = packet.opaqueCommands.size() + packet.transparentCommands.size();
+        if (count <= capacity) return;
+
+        if (!reportedObjectLimit){
+            std::cerr << "ERROR: " << count << " visible objects but the object data can only hold " << capacity
+                      << " (GL_MAX_TEXTURE_BUFFER_SIZE is " << maxObjects * OBJECT_DATA_TEXELS << " texels), the rest are not drawn" << std::endl;
+            reportedObjectLimit = true;
+        }
+        packet.stats.droppedCommands = count - capacity;
+        // The transparent commands are sorted from back to front, so the first ones are the farthest
+        auto& transparentCommands = packet.transparentCommands;
+        size_t transparentDropped = std::min(count - capacity, transparentCommands.size());
+        transparentCommands.erase(transparentCommands.begin(), transparentCommands.begin() + (ptrdiff_t) transparentDropped);
+        packet.opaqueCommands.resize(std::min(packet.opaqueCommands.size(), capacity - transparentCommands.size()));
+    }
+
+    void ForwardRenderer::uploadObjectData(const FramePacket& packet){
+        objectBuffer->setData(packet.objectTexels.data(), packet.objectTexels.size() * sizeof(glm::vec4));
+        objectBuffer->bind(OBJECT_DATA_TEXTURE_UNIT);
+    }
+
+    void ForwardRenderer::drawCommands(const FramePacket& packet, const std::vector<RenderCommand>& commands, bool afterDepthPrepass){
+        // The state set by the previous draw (nothing is assumed at the start since other draws could have changed it)
+        uint32_t currentPipelineStateId = UINT32_MAX;
+        const ShaderProgram* currentShader = nullptr;
+        const Material* currentMaterial = nullptr;
+        const DrawUniforms* uniforms = nullptr;
+        bool lit = false;
+
+        for (size_t i = 0; i < commands.size();){
+            const auto& command = commands[i];
+            const Material* material = command.material;
+            stats.commands++;
+
+            // Find the run of the next commands that are drawn as instances together with this one (see "markInstancedRuns")
+            size_t runEnd = i + 1;
+            if (command.instanced){
+                while (runEnd < commands.size() && commands[runEnd].instanced && commands[runEnd].instanceGroup == command.instanceGroup &&
+                       commands[runEnd].mesh == command.mesh && commands[runEnd].shapeID == command.shapeID){
+                    runEnd++;
+                }
+            }
+            const ShaderProgram* program = material->shader;
+            // Only the shaders that don't use default.vert have no instanced variant, and those are never in the pre-pass
+            ShaderProgram* instancedShader = command.instanced ? getInstancedShader(material->shader) : nullptr;
+            ShaderProgram* batchedShader = command.staticBatch ? getBatchedShader(material->shader) : nullptr;
+            if (instancedShader != nullptr){
+                program = instancedShader;
+            } else {
+                runEnd = i + 1;
+                if (batchedShader != nullptr) program = batchedShader;
+            }
+
+            // The commands whose depth is already in the depth buffer are only drawn where they are the closest
+            uint32_t pipelineStateId = afterDepthPrepass && command.depthPrepass ?
+                                       packet.depthPrepassStates[command.pipelineStateId].depthEqual : command.pipelineStateId;
+            if (pipelineStateId != currentPipelineStateId){
+                packet.pipelineStates[pipelineStateId].setup();
+                currentPipelineStateId = pipelineStateId;
+                stats.pipelineStateChanges++;
+            }
+            if (program != currentShader){
+                program->use();
+                currentShader = program;
+                uniforms = &getDrawUniforms(currentShader);
+                // The material uniforms are stored in the program, so they have to be sent again to the new program
+                currentMaterial = nullptr;
+                stats.shaderChanges++;
+            }
+            if (material != currentMaterial){
+                // The tint is the only material value the systems change while the packet is submitted, so it is taken from the
+                // command (the copy made when the packet was prepared) and the other uniforms are read from the material
+                material->setupStaticUniforms(program);
+                currentMaterial = material;
+                lit = dynamic_cast<const DefaultMaterial*>(material) != nullptr;
+                // The lit shaders multiply the tint of each object (or vertex) with the vertex color instead
+                material->setupTint(program, lit ? glm::vec4(1.0f) : command.tint);
+                stats.materialChanges++;
+            }
+
+            if (instancedShader != nullptr){
+                instanceObjects.clear();
+                for (size_t k = i; k < runEnd; k++){
+                    instanceObjects.push_back(commands[k].objectIndex);
+                }
+                uploadInstanceData();
+                command.mesh->drawInstanced(command.shapeID, (GLsizei) instanceObjects.size(), instanceBuffer);
+                stats.commands += runEnd - i - 1;
+                stats.instancedDrawCalls++;
+            } else {
+                if (batchedShader != nullptr){
+                    // The vertices of the batch are already in the world space so the batched shader has no model matrix
+                    stats.staticBatchDrawCalls++;
+                }else if (lit){
+                    // The lit shader reads the camera from the frame uniform buffer and the matrices from the object data
+                    currentShader->set(uniforms->objectIndex, (GLint) command.objectIndex);
+                }else{
+                    currentShader->set(uniforms->transform, packet.VP * command.localToWorld);
+                }
+                command.mesh->draw(command.shapeID);
+            }
+            stats.drawCalls++;
+            i = runEnd;
         }
     }
 
     void ForwardRenderer::destroy(){
+        drawUniforms.clear();
+        transparentSorter.clear();
+        scene.detach();
+        instanceGroups.clear();
+        for (auto& [shader, instancedShader] : instancedShaders){
+            delete instancedShader;
+        }
+        instancedShaders.clear();
+        for (auto& [shader, batchedShader] : batchedShaders){
+            delete batchedShader;
+        }
+        batchedShaders.clear();
+        staticBatcher.clear();
+        glDeleteBuffers(1, &instanceBuffer);
+        instanceBuffer = 0;
+        instanceBufferCapacity = 0;
+        delete objectBuffer;
+        objectBuffer = nullptr;
+        pipelineStates.clear();
+        depthPrepassStates.clear();
+        delete depthShader;
+        delete depthInstancedShader;
+        delete depthBatchedShader;
+        depthShader = depthInstancedShader = depthBatchedShader = nullptr;
+        shaderIds.clear();
+        materialIds.clear();
+        meshIds.clear();
+        delete frameUniformBuffer;
+        delete lightsUniformBuffer;
+        frameUniformBuffer = lightsUniformBuffer = nullptr;
+        lightClusters.destroy();
         // Delete all objects related to the sky
         if(skyMaterial){
             delete skySphere;
@@ -112,74 +549,53 @@ namespace our {
             delete skyMaterial;
         }
         // Delete all objects related to post processing
-        if(postprocessMaterial){
-            glDeleteVertexArrays(1, &postProcessVertexArray);
-            delete postprocessFramebuffer;
-            delete postprocessFramebuffer2;
-            delete postprocessMaterial->samplers[0];
-            delete postprocessMaterial;
-
-            for (auto k : postprocessShaders){
-                delete k;
-            }
-
-            postprocessShaders.clear();
-            postprocessData.clear();
-        }
+        delete postprocess;
+        postprocess = nullptr;
     }
 
     void ForwardRenderer::render(World* world){
-        // First of all, we search for a camera and for all the mesh renderers
-        CameraComponent* camera = nullptr;
-        opaqueCommands.clear();
-        transparentCommands.clear();
-        directionalLights.clear();
-        spotLights.clear();
-        coneLights.clear();
-
-        for(auto entity : world->getEntities()){
-            // If we hadn't found a camera yet, we look for a camera in this entity
-            if(!camera) camera = entity->getComponent<CameraComponent>();
-
-            glm::mat4 localToWorld = entity->getLocalToWorldMatrix();
-            glm::vec4 position = localToWorld * glm::vec4(0, 0, 0, 1);
-
-            // If this entity has a mesh renderer component
-            for ( auto meshRenderer : entity->getAllComponents<MeshRendererComponent>()){
-                // We construct a command from it
-                RenderCommand command;
-                command.localToWorld = localToWorld;
-                command.center = glm::vec3(position);
-                command.mesh = meshRenderer->mesh;
-                command.shapeID = meshRenderer->shapeID;
-                command.material = meshRenderer->material;
-                // if it is transparent, we add it to the transparent commands list
-                if(command.material->transparent){
-                    transparentCommands.push_back(command);
-                } else {
-                // Otherwise, we add it to the opaque command list
-                    opaqueCommands.push_back(command);
-                }
-            }
+        // Demote the batched entities that started moving and update the batches before gathering the commands
+        updateStaticBatches(world);
+        prepareFrame(world);
+        submitFrame();
+    }
 
-            auto dl = entity->getComponent<DirectionalLight>();
-            if (dl != nullptr)
-                directionalLights.emplace_back(dl);
+    void ForwardRenderer::prepareFrame(World* world){
+        prepare(world, packets.getWriteBuffer());
+        packets.publish();
+    }
 
-            auto sl = entity->getComponent<SpotLight>();
-            if (sl != nullptr) {
-                spotLights.emplace_back(sl);
-                sl->worldPosition = glm::vec3(position);
-            }
+    bool ForwardRenderer::submitFrame(){
+        if (!packets.acquire() && !hasSubmittedPacket) return false;
+        hasSubmittedPacket = true;
+        submit(packets.getReadBuffer());
+        return true;
+    }
 
-            auto cl = entity->getAllComponents<ConeLight>();
-            for (auto k : cl){
-                coneLights.emplace_back(k);
-                k->worldPosition = glm::vec3(position);
-                k->worldDirection = glm::vec3(localToWorld * glm::vec4(k->direction , 0.0));
-            }
+    void ForwardRenderer::prepare(World* world, FramePacket& packet){
+        // First of all, we search for a camera and bring the render scene up to date with the world
+        CameraComponent* camera = nullptr;
+        packet.stats = RenderStats();
+        packet.hasCamera = false;
+        packet.opaqueCommands.clear();
+        packet.transparentCommands.clear();
+
+        // Only the proxies of the mesh renderers and the lights that were added, moved or changed are updated
+        scene.attach(world);
+        scene.sync();
+        auto& proxies = scene.getProxies();
+        for(auto index : scene.getChangedProxies()){
+            auto& command = proxies[index].command;
+            if(command.material == nullptr) continue;
+            command.pipelineStateId = getPipelineStateId(command.material->pipelineState);
+            command.instanceGroup = getInstanceGroup(command.material);
+            command.depthPrepass = canDepthPrepass(command.material);
         }
 
+        // The camera is the first camera component in the world
+        auto& cameras = world->getAllComponents<CameraComponent>();
+        if(!cameras.empty()) camera = cameras.front();
+
         // If there is no camera, we return (we cannot render without a camera)
         if(camera == nullptr) return;
 
@@ -192,17 +608,116 @@ namespace our {
         glm::vec3 cameraForward = glm::vec3(cameraForward_.x , cameraForward_.y , cameraForward_.z);
         glm::vec3 cameraCenter  = glm::vec3(cameraCenter_.x  , cameraCenter_.y  , cameraCenter_.z );
 
-        std::sort(
-                transparentCommands.begin(),
-                transparentCommands.end(),
-                [cameraForward,cameraCenter](const RenderCommand& first, const RenderCommand& second){
-            //TODO: (Req 9) Finish this function
-            // HINT: the following return should return true "first" should be drawn before "second".
-            return glm::dot((second.center - cameraCenter) , cameraForward) <  glm::dot((first.center - cameraCenter) , cameraForward);
-        });
-
         //TODO: (Req 9) Get the camera ViewProjection matrix and store it in VP
         auto VP = camera->getProjectionMatrix(this->windowSize) * camera->getViewMatrix();
+        Frustum frustum = Frustum::fromMatrix(VP);
+
+        // Adds a visible command to the transparent or the opaque commands list
+        auto addCommand = [&packet](const RenderCommand& command){
+            // if it is transparent, we add it to the transparent commands list
+            if(command.material->transparent){
+                packet.transparentCommands.push_back(command);
+            } else {
+            // Otherwise, we add it to the opaque command list
+                packet.opaqueCommands.push_back(command);
+            }
+        };
+
+        // Cull the proxies that are outside the camera frustum (their world bounds are kept by the scene)
+        scene.getCuller().cull(frustum, visibleCommands);
+        for (size_t i = 0; i < proxies.size(); i++){
+            const auto& proxy = proxies[i];
+            // The static objects are drawn by their batches
+            if (proxy.renderer->staticBatched || proxy.command.mesh == nullptr || proxy.command.material == nullptr) continue;
+            if (!visibleCommands[i]){
+                packet.stats.culledCommands++;
+                continue;
+            }
+            addCommand(proxy.command);
+        }
+
+        // Every static batch is one command, its bounds are already in the world space
+        auto& batches = staticBatcher.getBatches();
+        batchCuller.clear();
+        for(auto& batch : batches){
+            batchCuller.push(batch.mesh->bounds.box);
+        }
+        batchCuller.cull(frustum, visibleCommands);
+        for (size_t i = 0; i < batches.size(); i++){
+            if (!visibleCommands[i]){
+                packet.stats.culledCommands++;
+                continue;
+            }
+            RenderCommand command;
+            command.localToWorld = glm::mat4(1.0f);
+            command.normalMatrix = glm::mat3(1.0f);
+            command.center = batches[i].mesh->bounds.box.center;
+            command.mesh = batches[i].mesh;
+            command.shapeID = -1;
+            command.material = batches[i].material;
+            command.pipelineStateId = getPipelineStateId(command.material->pipelineState);
+            command.instanceGroup = NO_INSTANCE_GROUP;
+            command.staticBatch = true;
+            command.depthPrepass = canDepthPrepass(command.material);
+            addCommand(command);
+        }
+
+        // The transparent commands are drawn from back to front
+        packet.stats.transparentOrderReused = transparentSorter.sort(packet.transparentCommands, cameraCenter, cameraForward);
+
+        // The opaque commands don't need a depth order, so they are grouped by state instead
+        sortOpaqueCommands(packet, cameraCenter, cameraForward, camera->far);
+        limitObjects(packet);
+        // Both passes draw the instanced commands with the instanced shaders and the others with the default ones
+        markInstancedRuns(packet.opaqueCommands);
+        markInstancedRuns(packet.transparentCommands);
+
+        //TODO: (Req 10) We want the sky to be drawn behind everything (in NDC space, z=1)
+        // We can achieve the is by multiplying by an extra matrix after the projection but what values should we put in it?
+        glm::mat4 alwaysBehindTransform = glm::mat4(
+            1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, 1.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 1.0f
+        ); //this thing gets transposed ...
+
+        // The camera and the lights are uploaded once per frame and read by every lit draw of the frame
+        packet.hasCamera = true;
+        packet.VP = VP;
+        packet.frameData.camera = VP;
+        packet.frameData.skyCamera = alwaysBehindTransform * VP;
+        packet.frameData.cameraPosition = cameraCenter;
+        packet.frameData.areaLight = areaLight;
+        glm::vec3 viewDirection = glm::normalize(cameraForward);
+        glm::vec2 depthRange = getVisibleDepthRange(packet, cameraCenter, viewDirection, camera->near, camera->far);
+        gatherLights(packet, camera, cameraCenter, viewDirection, depthRange);
+
+        //TODO: (Req 10) Create a model matrix for the sy such that it always follows the camera (sky sphere center = camera position)
+        // (it is computed here since the sky reads its matrices from the object data like the other lit draws)
+        auto M = glm::translate(glm::mat4(1.0f) , cameraCenter);
+
+        // Create a scale matrix for the skybox
+        glm::mat4 skyboxScaleMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(camera->orthoHeight * 2, camera->orthoHeight * 2, camera->orthoHeight * 2));
+
+        // The matrices and tints of every draw of the frame are written once, the commands are sorted so their indices are final
+        writeObjectData(packet, M * skyboxScaleMatrix);
+
+        // The depth pre-pass order also creates the derived states of the commands it draws
+        if (depthPrepass) sortDepthPrepass(packet, cameraCenter, viewDirection, depthRange);
+
+        // The tables the ids of the commands refer to are copied since the next packet may add to them while this one is submitted
+        packet.pipelineStates = pipelineStates;
+        packet.depthPrepassStates = depthPrepassStates;
+    }
+
+    void ForwardRenderer::submit(const FramePacket& packet){
+        stats = packet.stats;
+        // If there is no camera, we return (we cannot render without a camera)
+        if (!packet.hasCamera) return;
+
+        uploadFrameData(packet);
+        uploadLights(packet);
+        uploadObjectData(packet);
 
         //TODO: (Req 9) Set the OpenGL viewport using viewportStart and viewportSize
         glViewport(0,0,windowSize.x , windowSize.y);
@@ -212,21 +727,14 @@ namespace our {
         glClearDepth(1);
 
         //TODO: (Req 9) Set the color mask to true and the depth mask to true (to ensure the glClear will affect the framebuffer)
-        glColorMask(true , true , true , true);
-        glDepthMask(true);
+        GLStateCache::getInstance().colorMask(glm::bvec4(true , true , true , true));
+        GLStateCache::getInstance().depthMask(true);
 
 
-        // If there is a postprocess material, bind the framebuffer
-        if (postprocessMaterial){
+        // If there is a postprocess plan, bind the framebuffer (its draw buffers were set when it was created)
+        if (postprocess){
             //TODO: (Req 11) bind the framebuffer
-            //glBindFramebuffer(GL_FRAMEBUFFER,this->postprocessFrameBuffer);
-            postprocessFramebuffer->bind();
-            auto* buff = new unsigned int[postprocessFramebuffer->getColorTexturesCount()];
-            for (int i = 0;i < postprocessFramebuffer->getColorTexturesCount();i++){
-                buff[i] = GL_COLOR_ATTACHMENT0 + i;
-            }
-            glDrawBuffers(postprocessFramebuffer->getColorTexturesCount() , buff);
-            delete[] buff;
+            postprocess->beginScene();
         }
 
         //TODO: (Req 9) Clear the color and depth buffers
@@ -234,225 +742,37 @@ namespace our {
 
         //TODO: (Req 9) Draw all the opaque commands
         // Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
-        for (auto k : opaqueCommands){
-            k.material->setup();
-            if (dynamic_cast<DefaultMaterial*>(k.material)){
-
-                // set up transform
-                k.material->shader->set("transform", k.localToWorld);
-                k.material->shader->set("Camera", VP);
-                k.material->shader->set("cameraPosition", cameraCenter);
-                k.material->shader->set("areaLight" , areaLight);
-
-                // set up lights
-                k.material->shader->set("directionalLightCount" , (GLint) directionalLights.size());
-                for (int i = 0;i < directionalLights.size();i++){
-                    std::stringstream ss;
-                    ss << "directionalLights[" << i << "].";
-                    auto header = ss.str();
-                    k.material->shader->set( header + "direction" , directionalLights[i]->direction);
-                    k.material->shader->set( header + "intensity" , directionalLights[i]->intensity);
-                    k.material->shader->set( header + "ambientColor" , directionalLights[i]->ambientColor);
-                    k.material->shader->set( header + "diffuseColor" , directionalLights[i]->diffuseColor);
-                    k.material->shader->set( header + "specularColor" , directionalLights[i]->specularColor);
-                }
-
-                k.material->shader->set("spotLightsCount" , (GLint) spotLights.size());
-                for (int i = 0;i < spotLights.size();i++){
-                    std::stringstream ss;
-                    ss << "spotLights[" << i << "].";
-                    auto header = ss.str();
-                    k.material->shader->set( header + "position" , spotLights[i]->worldPosition);
-                    k.material->shader->set( header + "intensity" , spotLights[i]->intensity);
-                    k.material->shader->set( header + "specularColor" , spotLights[i]->specularColor);
-                    k.material->shader->set( header + "diffuseColor" , spotLights[i]->diffuseColor);
-                    k.material->shader->set( header + "ambientColor" , spotLights[i]->ambientColor);
-                    k.material->shader->set( header + "attenuation" , spotLights[i]->attenuation);
-                }
-
-                k.material->shader->set("coneLightsCount" , (GLint) coneLights.size());
-                for (int i = 0;i < coneLights.size();i++){
-                    std::stringstream ss;
-                    ss << "coneLights[" << i << "].";
-                    auto header = ss.str();
-                    k.material->shader->set( header + "position" , coneLights[i]->worldPosition);
-                    k.material->shader->set( header + "direction" , coneLights[i]->worldDirection);
-                    k.material->shader->set( header + "intensity" , coneLights[i]->intensity);
-                    k.material->shader->set( header + "range" , coneLights[i]->range);
-                    k.material->shader->set( header + "ambientColor" , coneLights[i]->ambientColor);
-                    k.material->shader->set( header + "specularColor" , coneLights[i]->specularColor);
-                    k.material->shader->set( header + "diffuseColor" , coneLights[i]->diffuseColor);
-                    k.material->shader->set( header + "attenuation" , coneLights[i]->attenuation);
-                    k.material->shader->set( header + "smoothing" , coneLights[i]->smoothing);
-                    k.material->shader->set( header + "range" , coneLights[i]->range);
-                }
-            }else{
-                k.material->shader->set("transform", VP * k.localToWorld);
-            }
-            k.mesh->draw(k.shapeID);
+        if (depthPrepass){
+            // The depth of the opaque objects is laid down first (front to back, without any color work),
+            // so the lit pass only shades the fragments that end up visible
+            drawDepthPrepass(packet);
+            drawCommands(packet, packet.opaqueCommands, true);
+        } else {
+            drawCommands(packet, packet.opaqueCommands);
         }
 
         // If there is a sky material, draw the sky
         if(this->skyMaterial){
             //TODO: (Req 10) setup the sky material
             skyMaterial->setup();
-            skyMaterial->shader->set("areaLight" , areaLight);
 
             //TODO: (Req 10) Get the camera position
             //...
 
-            //TODO: (Req 10) Create a model matrix for the sy such that it always follows the camera (sky sphere center = camera position)
-            auto M = glm::translate(glm::mat4(1.0f) , cameraCenter);
-
-            //TODO: (Req 10) We want the sky to be drawn behind everything (in NDC space, z=1)
-            // We can achieve the is by multiplying by an extra matrix after the projection but what values should we put in it?
-            glm::mat4 alwaysBehindTransform = glm::mat4(
-                1.0f, 0.0f, 0.0f, 0.0f,
-                0.0f, 1.0f, 0.0f, 0.0f,
-                0.0f, 0.0f, 0.0f, 0.0f,
-                0.0f, 0.0f, 1.0f, 1.0f
-            ); //this thing gets transposed ...
-
-            // Create a scale matrix for the skybox
-            glm::mat4 skyboxScaleMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(camera->orthoHeight * 2, camera->orthoHeight * 2, camera->orthoHeight * 2));
-
             //TODO: (Req 10) set the "transform" uniform
-            skyMaterial->shader->set("transform", M * skyboxScaleMatrix);
-            skyMaterial->shader->set("Camera", alwaysBehindTransform * VP);
+            // (the sky material is a skybox, so the vertex shader uses the "SkyCamera" of the frame uniform buffer and its model matrix is in the object data)
+            skyMaterial->shader->set(getDrawUniforms(skyMaterial->shader).objectIndex, (GLint) packet.skyObjectIndex);
 
             //TODO: (Req 10) draw the sky sphere
             skySphere->draw();
         }
         //TODO: (Req 9) Draw all the transparent commands
         // Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
-        for (auto k : transparentCommands){
-            k.material->setup();
-            if (dynamic_cast<DefaultMaterial*>(k.material)){
-                // set up transform
-                k.material->shader->set("transform", k.localToWorld);
-                k.material->shader->set("Camera", VP);
-                k.material->shader->set("cameraPosition", cameraCenter);
-                k.material->shader->set("areaLight" , areaLight);
-
-                // set up lights
-                k.material->shader->set("directionalLightCount" , (GLint) directionalLights.size());
-                for (int i = 0;i < directionalLights.size();i++){
-                    std::stringstream ss;
-                    ss << "directionalLights[" << i << "].";
-                    auto header = ss.str();
-                    k.material->shader->set( header + "direction" , directionalLights[i]->direction);
-                    k.material->shader->set( header + "intensity" , directionalLights[i]->intensity);
-                    k.material->shader->set( header + "ambientColor" , directionalLights[i]->ambientColor);
-                    k.material->shader->set( header + "diffuseColor" , directionalLights[i]->diffuseColor);
-                    k.material->shader->set( header + "specularColor" , directionalLights[i]->specularColor);
-                }
-
-                k.material->shader->set("spotLightsCount" , (GLint) spotLights.size());
-                for (int i = 0;i < spotLights.size();i++){
-                    std::stringstream ss;
-                    ss << "spotLights[" << i << "].";
-                    auto header = ss.str();
-                    k.material->shader->set( header + "position" , spotLights[i]->worldPosition);
-                    k.material->shader->set( header + "intensity" , spotLights[i]->intensity);
-                    k.material->shader->set( header + "specularColor" , spotLights[i]->specularColor);
-                    k.material->shader->set( header + "diffuseColor" , spotLights[i]->diffuseColor);
-                    k.material->shader->set( header + "ambientColor" , spotLights[i]->ambientColor);
-                    k.material->shader->set( header + "attenuation" , spotLights[i]->attenuation);
-                }
-
-                k.material->shader->set("coneLightsCount" , (GLint) coneLights.size());
-                for (int i = 0;i < coneLights.size();i++){
-                    std::stringstream ss;
-                    ss << "coneLights[" << i << "].";
-                    auto header = ss.str();
-                    k.material->shader->set( header + "position" , coneLights[i]->worldPosition);
-                    k.material->shader->set( header + "direction" , coneLights[i]->worldDirection);
-                    k.material->shader->set( header + "intensity" , coneLights[i]->intensity);
-                    k.material->shader->set( header + "range" , coneLights[i]->range);
-                    k.material->shader->set( header + "ambientColor" , coneLights[i]->ambientColor);
-                    k.material->shader->set( header + "specularColor" , coneLights[i]->specularColor);
-                    k.material->shader->set( header + "diffuseColor" , coneLights[i]->diffuseColor);
-                    k.material->shader->set( header + "attenuation" , coneLights[i]->attenuation);
-                    k.material->shader->set( header + "smoothing" , coneLights[i]->smoothing);
-                    k.material->shader->set( header + "range" , coneLights[i]->range);
-                }
-            }else{
-                k.material->shader->set("transform", VP * k.localToWorld);
-            }
-            k.mesh->draw(k.shapeID);
-        }
-
-        // If there is a postprocess material, apply postprocessing
-        if(postprocessMaterial){
-            postprocessFramebuffer->unbind();
-
-
-            our::SUPPRESS_SHADER_ERRORS = true; //for my mental stability ...
-            glBindVertexArray(postProcessVertexArray);
-
-            Framebuffer* from = postprocessFramebuffer ;
-            Framebuffer* next = postprocessFramebuffer2;
-            for (int i = 0;i < postprocessShaders.size();i++){
-                auto bound = false;
-                if (i != postprocessShaders.size() - 1) {
-                    next->bind();
-                    bound = true;
-                    auto* buff = new unsigned int[next->getColorTexturesCount()];
-                    for (int k = 0;k < next->getColorTexturesCount();k++){
-                        buff[k] = GL_COLOR_ATTACHMENT0 + k;
-                    }
-                    glDrawBuffers(next->getColorTexturesCount() , buff);
-                    delete[] buff;
-                }
+        drawCommands(packet, packet.transparentCommands);
 
-                auto shader = postprocessShaders[i];
-                postprocessMaterial->textures.clear();
-                postprocessMaterial->samplers.clear();
-                for (int j = 0;j < from->getColorTexturesCount();j++){
-                    postprocessMaterial->textures.emplace_back(from->getColorTexture(j));
-                    postprocessMaterial->samplers.emplace_back(postprocessSampler);
-                }
-
-                postprocessMaterial->shader = shader;
-                postprocessMaterial->setup();
-
-                //now setup the extra params
-                for (auto& [name, desc]  : postprocessData[i].items()){
-                    if (desc.is_boolean()){
-                        shader->set(name , desc.get<bool>() ? 1 : 0);
-                    } else if (desc.is_number_float()){
-                        shader->set(name , desc.get<float>());
-                    } else if (desc.is_number_integer()){
-                        shader->set(name , desc.get<int>());
-                    } else if (desc.is_number()){
-                        shader->set(name , desc.get<float>());
-                    } else if (desc.is_array()){
-                        int s = (int) desc.size();
-                        if (s == 1){
-                            shader->set(name , desc[0].get<float>());
-                        } else if (s == 2) {
-                            shader->set(name , desc.get<glm::vec2>());
-                        } else if (s == 3) {
-                            shader->set(name , desc.get<glm::vec3>());
-                        } else if (s == 4) {
-                            shader->set(name , desc.get<glm::vec4>());
-                        }
-                    }
-                }
-
-                glDrawArrays(GL_TRIANGLES,0,3);
-
-                if (bound) next->unbind();
-
-                if (next == postprocessFramebuffer){
-                    next = postprocessFramebuffer2;
-                    from = postprocessFramebuffer;
-                }else {
-                    next = postprocessFramebuffer;
-                    from = postprocessFramebuffer2;
-                }
-            }
-            our::SUPPRESS_SHADER_ERRORS = false;
+        // If there is a postprocess plan, apply postprocessing
+        if(postprocess){
+            postprocess->execute();
         }
     }
 
@@ -4,67 +4,209 @@
 #include "../components/camera.hpp"
 #include "../components/mesh-renderer.hpp"
 #include "../asset-loader.hpp"
-#include "../components/DirectionalLight.hpp"
-#include "components/SpotLight.h"
-#include "components/ConeLight.h"
 #include "texture/framebuffer.h"
+#include "shader/uniform-buffer.hpp"
+#include "shader/uniform-blocks.hpp"
+#include "radix-sort.hpp"
+#include "render-scene.hpp"
+#include "static-batcher.hpp"
+#include "postprocess-plan.hpp"
+#include "light-clusters.hpp"
+#include "frame-packet.hpp"
+#include "transparent-sorter.hpp"
+#include "../jobs/triple-buffer.hpp"
 
 #include <glad/gl.h>
 #include <vector>
 #include <algorithm>
+#include <unordered_map>
 
 namespace our
 {
     
-    // The render command stores command that tells the renderer that it should draw
-    // the given mesh at the given localToWorld matrix using the given material
-    // The renderer will fill this struct using the mesh renderer components
-    struct RenderCommand {
-        glm::mat4 localToWorld;
-        glm::vec3 center;
-        Mesh* mesh;
-        int shapeID;
-        Material* material;
+    // The locations of the uniforms that the renderer sends to a shader for every draw.
+    // They are resolved once per shader so that drawing an object never looks up a uniform name.
+    struct DrawUniforms {
+        GLint transform;    // The model-view-projection matrix of the unlit shaders
+        GLint objectIndex;  // The index of the object data read by the default vertex shader
+
+        explicit DrawUniforms(const ShaderProgram* shader);
     };
 
     // A forward renderer is a renderer that draw the object final color directly to the framebuffer
     // In other words, the fragment shader in the material should output the color that we should see on the screen
     // This is different from more complex renderers that could draw intermediate data to a framebuffer before computing the final color
     // In this project, we only need to implement a forward renderer
+    //
+    // A frame is rendered in two steps: "prepareFrame" turns the world into a frame packet (gathering, culling and sorting the commands,
+    // binning the lights and writing the object data) without any OpenGL call, then "submitFrame" uploads the packet and draws it.
+    // The packets go through a triple buffer, so with "pipelined" set in the renderer config, the packet of a frame can be prepared
+    // on another thread (together with the simulation of that frame) while the thread that owns the OpenGL context submits the previous one.
+    // The members used by each step are only touched by that step, and the tables shared by both (e.g. the pipeline states) are copied to the packet.
     class ForwardRenderer {
         // These window size will be used on multiple occasions (setting the viewport, computing the aspect ratio, etc.)
         glm::ivec2 windowSize;
-        // These are two vectors in which we will store the opaque and the transparent commands.
-        // We define them here (instead of being local to the "render" function) as an optimization to prevent reallocating them every frame
-        std::vector<RenderCommand> opaqueCommands;
-        std::vector<RenderCommand> transparentCommands;
+        // The packets of the frames. The opaque and the transparent commands are stored in the packet being prepared,
+        // and since the packets are reused, their vectors are not reallocated every frame
+        TripleBuffer<FramePacket> packets;
+        // True once a packet was acquired, so "submitFrame" can draw it again till a newer one is published
+        bool hasSubmittedPacket = false;
+        bool pipelined = false;
 
-        std::vector<DirectionalLight*> directionalLights;
-        std::vector<SpotLight*> spotLights;
-        std::vector<ConeLight*> coneLights;
+        // The retained proxies of the mesh renderers and the lights of the world, only the ones that changed are updated every frame
+        RenderScene scene;
+        FrustumCuller batchCuller; // The bounds of the static batches
+        std::vector<uint8_t> visibleCommands;
 
         // Objects used for rendering a skybox
         Mesh* skySphere;
         DefaultMaterial* skyMaterial;
         glm::vec3 areaLight;
-        // Objects used for Postprocessing
+        // The post-process effects compiled from the config (null if the level has none)
+        PostprocessPlan* postprocess = nullptr;
+
+        // The camera and the lights are the same for every draw of a frame, so they are uploaded once per frame
+        // to these uniform buffers (bound to the "Frame" and "Lights" blocks of the lit shaders)
+        UniformBuffer* frameUniformBuffer = nullptr;
+        UniformBuffer* lightsUniformBuffer = nullptr;
+
+        // The uniform locations of every shader drawn so far (it is cleared in "destroy" since the shaders are deleted with the assets)
+        std::unordered_map<const ShaderProgram*, DrawUniforms> drawUniforms;
+
+        // Returns the uniform locations of the given shader, resolving them the first time the shader is seen
+        const DrawUniforms& getDrawUniforms(const ShaderProgram* shader);
+        // Fills the frame uniform buffer with the camera of the packet
+        void uploadFrameData(const FramePacket& packet);
+        // Copies the directional lights to the packet and builds the light clusters of the view (see "LightClusters")
+        void gatherLights(FramePacket& packet, const CameraComponent* camera, const glm::vec3& cameraCenter, const glm::vec3& cameraForward, glm::vec2 depthRange);
+        // Fills the lights uniform buffer and the texture buffers of the clusters with the lights of the packet
+        void uploadLights(const FramePacket& packet);
+        // Returns the range of the view depth covered by the bounds of the gathered commands (clamped to the near and far planes)
+        static glm::vec2 getVisibleDepthRange(const FramePacket& packet, const glm::vec3& cameraCenter, const glm::vec3& cameraForward, float near, float far);
+        // The spot and cone lights binned by the part of the view they can reach
+        LightClusters lightClusters;
+        // The opaque commands are sorted by a 64-bit key so that draws sharing the same state are consecutive.
+        // From the most to the least significant bits, the key holds:
+        // the pipeline state id (8 bits), the shader id (12 bits), the material id (16 bits), the mesh id (16 bits) and the depth bucket (12 bits).
+        // Materials that can be instanced together use their instance group as their material id so that their commands end up next to each other.
+        // The ids are given to the objects the first time they are drawn (they only decide the order, so sharing an id when there are too many is harmless).
+        std::vector<PipelineState> pipelineStates;
+        std::unordered_map<const void*, uint32_t> shaderIds, materialIds, meshIds;
+        std::vector<SortItem> sortItems, sortScratch;
+        std::vector<RenderCommand> sortedCommands;
+        RenderStats stats; // The stats of the last submitted frame
+
+        // Returns the id of the given pipeline state, equal states get the same id
+        uint32_t getPipelineStateId(const PipelineState& state);
+        // Returns the id of the given object in the given table, adding it if it is new
+        static uint32_t getObjectId(std::unordered_map<const void*, uint32_t>& ids, const void* object);
+        // Sorts the opaque commands by their keys (front to back inside each state group)
+        void sortOpaqueCommands(FramePacket& packet, const glm::vec3& cameraCenter, const glm::vec3& cameraForward, float far);
+        // Sorts the transparent commands from back to front, reusing the order of the last frame when it can (see "TransparentSorter")
+        TransparentSorter transparentSorter;
+        // Draws the commands in order and only sets the pipeline state, the shader and the material uniforms when they differ from the previous draw.
+        // If "afterDepthPrepass" is true, the commands drawn by the depth pre-pass only pass the depth test where their depth is equal to the stored one
+        void drawCommands(const FramePacket& packet, const std::vector<RenderCommand>& commands, bool afterDepthPrepass = false);
 
-        Framebuffer* postprocessFramebuffer;
-        Framebuffer* postprocessFramebuffer2;
+        // The depth pre-pass (enabled by "depthPrepass" in the renderer config) draws the opaque lit commands with a depth-only program first.
+        // The color pass then draws them with GL_EQUAL depth testing and no depth writes, so the expensive lit fragment shader
+        // only runs once per pixel for them. The pre-pass goes from front to back (in coarse depth buckets so that the commands
+        // of the same mesh inside a bucket can still be drawn as instances, which only needs the same mesh since there is no material).
+        bool depthPrepass = false;
+        ShaderProgram* depthShader = nullptr;          // default.vert with depth-only.frag
+        ShaderProgram* depthInstancedShader = nullptr; // default-instanced.vert with depth-only.frag
+        ShaderProgram* depthBatchedShader = nullptr;   // default-batched.vert with depth-only.frag
+        static constexpr int DEPTH_PREPASS_BUCKET_BITS = 6;
+        // The pipeline states derived from each pipeline state (by id) for the two passes
+        std::vector<DepthPrepassStates> depthPrepassStates;
+        // Returns true if commands of the material can be drawn in the pre-pass: opaque lit materials drawn by default.vert
+        // (their fragment shaders never discard) that test and write the depth
+        static bool canDepthPrepass(const Material* material);
+        // Returns the derived states of the given pipeline state id, creating them the first time
+        const DepthPrepassStates& getDepthPrepassStates(uint32_t pipelineStateId);
+        // Orders the opaque commands of the pre-pass by depth bucket (front to back), then by state and mesh
+        void sortDepthPrepass(FramePacket& packet, const glm::vec3& cameraCenter, const glm::vec3& cameraForward, glm::vec2 depthRange);
+        // Draws the depth of the commands in the pre-pass order of the packet
+        void drawDepthPrepass(const FramePacket& packet);
 
-        GLuint postProcessVertexArray;
-        MultiTexturedMaterial* postprocessMaterial;
-        std::vector<ShaderProgram*> postprocessShaders;
-        std::vector<nlohmann::json> postprocessData;
-        Sampler* postprocessSampler;
+        // Instancing: the commands of lit materials that only differ by their tint are put in instance groups
+        // (kept till "destroy" since the proxies keep their groups and only ask for one when their material changes).
+        // A run of at least MIN_INSTANCES consecutive commands with the same group and mesh is drawn with one glDrawElementsInstanced
+        // using the instanced variant of the material shader, with the object index of every instance in "instanceBuffer".
+        // The runs are found once per frame by "markInstancedRuns" and the pre-pass draws every command with the same vertex shader
+        // as the color pass (default.vert or default-instanced.vert), since the color pass tests for an equal depth.
+        static constexpr size_t MIN_INSTANCES = 2;
+        std::vector<const DefaultMaterial*> instanceGroups; // The first material of every group
+        std::unordered_map<const ShaderProgram*, ShaderProgram*> instancedShaders; // nullptr if the shader has no instanced variant
+        std::unordered_map<const ShaderProgram*, ShaderProgram*> batchedShaders;   // nullptr if the shader has no static batch variant
+        std::vector<uint32_t> instanceObjects;
+        GLuint instanceBuffer = 0;
+        size_t instanceBufferCapacity = 0;
+
+        // Returns the instance group of the given material or NO_INSTANCE_GROUP if it can't be instanced
+        uint32_t getInstanceGroup(const Material* material);
+        // Sets "instanced" on the commands of the runs of at least MIN_INSTANCES commands (in their draw order)
+        static void markInstancedRuns(std::vector<RenderCommand>& commands);
+        // Returns the variant of the given shader that uses the given vertex shader with the same fragment shader (built the first time and kept in "variants").
+        // It returns nullptr if the shader doesn't use the default vertex shader (the variants are only written for it)
+        static ShaderProgram* getShaderVariant(std::unordered_map<const ShaderProgram*, ShaderProgram*>& variants,
+                                               const ShaderProgram* shader, const std::string& vertexShader);
+        ShaderProgram* getInstancedShader(const ShaderProgram* shader) { return getShaderVariant(instancedShaders, shader, "assets/shaders/default-instanced.vert"); }
+        ShaderProgram* getBatchedShader(const ShaderProgram* shader) { return getShaderVariant(batchedShaders, shader, "assets/shaders/default-batched.vert"); }
+        // Uploads "instanceObjects" to the instance buffer
+        void uploadInstanceData();
+
+        // The object data: the model matrix, the normal matrix and the tint of every command drawn this frame (OBJECT_DATA_TEXELS texels each).
+        // The matrices are computed by the render scene when the objects move, so the default vertex shaders only fetch them
+        // (by the "objectIndex" uniform or the object index of the instance) instead of inverting the model matrix for every vertex.
+        // The data is written to the packet after the commands are sorted, and the whole frame is uploaded at once (with orphaning).
+        TextureBuffer* objectBuffer = nullptr;
+        // The number of objects the object data can hold: GL_MAX_TEXTURE_BUFFER_SIZE / OBJECT_DATA_TEXELS
+        // (OpenGL 3.3 only guarantees 65536 texels, so 8192 objects)
+        uint32_t maxObjects = 0;
+        bool reportedObjectLimit = false; // The error is only printed for the first frame that exceeds the limit
+        // Drops the commands that don't fit in the object data (with the sky): the farthest transparent commands first,
+        // then the opaque commands at the end of their order. Their data would be read out of the buffer
+        void limitObjects(FramePacket& packet);
+        // Appends the data of an object and returns its index
+        static uint32_t addObjectData(std::vector<glm::vec4>& texels, const glm::mat4& localToWorld, const glm::mat3& normalMatrix, const glm::vec4& tint);
+        // Gives every opaque and transparent command (and the sky) of the packet its object index and writes their data
+        void writeObjectData(FramePacket& packet, const glm::mat4& skyTransform) const;
+        // Uploads and binds the object data of the packet
+        void uploadObjectData(const FramePacket& packet);
+
+        // Builds the packet of the world (it makes no OpenGL call, so it can run on any thread)
+        void prepare(World* world, FramePacket& packet);
+        // Draws the packet (on the thread that owns the OpenGL context)
+        void submit(const FramePacket& packet);
+
+        // The objects that never move are merged in static batches when the level is loaded (see "buildStaticBatches"),
+        // each batch is drawn as one command and its mesh renderers are skipped while gathering the commands
+        StaticBatcher staticBatcher;
     public:
         // Initialize the renderer including the sky and the Postprocessing objects.
         // windowSize is the width & height of the window (in pixels).
         void initialize(glm::ivec2 windowSize, const nlohmann::json& config);
         // Clean up the renderer
         void destroy();
-        // This function should be called every frame to draw the given world
+        // This function should be called every frame to draw the given world (it updates the static batches, prepares and submits the frame)
         void render(World* world);
+        // Merges the static objects of the world in batches. It should be called once the level is loaded
+        void buildStaticBatches(World* world) { staticBatcher.build(world); }
+
+        // The steps of "render" for the pipelined mode. Every frame, "updateStaticBatches" has to run first on the OpenGL thread
+        // while nothing else uses the world, then "prepareFrame" (on any thread) and "submitFrame" (on the OpenGL thread) can run at the same time.
+        bool isPipelined() const { return pipelined; }
+        // Demotes the batched entities that started moving and updates the batches (it uses OpenGL)
+        void updateStaticBatches(World* world) { staticBatcher.update(world); }
+        // Prepares the packet of the world and publishes it
+        void prepareFrame(World* world);
+        // Draws the latest published packet. If none was published since the last call, the last packet is drawn again
+        // (so in the pipelined mode, this frame draws the packet of the last frame while the packet of this frame is prepared).
+        // Returns false (without drawing anything) only if no packet was ever published
+        bool submitFrame();
+        // Returns the draw and state change counts of the last rendered frame
+        const RenderStats& getStats() const { return stats; }
 
     };
 
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "render-scene.hpp"
+#include "light-clusters.hpp"
+#include "../material/pipeline-state.hpp"
+#include "../shader/uniform-blocks.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace our {
+
+    // The number of commands and draw calls of the last frame and how many times each part of the material state had to be set.
+    // Without sorting, state tracking and instancing, every command was its own draw call and set all three of them.
+    struct RenderStats {
+        size_t commands = 0;
+        size_t culledCommands = 0; // The commands that were skipped since they are outside the camera frustum
+        size_t droppedCommands = 0; // The visible commands that were skipped since the object data can't hold them (see "ForwardRenderer::limitObjects")
+        size_t drawCalls = 0;
+        size_t instancedDrawCalls = 0;
+        size_t staticBatchDrawCalls = 0;
+        size_t depthPrepassDrawCalls = 0; // The draw calls of the depth pre-pass (they are not counted in "drawCalls")
+        size_t pipelineStateChanges = 0;
+        size_t shaderChanges = 0;
+        size_t materialChanges = 0;
+        size_t clusteredLights = 0;      // The spot and cone lights that can reach a visible object
+        size_t clusterLightIndices = 0;  // The total length of the light lists of the clusters
+        bool transparentOrderReused = false; // True if the transparent commands kept the last frame order (fixed by an insertion sort)
+
+        size_t getStateChanges() const { return pipelineStateChanges + shaderChanges + materialChanges; }
+        size_t getSavedStateChanges() const { return 3 * commands - getStateChanges(); }
+    };
+
+    // The pipeline states derived from a pipeline state (by id) for the two passes of the depth pre-pass
+    struct DepthPrepassStates {
+        uint32_t depthOnly;  // No color writes
+        uint32_t depthEqual; // GL_EQUAL depth test and no depth writes
+    };
+
+    // A frame packet is everything the renderer needs to submit a frame to OpenGL, built from the world by "ForwardRenderer::prepareFrame".
+    // It is flattened and self-contained: the commands are copies of the render proxies (the meshes, the materials and their shaders
+    // are assets that outlive the frame, and the static batcher keeps the meshes of the batches it merges again till its next update), the camera, the lights, the light clusters and the object data are stored by value, and so are
+    // the tables the command ids refer to. The tint, the only material value the systems change, is copied into every command,
+    // and the rest of the material is only read through "Material::setupStaticUniforms". So once it is published, submitting it never reads the world or the render scene,
+    // and the next packet can be prepared while it is submitted.
+    // The post-process plan is compiled once at initialization and has no per-frame params, so nothing of it is in the packet.
+    struct FramePacket {
+        bool hasCamera = false;   // Nothing is drawn if the world has no camera
+        glm::mat4 VP;
+        FrameBlock frameData;
+        LightsBlock lightsData;
+        LightClusterData clusters;
+        std::vector<glm::vec4> objectTexels;          // OBJECT_DATA_TEXELS texels per object, indexed by RenderCommand::objectIndex
+        uint32_t skyObjectIndex = 0;
+        std::vector<RenderCommand> opaqueCommands;     // Sorted by state
+        std::vector<RenderCommand> transparentCommands; // Sorted from back to front
+        std::vector<uint32_t> depthPrepassOrder;       // The indices of the opaque commands drawn by the depth pre-pass, in order
+        std::vector<PipelineState> pipelineStates;     // The pipeline states by id (see "RenderCommand::pipelineStateId")
+        std::vector<DepthPrepassStates> depthPrepassStates;
+        RenderStats stats;                             // The stats of the preparation (the draw counts are added when it is submitted)
+    };
+
+}
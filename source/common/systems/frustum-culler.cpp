@@ -0,0 +1,126 @@
+#include "frustum-culler.hpp"
+
+#if defined(__AVX__)
+#define OUR_FRUSTUM_CULLER_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OUR_FRUSTUM_CULLER_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace our {
+
+    Frustum Frustum::fromMatrix(const glm::mat4& viewProjection) {
+        // glm matrices are column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+        auto row = [&viewProjection](int i) {
+            return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        };
+        glm::vec4 x = row(0), y = row(1), z = row(2), w = row(3);
+
+        Frustum frustum;
+        frustum.planes[0] = w + x; // left
+        frustum.planes[1] = w - x; // right
+        frustum.planes[2] = w + y; // bottom
+        frustum.planes[3] = w - y; // top
+        frustum.planes[4] = w + z; // near
+        frustum.planes[5] = w - z; // far
+        for (auto& plane : frustum.planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return frustum;
+    }
+
+    void FrustumCuller::push(const AABB& box) {
+        if (count == centerX.size()) {
+            for (auto* array : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ}) {
+                array->resize(count + 8, 0.0f);
+            }
+        }
+        set(count++, box);
+    }
+
+    void FrustumCuller::set(size_t index, const AABB& box) {
+        centerX[index] = box.center.x;
+        centerY[index] = box.center.y;
+        centerZ[index] = box.center.z;
+        extentX[index] = box.extent.x;
+        extentY[index] = box.extent.y;
+        extentZ[index] = box.extent.z;
+    }
+
+    void FrustumCuller::erase(size_t index) {
+        count--;
+        for (auto* array : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ}) {
+            (*array)[index] = (*array)[count];
+            // The padding stays zero so the unused lanes never read stale boxes
+            (*array)[count] = 0.0f;
+        }
+    }
+
+    void FrustumCuller::cull(const Frustum& frustum, std::vector<uint8_t>& visible) const {
+        // The arrays are padded to a multiple of 8, so the SIMD loops can always store the 8 results of a block
+        visible.resize(centerX.size());
+        size_t i = 0;
+
+#if defined(OUR_FRUSTUM_CULLER_AVX)
+        for (; i < count; i += 8) {
+            __m256 cx = _mm256_loadu_ps(&centerX[i]), cy = _mm256_loadu_ps(&centerY[i]), cz = _mm256_loadu_ps(&centerZ[i]);
+            __m256 ex = _mm256_loadu_ps(&extentX[i]), ey = _mm256_loadu_ps(&extentY[i]), ez = _mm256_loadu_ps(&extentZ[i]);
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (const auto& plane : frustum.planes) {
+                // The signed distance of the center plus the projection of the extent on the absolute normal
+                // (the distance of the box corner that is the farthest along the normal)
+                __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), cx), _mm256_mul_ps(_mm256_set1_ps(plane.y), cy));
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.z), cz));
+                distance = _mm256_add_ps(distance, _mm256_set1_ps(plane.w));
+                __m256 radius = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(glm::abs(plane.x)), ex), _mm256_mul_ps(_mm256_set1_ps(glm::abs(plane.y)), ey));
+                radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(glm::abs(plane.z)), ez));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+            }
+            int mask = _mm256_movemask_ps(inside);
+            for (int lane = 0; lane < 8; lane++) visible[i + lane] = (mask >> lane) & 1;
+        }
+#elif defined(OUR_FRUSTUM_CULLER_SSE)
+        for (; i < count; i += 8) {
+            // The block of 8 is processed as two halves of 4
+            for (size_t half = i; half < i + 8; half += 4) {
+                __m128 cx = _mm_loadu_ps(&centerX[half]), cy = _mm_loadu_ps(&centerY[half]), cz = _mm_loadu_ps(&centerZ[half]);
+                __m128 ex = _mm_loadu_ps(&extentX[half]), ey = _mm_loadu_ps(&extentY[half]), ez = _mm_loadu_ps(&extentZ[half]);
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (const auto& plane : frustum.planes) {
+                    __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy));
+                    distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), cz));
+                    distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+                    __m128 radius = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(glm::abs(plane.x)), ex), _mm_mul_ps(_mm_set1_ps(glm::abs(plane.y)), ey));
+                    radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(glm::abs(plane.z)), ez));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+                }
+                int mask = _mm_movemask_ps(inside);
+                for (int lane = 0; lane < 4; lane++) visible[half + lane] = (mask >> lane) & 1;
+            }
+        }
+#endif
+
+        // The scalar version (only used if there is no SIMD support)
+        cullScalar(frustum, i, visible);
+        visible.resize(count);
+    }
+
+    void FrustumCuller::cullScalar(const Frustum& frustum, std::vector<uint8_t>& visible) const {
+        visible.resize(count);
+        cullScalar(frustum, 0, visible);
+    }
+
+    void FrustumCuller::cullScalar(const Frustum& frustum, size_t begin, std::vector<uint8_t>& visible) const {
+        for (size_t i = begin; i < count; i++) {
+            uint8_t inside = 1;
+            for (const auto& plane : frustum.planes) {
+                float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+                float radius = glm::abs(plane.x) * extentX[i] + glm::abs(plane.y) * extentY[i] + glm::abs(plane.z) * extentZ[i];
+                if (distance + radius < 0.0f) inside = 0;
+            }
+            visible[i] = inside;
+        }
+    }
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../mesh/bounds.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace our {
+
+    // The 6 planes of a camera frustum in world space.
+    // Each plane is stored as (normal, distance) with the normal pointing inside, so a point p is inside the frustum if
+    // dot(normal, p) + distance >= 0 for all the planes
+    struct Frustum {
+        glm::vec4 planes[6];
+
+        // Extracts the planes from a view projection matrix (Gribb & Hartmann), the planes are normalized
+        static Frustum fromMatrix(const glm::mat4& viewProjection);
+    };
+
+    // The frustum culler tests many world space bounding boxes against a frustum at once.
+    // The boxes are stored in SoA form and tested 8 at a time: with AVX in one 8-wide register, otherwise as two 4-wide SSE halves
+    // (and with a scalar loop if neither is available).
+    // A box is culled if it is completely on the outside of one of the planes. This is conservative: a box near a corner of the
+    // frustum may be kept even if it is outside, but a visible box is never culled.
+    class FrustumCuller {
+        std::vector<float> centerX, centerY, centerZ;
+        std::vector<float> extentX, extentY, extentZ;
+        size_t count = 0; // The arrays are padded to a multiple of 8, so the number of boxes is stored separately
+
+        // Tests the boxes from "begin" to the end one by one ("visible" must already have room for them)
+        void cullScalar(const Frustum& frustum, size_t begin, std::vector<uint8_t>& visible) const;
+    public:
+        size_t size() const { return count; }
+        void clear() { count = 0; }
+        // Adds a box (in world space), its index is the number of boxes added before it
+        void push(const AABB& box);
+        // Replaces the box at the given index
+        void set(size_t index, const AABB& box);
+        // Removes the box at the given index, the last box is moved to its place
+        void erase(size_t index);
+        // Fills "visible" with one value per box: 1 if the box intersects the frustum (or could), 0 if it is outside
+        void cull(const Frustum& frustum, std::vector<uint8_t>& visible) const;
+        // The same as "cull" but always uses the scalar loop. It is the reference for the tests and the benchmarks of the SIMD versions
+        void cullScalar(const Frustum& frustum, std::vector<uint8_t>& visible) const;
+    };
+
+}
@@ -0,0 +1,174 @@
+#include "light-clusters.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace our {
+
+    float LightClusters::getInfluenceRadius(float intensity, const glm::vec3& diffuseColor, const glm::vec3& specularColor, const glm::vec3& attenuation) {
+        // The diffuse and the specular terms can add up on the same fragment
+        glm::vec3 color = diffuseColor + specularColor;
+        float brightness = intensity * std::max({color.r, color.g, color.b});
+        if (brightness <= 0.0f) return 0.0f;
+
+        // "default.frag" divides the light by attenuation.x * d^2 + attenuation.y * d + attenuation.z,
+        // so the radius is where this divider reaches brightness / LIGHT_INFLUENCE_CUTOFF
+        float a = attenuation.x, b = attenuation.y, c = attenuation.z - brightness / LIGHT_INFLUENCE_CUTOFF;
+        if (c >= 0.0f) return 0.0f;
+        if (a > 0.0f) return (-b + std::sqrt(b * b - 4.0f * a * c)) / (2.0f * a);
+        if (a == 0.0f && b > 0.0f) return -c / b;
+        return INFINITY;
+    }
+
+    void LightClusters::create() {
+        lightBuffer = new TextureBuffer(GL_RGBA32F);
+        gridBuffer = new TextureBuffer(GL_RG32UI);
+        indexBuffer = new TextureBuffer(GL_R16UI);
+    }
+
+    void LightClusters::destroy() {
+        delete lightBuffer;
+        delete gridBuffer;
+        delete indexBuffer;
+        lightBuffer = gridBuffer = indexBuffer = nullptr;
+    }
+
+    void LightClusters::addLight(LightClusterData& data, const glm::vec3& position, float intensity, const glm::vec3& diffuseColor, const glm::vec3& specularColor,
+                                 const glm::vec3& attenuation, const glm::vec3& direction, int smoothing, const glm::vec2& range) {
+        // The index list stores 16-bit indices
+        if (lightCells.size() > UINT16_MAX) return;
+        float radius = getInfluenceRadius(intensity, diffuseColor, specularColor, attenuation);
+        if (radius <= 0.0f) return;
+
+        CellRange cells;
+        cells.min = glm::ivec3(0);
+        cells.max = glm::ivec3(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1, CLUSTER_GRID_Z - 1);
+        if (!std::isinf(radius)){
+            // The slices of the depth range of the sphere (it can't light anything outside the depth range of the visible objects)
+            float depth = glm::dot(position - cameraCenter, cameraForward);
+            if (depth + radius < depthRange.x || depth - radius > depthRange.y) return;
+            auto slice = [this](float d){
+                int index = (int) std::floor(std::log(std::max(d, depthRange.x)) * sliceScale.x + sliceScale.y);
+                return std::clamp(index, 0, CLUSTER_GRID_Z - 1);
+            };
+            cells.min.z = slice(depth - radius);
+            cells.max.z = slice(depth + radius);
+
+            // The tiles covered by the projection of the box around the sphere (the whole screen if the box crosses the camera plane)
+            glm::vec3 viewCenter = glm::vec3(view * glm::vec4(position, 1.0f));
+            glm::vec2 ndcMin(-1.0f), ndcMax(1.0f);
+            glm::vec2 projectedMin(FLT_MAX), projectedMax(-FLT_MAX);
+            bool crossesCamera = false;
+            for (int corner = 0; corner < 8; corner++){
+                glm::vec3 offset((corner & 1) ? radius : -radius, (corner & 2) ? radius : -radius, (corner & 4) ? radius : -radius);
+                glm::vec4 clip = projection * glm::vec4(viewCenter + offset, 1.0f);
+                if (clip.w <= 1e-5f){
+                    crossesCamera = true;
+                    break;
+                }
+                glm::vec2 ndc = glm::vec2(clip) / clip.w;
+                projectedMin = glm::min(projectedMin, ndc);
+                projectedMax = glm::max(projectedMax, ndc);
+            }
+            if (!crossesCamera){
+                if (projectedMax.x < -1.0f || projectedMax.y < -1.0f || projectedMin.x > 1.0f || projectedMin.y > 1.0f) return;
+                ndcMin = projectedMin;
+                ndcMax = projectedMax;
+            }
+            auto tile = [](float ndc, int count){
+                int index = (int) std::floor(glm::clamp(ndc * 0.5f + 0.5f, 0.0f, 1.0f) * (float) count);
+                return std::min(index, count - 1);
+            };
+            cells.min.x = tile(ndcMin.x, CLUSTER_GRID_X);
+            cells.max.x = tile(ndcMax.x, CLUSTER_GRID_X);
+            cells.min.y = tile(ndcMin.y, CLUSTER_GRID_Y);
+            cells.max.y = tile(ndcMax.y, CLUSTER_GRID_Y);
+        }
+
+        auto& lightTexels = data.lightTexels;
+        lightTexels.emplace_back(position, intensity);
+        lightTexels.emplace_back(diffuseColor, (float) smoothing);
+        lightTexels.emplace_back(specularColor, range.y);
+        lightTexels.emplace_back(attenuation, 0.0f);
+        float length = glm::length(direction);
+        lightTexels.emplace_back(length > 0.0f ? direction / length : direction, range.x);
+        lightCells.push_back(cells);
+    }
+
+    void LightClusters::build(const RenderScene& scene, const glm::mat4& view, const glm::mat4& projection, glm::ivec2 viewportSize,
+                              const glm::vec3& cameraCenter, const glm::vec3& cameraForward, glm::vec2 depthRange,
+                              LightClusterData& data, LightsBlock& block) {
+        this->view = view;
+        this->projection = projection;
+        this->cameraCenter = cameraCenter;
+        this->cameraForward = cameraForward;
+        depthRange.x = std::max(depthRange.x, 1e-4f);
+        depthRange.y = std::max(depthRange.y, depthRange.x * 1.001f);
+        this->depthRange = depthRange;
+        float logRange = std::log(depthRange.y / depthRange.x);
+        sliceScale = glm::vec2(CLUSTER_GRID_Z / logRange, -std::log(depthRange.x) * CLUSTER_GRID_Z / logRange);
+
+        data.lightTexels.clear();
+        lightCells.clear();
+        block.clusteredAmbient = glm::vec3(0.0f);
+        for (auto& proxy : scene.getSpotLights()){
+            auto light = proxy.light;
+            block.clusteredAmbient += light->ambientColor;
+            addLight(data, light->worldPosition, light->intensity, light->diffuseColor, light->specularColor, light->attenuation,
+                     glm::vec3(0.0f), -1, glm::vec2(0.0f));
+        }
+        for (auto& proxy : scene.getConeLights()){
+            auto light = proxy.light;
+            block.clusteredAmbient += light->ambientColor;
+            addLight(data, light->worldPosition, light->intensity, light->diffuseColor, light->specularColor, light->attenuation,
+                     light->worldDirection, light->smoothing, light->range);
+        }
+
+        // The index list is built by a counting sort: the lights of every cell are counted, the counts give the offsets of the cells,
+        // then the lights are written at the offsets
+        auto forEachCell = [](const CellRange& cells, auto&& function){
+            for (int z = cells.min.z; z <= cells.max.z; z++)
+                for (int y = cells.min.y; y <= cells.max.y; y++)
+                    for (int x = cells.min.x; x <= cells.max.x; x++)
+                        function(x + CLUSTER_GRID_X * (y + CLUSTER_GRID_Y * z));
+        };
+        auto& grid = data.grid;
+        auto& indices = data.indices;
+        grid.assign(CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z, glm::uvec2(0));
+        for (const auto& cells : lightCells){
+            forEachCell(cells, [&grid](int cell){ grid[cell].y++; });
+        }
+        uint32_t offset = 0;
+        for (auto& cell : grid){
+            cell.x = offset;
+            offset += cell.y;
+            cell.y = 0;
+        }
+        indices.resize(offset);
+        for (size_t light = 0; light < lightCells.size(); light++){
+            forEachCell(lightCells[light], [&grid, &indices, light](int cell){
+                auto& range = grid[cell];
+                indices[range.x + range.y++] = (uint16_t) light;
+            });
+        }
+
+        block.clusteredLightCount = (GLint) lightCells.size();
+        block.cameraForward = cameraForward;
+        block.clusterScale = glm::vec4((float) CLUSTER_GRID_X / (float) viewportSize.x, (float) CLUSTER_GRID_Y / (float) viewportSize.y, sliceScale);
+        block.clusterCount = glm::ivec4(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, 0);
+    }
+
+    void LightClusters::upload(const LightClusterData& data) {
+        lightBuffer->setData(data.lightTexels.data(), data.lightTexels.size() * sizeof(glm::vec4));
+        gridBuffer->setData(data.grid.data(), data.grid.size() * sizeof(glm::uvec2));
+        indexBuffer->setData(data.indices.data(), data.indices.size() * sizeof(uint16_t));
+    }
+
+    void LightClusters::bind() const {
+        lightBuffer->bind(CLUSTER_LIGHTS_TEXTURE_UNIT);
+        gridBuffer->bind(CLUSTER_GRID_TEXTURE_UNIT);
+        indexBuffer->bind(CLUSTER_INDICES_TEXTURE_UNIT);
+    }
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "render-scene.hpp"
+#include "../shader/uniform-blocks.hpp"
+#include "../texture/texture-buffer.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace our {
+
+    // Lights whose contribution is below this value can't change an 8-bit channel, so their influence ends where it is reached
+    constexpr float LIGHT_INFLUENCE_CUTOFF = 1.0f / 256.0f;
+
+    // The number of RGBA32F texels of a light in the light texture buffer (it must match CLUSTERED_LIGHT_TEXELS in "default.frag").
+    //  0: position, intensity
+    //  1: diffuse color, smoothing (-1 for a spot light, which has no cone)
+    //  2: specular color, the outer limit of the cone (range.y)
+    //  3: attenuation, unused
+    //  4: direction, the inner limit of the cone (range.x)
+    constexpr int CLUSTERED_LIGHT_TEXELS = 5;
+
+    // The clusters of a frame as they are uploaded to the texture buffers.
+    // They are built on the CPU (possibly on another thread) and kept in the frame packet till the frame is submitted
+    struct LightClusterData {
+        std::vector<glm::vec4> lightTexels;
+        std::vector<glm::uvec2> grid;       // The offset and the count of every cell in "indices"
+        std::vector<uint16_t> indices;      // The lights of every cell, one cell after the other
+
+        // The number of lights that can reach a visible fragment and the size of the index list
+        size_t getLightCount() const { return lightTexels.size() / CLUSTERED_LIGHT_TEXELS; }
+        size_t getIndexCount() const { return indices.size(); }
+    };
+
+    // The light clusters pick the spot and cone lights that can reach each part of the view (clustered forward shading).
+    // Every frame, the influence volume of each light (a sphere whose radius is where its attenuation drops it below LIGHT_INFLUENCE_CUTOFF)
+    // is binned into a grid of froxels: CLUSTER_GRID_X * CLUSTER_GRID_Y screen tiles times CLUSTER_GRID_Z slices of the view depth.
+    // The slices are exponential between the nearest and the farthest visible objects, so they are thin close to the camera.
+    // The light data, the range of every cell in the index list and the index list itself are uploaded to texture buffers,
+    // and "default.frag" only evaluates the lights of the cell it falls in, so its cost follows the lights around it instead of all the lights.
+    // The ambient color of a spot or cone light is added everywhere (regardless of the distance), so it is summed here once.
+    // Building only touches the CPU side of the object and uploading only the texture buffers, so a frame can be built
+    // while the previous one is uploaded on the thread that owns the OpenGL context.
+    class LightClusters {
+        // The cells covered by a light
+        struct CellRange {
+            glm::ivec3 min, max;
+        };
+        std::vector<CellRange> lightCells;
+
+        TextureBuffer* lightBuffer = nullptr;  // GL_RGBA32F, CLUSTERED_LIGHT_TEXELS per light
+        TextureBuffer* gridBuffer = nullptr;   // GL_RG32UI, one texel per cell
+        TextureBuffer* indexBuffer = nullptr;  // GL_R16UI, one texel per light of every cell
+
+        // Adds a light to the light texels of "data" and to "lightCells" if it can reach a visible fragment
+        void addLight(LightClusterData& data, const glm::vec3& position, float intensity, const glm::vec3& diffuseColor, const glm::vec3& specularColor,
+                      const glm::vec3& attenuation, const glm::vec3& direction, int smoothing, const glm::vec2& range);
+
+        // The view of the frame being built
+        glm::mat4 view, projection;
+        glm::vec3 cameraCenter, cameraForward;
+        glm::vec2 depthRange;
+        glm::vec2 sliceScale; // Maps the log of the view depth to a slice (scale, bias)
+
+    public:
+        // Returns the distance at which the light drops below LIGHT_INFLUENCE_CUTOFF (infinity if it never does, 0 if it is always below)
+        static float getInfluenceRadius(float intensity, const glm::vec3& diffuseColor, const glm::vec3& specularColor, const glm::vec3& attenuation);
+
+        // Creates the texture buffers
+        void create();
+        // Deletes the texture buffers
+        void destroy();
+
+        // Bins the spot and cone lights of the scene into the clusters of the given view, writes them to "data" and fills the cluster fields of "block".
+        // "depthRange" is the range of the view depth that has visible objects (the slices only cover it). It makes no OpenGL calls
+        void build(const RenderScene& scene, const glm::mat4& view, const glm::mat4& projection, glm::ivec2 viewportSize,
+                   const glm::vec3& cameraCenter, const glm::vec3& cameraForward, glm::vec2 depthRange,
+                   LightClusterData& data, LightsBlock& block);
+        // Uploads the given clusters to the texture buffers
+        void upload(const LightClusterData& data);
+        // Binds the texture buffers to their texture units (see TEXTURE_BUFFER_BINDINGS)
+        void bind() const;
+
+        LightClusters() = default;
+        ~LightClusters() { destroy(); }
+
+        LightClusters(const LightClusters&) = delete;
+        LightClusters& operator=(const LightClusters&) = delete;
+    };
+
+}
@@ -14,6 +14,8 @@
 namespace our{
     class OrbitalCameraControllerSystem{
         Application* app;
+        // whether the keys that switch the camera are held this frame, read on the main thread by setInput since update may run on a worker
+        bool previousPressed = false, nextPressed = false;
 
 
         [[nodiscard]] static inline float slow_in_slow_out(float a) {
@@ -25,15 +27,17 @@ namespace our{
             app = a;
         }
 
-        void update(World* world, float deltaTime) {
-            CameraComponent* camera = nullptr;
-            OrbitalCameraComponent *controller = nullptr;
-            for(auto entity : world->getEntities()){
-                camera = entity->getComponent<CameraComponent>();
-                controller = entity->getComponent<OrbitalCameraComponent>();
-                if (camera && controller) break;
-            }
+        void setInput(bool previous, bool next){
+            previousPressed = previous;
+            nextPressed = next;
+        }
 
+        void update(World* world, float deltaTime) {
+            // The cached view holds every entity that has both a CameraComponent and an OrbitalCameraComponent
+            Entity* entity = world->view<CameraComponent, OrbitalCameraComponent>().front();
+            if (!entity) return;
+            CameraComponent* camera = entity->getComponent<CameraComponent>();
+            OrbitalCameraComponent *controller = entity->getComponent<OrbitalCameraComponent>();
 
             if(!(camera && controller)) return;
 
@@ -47,11 +51,12 @@ namespace our{
             //calculate where our center point should be
             glm::vec3 shouldFocus = controller->BasePosition;
             std::vector<Entity*> targets;
-            auto followVec = controller->follow;
+            const auto& followVec = controller->follow;
 
             float div = 0;
-            for(auto entity : world->getEntities()){
-                if (std::count(followVec.begin() , followVec.end() , entity->name)){
+            for(auto it = followVec.begin(); it != followVec.end(); it++){
+                if (std::find(followVec.begin() , it , *it) != it) continue; // every followed entity is counted once
+                for(auto entity : world->getEntitiesByName(*it)){
                     div++;
                     shouldFocus += entity->getWorldPosition();
                 }
@@ -77,20 +82,20 @@ namespace our{
             }else{
 
                 if (controller->inputEnabled && controller->switches > 0) {
-                    if (app->getKeyboard().isPressed(GLFW_KEY_Q)) {
+                    if (previousPressed) {
                         controller->_currentPos--;
                         controller->_switchDirection = -1;
                         controller->_switchProgress = 1;
                         controller->switches--;
-                        Events::onPaimonCameraChange(controller->getOwner()->name);
+                        Events::onPaimonCameraChange(controller->getOwner()->getNameId());
                     }
 
-                    if (app->getKeyboard().isPressed(GLFW_KEY_E)) {
+                    if (nextPressed) {
                         controller->_currentPos++;
                         controller->_switchDirection = 1;
                         controller->_switchProgress = 1;
                         controller->switches--;
-                        Events::onPaimonCameraChange(controller->getOwner()->name);
+                        Events::onPaimonCameraChange(controller->getOwner()->getNameId());
                     }
                 }
             }
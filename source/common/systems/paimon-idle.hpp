@@ -19,13 +19,9 @@ namespace our
             // First of all, we search for an entity containing both a CameraComponent and a FreeCameraControllerComponent
             // As soon as we find one, we break
 
-            PaimonIdle* paimon = nullptr;
             time += deltaTime;
 
-            for(auto entity : world->getEntities()){
-                paimon = entity->getComponent<PaimonIdle>();
-                if(paimon) break;
-            }
+            PaimonIdle* paimon = world->getSingleton<PaimonIdle>();
 
             if (paimon == nullptr) return;
 
@@ -7,31 +7,32 @@
 #include "components/mesh-renderer.hpp"
 #include "ground-system.hpp"
 
+// The name of the block that paimon has to reach to win the level
+static const our::NameId winningBlockName = our::internName("the_winning_block");
+
 void our::PaimonMovement::update(World *world, LevelMapping *level, float deltaTime, bool& won) {
     //first we get paimon
-    for (auto k : world->getEntities()){
-        if (paimon == nullptr) paimon = k->getComponent<Paimon>();
-        if (camera == nullptr) camera = k->getComponent<CameraComponent>();
-        if (orbitalCameraComponent == nullptr) orbitalCameraComponent = k->getComponent<OrbitalCameraComponent>();
-    }
+    if (paimon == nullptr) paimon = world->getSingleton<Paimon>();
+    if (camera == nullptr) camera = world->getSingleton<CameraComponent>();
+    if (orbitalCameraComponent == nullptr) orbitalCameraComponent = world->getSingleton<OrbitalCameraComponent>();
 
 
     if (!camera || !paimon || !orbitalCameraComponent) return;
 
-    auto target = level->ScreenToGroundCast(app->getMouse().getMousePosition().x , app->getMouse().getMousePosition().y);
+    auto target = level->ScreenToGroundCast(mousePosition.x , mousePosition.y);
     if (target != nullptr){ //highlight it
-        auto mat = ((DefaultMaterial*) target->getOwner()->getComponent<MeshRendererComponent>()->material);
-        if (mat != lastTargetMaterial){
-            if (lastTargetMaterial != nullptr)
-                lastTargetMaterial->tint /= 2.0f;
-            lastTargetMaterial = mat;
-            lastTargetMaterial->tint *= 2.0f;
+        auto renderer = target->getOwner()->getComponent<MeshRendererComponent>();
+        if (renderer != lastTarget.get()){
+            if (auto last = lastTarget.get())
+                ((DefaultMaterial*) last->material)->tint /= 2.0f;
+            lastTarget = renderer;
+            ((DefaultMaterial*) renderer->material)->tint *= 2.0f;
         }
     }else{
-        if (lastTargetMaterial != nullptr){
-            lastTargetMaterial->tint /= 2.0f;
-            lastTargetMaterial = nullptr;
+        if (auto last = lastTarget.get()){
+            ((DefaultMaterial*) last->material)->tint /= 2.0f;
         }
+        lastTarget = nullptr;
     }
 
     auto camInverse = glm::inverse(camera->getViewMatrix());
@@ -54,7 +55,7 @@ void our::PaimonMovement::update(World *world, LevelMapping *level, float deltaT
         if (paimon->ground){
             Events::onPaimonEnter(paimon->ground);
             Events::onPaimonEnterWorld();
-            if (paimon->ground->getOwner()->name == "the_winning_block"){
+            if (paimon->ground->getOwner()->getNameId() == winningBlockName){
                 won = true;
             }
         }
@@ -118,7 +119,7 @@ void our::PaimonMovement::update(World *world, LevelMapping *level, float deltaT
                 our::Events::onPaimonExit(paimon->ground);
                 paimon->ground = nextBlock;
                 our::Events::onPaimonEnter(paimon->ground);
-                if (paimon->ground->getOwner()->name == "the_winning_block"){
+                if (paimon->ground->getOwner()->getNameId() == winningBlockName){
                     won = true;
                 }
             }
@@ -138,7 +139,7 @@ void our::PaimonMovement::update(World *world, LevelMapping *level, float deltaT
     }
 
     orbitalCameraComponent->inputEnabled = true;
-    if (app->getMouse().isPressed(0) && target != nullptr) { //left click
+    if (mousePressed && target != nullptr) { //left click
         auto route = level->findRoute(paimon->ground, target);
         if (route.size() > 1){
             currentTarget = target;
@@ -189,13 +190,18 @@ void our::PaimonMovement::init(our::Application *a) {
     this->camera = nullptr;
     this->currentTarget = nullptr;
     this->nextBlock = nullptr;
-    this->lastTargetMaterial = nullptr;
+    this->lastTarget = nullptr;
     this->orbitalCameraComponent = nullptr;
     this->returnToBlockCenter = false;
     app = a;
     our::GroundSystem::setPaimonController(this);
 }
 
+void our::PaimonMovement::setInput(const glm::vec2& position, bool pressed) {
+    mousePosition = position;
+    mousePressed = pressed;
+}
+
 void our::PaimonMovement::onGroundMoved(our::Ground *g, glm::vec3 delta) {
     if (paimon == nullptr) return;
     if (nextBlock == g){
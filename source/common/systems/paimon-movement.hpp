@@ -8,6 +8,8 @@
 #include "Level-mapping.hpp"
 #include "material/material.hpp"
 #include "components/OrbitalCameraComponent.h"
+#include "components/mesh-renderer.hpp"
+#include "ecs/component-ref.hpp"
 
 #define BLOCK_REACH_MAX_DIFF 0.1
 
@@ -15,20 +17,24 @@ namespace our {
     class PaimonMovement {
     private:
         Application* app{};
-        DefaultMaterial* lastTargetMaterial = nullptr;
-        Ground* currentTarget;
-        Ground* nextBlock;
+        ComponentRef<MeshRendererComponent> lastTarget; // The renderer of the highlighted block
+        ComponentRef<Ground> currentTarget;
+        ComponentRef<Ground> nextBlock;
         glm::vec3 nextBlockPosition;
         bool returnToBlockCenter = false;
         Paimon* paimon = nullptr;
         CameraComponent* camera = nullptr;
         OrbitalCameraComponent* orbitalCameraComponent = nullptr;
+        // the mouse this frame, read on the main thread by setInput since update may run on a worker
+        glm::vec2 mousePosition{};
+        bool mousePressed = false;
 
 
         static inline void update_angle(Paimon* paimon, CameraComponent* camera, glm::vec3 diff , float deltaTime);
 
     public:
         void init(Application* a);
+        void setInput(const glm::vec2& position, bool pressed);
         void update(World *world, LevelMapping* level, float deltaTime , bool& won);
         void onGroundMoved(Ground* g, glm::vec3 delta);
     };
@@ -0,0 +1,289 @@
+#include "postprocess-plan.hpp"
+#include "../deserialize-utils.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <regex>
+
+namespace our {
+
+    void PostprocessParam::apply(const ShaderProgram* shader) const {
+        switch (type) {
+            case Type::Int: shader->set(location, (GLint) intValue); break;
+            case Type::Float: shader->set(location, value.x); break;
+            case Type::Vec2: shader->set(location, glm::vec2(value)); break;
+            case Type::Vec3: shader->set(location, glm::vec3(value)); break;
+            case Type::Vec4: shader->set(location, value); break;
+        }
+    }
+
+    Framebuffer* PostprocessPlan::createFramebuffer(int colorCount, glm::ivec2 framebufferSize) {
+        auto framebuffer = new Framebuffer(framebufferSize);
+        bool bound = framebuffer->bind();
+        for (int i = 0; i < colorCount; i++)
+            framebuffer->addColorTexture(GL_RGBA8);
+        // The draw buffers are stored in the framebuffer object, so they never have to be set again
+        std::vector<GLenum> drawBuffers(colorCount);
+        for (int i = 0; i < colorCount; i++)
+            drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+        glDrawBuffers((GLsizei) drawBuffers.size(), drawBuffers.data());
+        if (bound) framebuffer->unbind();
+        framebuffers.push_back(framebuffer);
+        return framebuffer;
+    }
+
+    std::string PostprocessPlan::readFusableBlock(const std::string& file) {
+        std::ifstream stream(file);
+        if (!stream) return std::string();
+        std::string source((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        static const std::string beginMarker = "//#fusable begin";
+        static const std::string endMarker = "//#fusable end";
+        size_t begin = source.find(beginMarker);
+        if (begin == std::string::npos) return std::string();
+        begin += beginMarker.size();
+        size_t end = source.find(endMarker, begin);
+        if (end == std::string::npos) return std::string();
+        return source.substr(begin, end - begin);
+    }
+
+    ShaderProgram* PostprocessPlan::createProgram(const std::string& fragmentFile, const std::string& fragmentSource) {
+        auto shader = new ShaderProgram();
+        bool attached = shader->attach("assets/shaders/fullscreen.vert", GL_VERTEX_SHADER);
+        if (fragmentSource.empty()) attached = shader->attach(fragmentFile, GL_FRAGMENT_SHADER) && attached;
+        else attached = shader->attachSource(fragmentSource, GL_FRAGMENT_SHADER) && attached;
+        if (!attached || !shader->link()){
+            std::cerr << "ERROR: Couldn't build the post-process shader: " << fragmentFile << std::endl;
+        }
+        programs.push_back(shader);
+        return shader;
+    }
+
+    std::string PostprocessPlan::generateFusedShader(const std::vector<std::string>& blocks) {
+        // Each block defines "effect" which reads its input through "source", so block k becomes "effect_k" reading "effect_{k-1}"
+        // and "effect_0" reads the input texture
+        static const std::regex effectName("\\beffect\\b");
+        static const std::regex sourceName("\\bsource\\b");
+        std::string code =
+                "#version 330\n"
+                "uniform sampler2D tex_0;\n"
+                "in vec2 tex_coord;\n"
+                "out vec4 frag_color;\n"
+                "vec4 effect_0(vec2 uv){\n"
+                "    return texture(tex_0, uv);\n"
+                "}\n";
+        for (size_t k = 1; k <= blocks.size(); k++){
+            std::string block = std::regex_replace(blocks[k - 1], effectName, "effect_" + std::to_string(k));
+            code += std::regex_replace(block, sourceName, "effect_" + std::to_string(k - 1));
+        }
+        code += "void main(){\n"
+                "    frag_color = effect_" + std::to_string(blocks.size()) + "(tex_coord);\n"
+                "}\n";
+        return code;
+    }
+
+    void PostprocessPlan::setupUniforms(PostprocessPass& pass, const nlohmann::json& params) {
+        const ShaderProgram* shader = pass.shader;
+        shader->use();
+        // Texture i is always bound to the unit i, the single input effects name it "tex"
+        shader->set(shader->getUniformLocation("tex"), (GLint) 0);
+        for (size_t i = 0; i < pass.textures.size(); i++){
+            shader->set(shader->getUniformLocation("tex_" + std::to_string(i)), (GLint) i);
+        }
+
+        for (auto& [name, desc] : params.items()){
+            PostprocessParam param;
+            param.location = shader->getCheckedUniformLocation(name);
+            if (desc.is_boolean()){
+                param.type = PostprocessParam::Type::Int;
+                param.intValue = desc.get<bool>() ? 1 : 0;
+            } else if (desc.is_number_integer()){
+                param.type = PostprocessParam::Type::Int;
+                param.intValue = desc.get<int>();
+            } else if (desc.is_number()){
+                param.type = PostprocessParam::Type::Float;
+                param.value.x = desc.get<float>();
+            } else if (desc.is_array() && desc.size() >= 1 && desc.size() <= 4){
+                static const PostprocessParam::Type vectorTypes[] = {
+                        PostprocessParam::Type::Float, PostprocessParam::Type::Vec2,
+                        PostprocessParam::Type::Vec3, PostprocessParam::Type::Vec4
+                };
+                param.type = vectorTypes[desc.size() - 1];
+                for (size_t i = 0; i < desc.size(); i++) param.value[(int) i] = desc[i].get<float>();
+            } else {
+                std::cerr << "Unsupported value of the post-process param '" << name << "'" << std::endl;
+                continue;
+            }
+            if (param.location == -1) continue;
+            param.apply(shader);
+            pass.params.push_back(param);
+        }
+    }
+
+    GLuint PostprocessPlan::compileBloom(const nlohmann::json& config, GLuint brightTexture) {
+        float scale = config.value("scale", 0.5f);
+        int iterations = std::max(config.value("iterations", 4), 1);
+        glm::ivec2 firstSize = glm::max(glm::ivec2(glm::vec2(size) * scale), glm::ivec2(1));
+
+        // Each level of the chain has its own framebuffer (half the size of the previous one)
+        auto levelSize = [&](int i){ return glm::max(firstSize >> i, glm::ivec2(1)); };
+        std::vector<Framebuffer*> levels;
+        for (int i = 0; i < iterations; i++){
+            levels.push_back(createFramebuffer(1, levelSize(i)));
+        }
+
+        // The downsample passes go down the chain then the upsample passes overwrite each level with the blurred level below it
+        ShaderProgram* downsample = createProgram("assets/shaders/postprocess/bloom-downsample.frag");
+        ShaderProgram* upsample = createProgram("assets/shaders/postprocess/bloom-upsample.frag");
+        GLuint input = brightTexture;
+        for (int i = 0; i < iterations; i++){
+            PostprocessPass pass;
+            pass.shader = downsample;
+            pass.target = levels[i];
+            pass.viewport = levelSize(i);
+            pass.textures = {input};
+            pass.effects = {"assets/shaders/postprocess/bloom-downsample.frag"};
+            passes.push_back(pass);
+            input = levels[i]->getColorTexture(0)->getOpenGLName();
+        }
+        for (int i = iterations - 1; i > 0; i--){
+            PostprocessPass pass;
+            pass.shader = upsample;
+            pass.target = levels[i - 1];
+            pass.viewport = levelSize(i - 1);
+            pass.textures = {levels[i]->getColorTexture(0)->getOpenGLName()};
+            pass.effects = {"assets/shaders/postprocess/bloom-upsample.frag"};
+            passes.push_back(pass);
+        }
+        // Both programs only read "tex_0" from the unit 0
+        for (auto program : {downsample, upsample}){
+            program->use();
+            program->set(program->getUniformLocation("tex_0"), (GLint) 0);
+        }
+        return levels[0]->getColorTexture(0)->getOpenGLName();
+    }
+
+    void PostprocessPlan::compile(glm::ivec2 size, const nlohmann::json& config) {
+        destroy();
+        this->size = size;
+        bool bloom = config.contains("bloom");
+        // The bloom reads the bright color from the second attachment of the scene
+        int channels = config.value("channels", bloom ? 2 : 1);
+        if (bloom) channels = std::max(channels, 2);
+
+        // The scene is drawn to the first framebuffer, so it is the only one that needs a depth attachment
+        Framebuffer* scene = createFramebuffer(channels, size);
+        scene->addDepthTexture(GL_DEPTH_COMPONENT24);
+        Framebuffer* other = createFramebuffer(channels, size);
+
+        glGenVertexArrays(1, &vertexArray);
+
+        sampler = new Sampler();
+        sampler->set(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        sampler->set(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        sampler->set(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        sampler->set(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        pipelineState.depthMask = false;
+
+        // Group the effects into passes, a run of fusable effects becomes one pass
+        struct PlannedPass {
+            std::vector<std::string> files;
+            std::vector<std::string> blocks; // The fusable blocks of the files (only filled for a run of 2 or more)
+            nlohmann::json params;
+            bool bloomComposite = false;     // The pass reads the bloom chain as its second texture
+        };
+        std::vector<PlannedPass> planned;
+        GLuint bloomTexture = 0;
+        if (bloom){
+            const auto& bloomConfig = config["bloom"];
+            bloomTexture = compileBloom(bloomConfig, scene->getColorTexture(1)->getOpenGLName());
+            nlohmann::json params = {{"intensity", bloomConfig.value("intensity", 1.0f)}};
+            planned.push_back({{"assets/shaders/postprocess/bloom.frag"}, {}, params, true});
+        }
+        bool lastFusable = false;
+        for (const auto& effect : config.value("effects", nlohmann::json::array())){
+            std::string file = effect.value<std::string>("target", "");
+            nlohmann::json params = effect.value("params", nlohmann::json::object());
+            std::string block = params.empty() ? readFusableBlock(file) : std::string();
+            bool fusable = !block.empty();
+            if (fusable && lastFusable){
+                auto& run = planned.back();
+                if (run.blocks.empty()) run.blocks.push_back(readFusableBlock(run.files.front()));
+                run.files.push_back(file);
+                run.blocks.push_back(block);
+            } else {
+                planned.push_back({{file}, {}, params});
+            }
+            lastFusable = fusable;
+        }
+
+        // The passes alternate between the two framebuffers, the last one draws to the screen
+        Framebuffer* from = scene;
+        Framebuffer* next = other;
+        for (size_t i = 0; i < planned.size(); i++){
+            auto& plannedPass = planned[i];
+            PostprocessPass pass;
+            pass.effects = plannedPass.files;
+            pass.target = i + 1 < planned.size() ? next : nullptr;
+            pass.viewport = size;
+            for (int j = 0; j < from->getColorTexturesCount(); j++){
+                pass.textures.push_back(from->getColorTexture(j)->getOpenGLName());
+            }
+            if (plannedPass.bloomComposite) pass.textures[1] = bloomTexture;
+            if (plannedPass.blocks.empty()){
+                pass.shader = createProgram(plannedPass.files.front());
+            } else {
+                pass.shader = createProgram("fused effects", generateFusedShader(plannedPass.blocks));
+            }
+            setupUniforms(pass, plannedPass.params);
+            passes.push_back(pass);
+            std::swap(from, next);
+
+            std::cout << "Generated Postprocess Shader:";
+            for (auto& file : pass.effects) std::cout << " " << file;
+            std::cout << std::endl;
+        }
+    }
+
+    void PostprocessPlan::execute() const {
+        framebuffers[0]->unbind();
+
+        auto& cache = GLStateCache::getInstance();
+        pipelineState.setup();
+        cache.bindVertexArray(vertexArray);
+        glm::ivec2 viewport = size;
+        for (const auto& pass : passes){
+            // The levels of the bloom chain are smaller than the window
+            if (pass.viewport != viewport){
+                viewport = pass.viewport;
+                glViewport(0, 0, viewport.x, viewport.y);
+            }
+            bool bound = pass.target != nullptr && pass.target->bind();
+            pass.shader->use();
+            for (size_t i = 0; i < pass.textures.size(); i++){
+                cache.activeTexture((GLuint) i);
+                cache.bindTexture(pass.textures[i]);
+                sampler->bind((GLuint) i);
+            }
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            if (bound) pass.target->unbind();
+        }
+        if (viewport != size) glViewport(0, 0, size.x, size.y);
+    }
+
+    void PostprocessPlan::destroy() {
+        passes.clear();
+        for (auto program : programs) delete program;
+        programs.clear();
+        for (auto framebuffer : framebuffers) delete framebuffer;
+        framebuffers.clear();
+        delete sampler;
+        sampler = nullptr;
+        if (vertexArray != 0){
+            GLStateCache::getInstance().forgetVertexArray(vertexArray);
+            glDeleteVertexArrays(1, &vertexArray);
+            vertexArray = 0;
+        }
+    }
+
+}
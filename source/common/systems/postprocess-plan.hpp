@@ -0,0 +1,93 @@
+#pragma once
+
+#include "../shader/shader.hpp"
+#include "../texture/framebuffer.h"
+#include "../texture/sampler.hpp"
+#include "../material/pipeline-state.hpp"
+
+#include <glad/gl.h>
+#include <json/json.hpp>
+#include <string>
+#include <vector>
+
+namespace our {
+
+    // A parameter of a post-process effect, read from the "params" of the effect in the config.
+    // The type is decided once from the json value, so setting it is a single glUniform call on a resolved location.
+    struct PostprocessParam {
+        enum class Type { Int, Float, Vec2, Vec3, Vec4 };
+        GLint location = -1;
+        Type type = Type::Float;
+        int intValue = 0;    // For Int (booleans are sent as 0 or 1)
+        glm::vec4 value = {}; // For Float and the vectors (the unused components are ignored)
+
+        // Sends the value to the given program (which must be in use)
+        void apply(const ShaderProgram* shader) const;
+    };
+
+    // A fullscreen pass of the plan: it reads the textures and writes to "target" (or to the screen if it is null)
+    struct PostprocessPass {
+        ShaderProgram* shader = nullptr;     // Owned by the plan (the passes of the bloom chain share their programs)
+        Framebuffer* target = nullptr;
+        glm::ivec2 viewport;                 // The size of "target" (or of the window)
+        std::vector<GLuint> textures;        // Texture i is bound to unit i (usually the color attachments of the previous target)
+        std::vector<PostprocessParam> params;
+        std::vector<std::string> effects;    // The files of the effects run by this pass (more than one if they were fused)
+    };
+
+    // The post-process plan is the list of effects of the "postprocess" config compiled once at initialization.
+    // Compiling resolves everything that used to be done per effect per frame:
+    //  - The programs are owned by the plan, so their sampler uniforms ("tex", "tex_i") and the params are set once since a program keeps its uniform values.
+    //  - The draw buffers are a state of the framebuffer object, so each framebuffer is given its attachment list once when it is created.
+    //  - The textures each pass reads are stored as a flat list of OpenGL names.
+    // Consecutive effects that have no params and whose shaders mark their code with "//#fusable begin" & "//#fusable end"
+    // (e.g. grayscale, vignette and chromatic aberration) are fused in one generated fragment shader, so they cost one fullscreen pass.
+    //
+    // If the config has a "bloom" object, the bright color of the scene (its second attachment) is blurred by a dual filter chain:
+    // it is downsampled "iterations" times starting at "scale" times the window size then upsampled back to the first level,
+    // and "bloom.frag" adds it to the scene (multiplied by "intensity") before the effects run. Every level is half the size of the
+    // previous one and the filters use the bilinear sampling to read 4 texels per tap, so the whole chain costs less than one
+    // fullscreen pass while blurring a much wider area than the separable blur at the full resolution.
+    class PostprocessPlan {
+        glm::ivec2 size;
+        std::vector<Framebuffer*> framebuffers; // [0] is the framebuffer the scene is drawn to, [1] is the other one of the ping-pong
+        std::vector<ShaderProgram*> programs;
+        Sampler* sampler = nullptr;
+        GLuint vertexArray = 0;                 // An empty vertex array, the fullscreen triangle is generated by "fullscreen.vert"
+        PipelineState pipelineState;
+        std::vector<PostprocessPass> passes;
+
+        // Creates a framebuffer with the given number of color attachments (and sets its draw buffers to all of them)
+        Framebuffer* createFramebuffer(int colorCount, glm::ivec2 framebufferSize);
+        // Returns the code of the fusable block of the given shader file or an empty string if it has none
+        static std::string readFusableBlock(const std::string& file);
+        // Creates a program from the fullscreen vertex shader and the given fragment shader file (or generated code)
+        ShaderProgram* createProgram(const std::string& fragmentFile, const std::string& fragmentSource = std::string());
+        // Generates the fragment shader that runs the given fusable blocks one after the other
+        static std::string generateFusedShader(const std::vector<std::string>& blocks);
+        // Resolves the params of the effect and sets them with the sampler uniforms of the pass
+        static void setupUniforms(PostprocessPass& pass, const nlohmann::json& params);
+        // Adds the passes of the bloom chain that blur the given texture and returns the blurred texture
+        GLuint compileBloom(const nlohmann::json& config, GLuint brightTexture);
+
+    public:
+        // Compiles the given "postprocess" config for a window of the given size
+        void compile(glm::ivec2 size, const nlohmann::json& config);
+        // Deletes the framebuffers, programs and the other objects of the plan
+        void destroy();
+
+        // Binds the framebuffer the scene should be drawn to (it has to be unbound by "execute")
+        void beginScene() const { framebuffers[0]->bind(); }
+        // Unbinds the scene framebuffer and runs the passes, the last one draws to the framebuffer that was bound before "beginScene"
+        void execute() const;
+
+        const std::vector<PostprocessPass>& getPasses() const { return passes; }
+
+        PostprocessPlan() = default;
+        ~PostprocessPlan() { destroy(); }
+
+        PostprocessPlan(const PostprocessPlan&) = delete;
+        PostprocessPlan& operator=(const PostprocessPlan&) = delete;
+    };
+
+}
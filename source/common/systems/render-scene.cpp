@@ -0,0 +1,162 @@
+#include "render-scene.hpp"
+
+#include <algorithm>
+
+namespace our {
+
+    // Removes the element equal to "value" from the vector by moving the last element to its place
+    template<typename T, typename V>
+    static void swapRemove(std::vector<T>& elements, const V& value) {
+        auto it = std::find(elements.begin(), elements.end(), value);
+        if (it == elements.end()) return;
+        *it = elements.back();
+        elements.pop_back();
+    }
+
+    // Same as above but it looks for the light proxy of the given light
+    template<typename T>
+    static void swapRemoveProxy(std::vector<LightProxy<T>>& proxies, const T* light) {
+        auto it = std::find_if(proxies.begin(), proxies.end(), [light](const LightProxy<T>& proxy){ return proxy.light == light; });
+        if (it == proxies.end()) return;
+        *it = proxies.back();
+        proxies.pop_back();
+    }
+
+    void RenderScene::onComponentDestroyed(MeshRendererComponent* renderer) {
+        auto it = proxyIndices.find(renderer);
+        if (it == proxyIndices.end()){
+            // It was created and destroyed before the next sync
+            swapRemove(createdRenderers, renderer);
+            return;
+        }
+        // The last proxy (and its box) takes the place of the removed one
+        size_t index = it->second;
+        proxyIndices.erase(it);
+        if (index != proxies.size() - 1){
+            proxies[index] = proxies.back();
+            proxyIndices[proxies[index].renderer] = index;
+        }
+        proxies.pop_back();
+        culler.erase(index);
+    }
+
+    void RenderScene::onComponentDestroyed(DirectionalLight* light) {
+        swapRemove(createdDirectionalLights, light);
+        swapRemove(directionalLights, light);
+    }
+
+    void RenderScene::onComponentDestroyed(SpotLight* light) {
+        swapRemove(createdSpotLights, light);
+        swapRemoveProxy(spotLights, light);
+    }
+
+    void RenderScene::onComponentDestroyed(ConeLight* light) {
+        swapRemove(createdConeLights, light);
+        swapRemoveProxy(coneLights, light);
+    }
+
+    void RenderScene::attach(World* newWorld) {
+        if (world == newWorld) return;
+        detach();
+        world = newWorld;
+        if (world == nullptr) return;
+        world->addComponentListener<MeshRendererComponent>(this);
+        world->addComponentListener<DirectionalLight>(this);
+        world->addComponentListener<SpotLight>(this);
+        world->addComponentListener<ConeLight>(this);
+
+        // The components that already exist are added as if they were just created
+        for (auto renderer : world->getAllComponents<MeshRendererComponent>()) createdRenderers.push_back(renderer);
+        for (auto light : world->getAllComponents<DirectionalLight>()) createdDirectionalLights.push_back(light);
+        for (auto light : world->getAllComponents<SpotLight>()) createdSpotLights.push_back(light);
+        for (auto light : world->getAllComponents<ConeLight>()) createdConeLights.push_back(light);
+    }
+
+    void RenderScene::detach() {
+        if (world != nullptr){
+            world->removeComponentListener<MeshRendererComponent>(this);
+            world->removeComponentListener<DirectionalLight>(this);
+            world->removeComponentListener<SpotLight>(this);
+            world->removeComponentListener<ConeLight>(this);
+            world = nullptr;
+        }
+        proxies.clear();
+        proxyIndices.clear();
+        culler.clear();
+        changedProxies.clear();
+        directionalLights.clear();
+        spotLights.clear();
+        coneLights.clear();
+        createdRenderers.clear();
+        createdDirectionalLights.clear();
+        createdSpotLights.clear();
+        createdConeLights.clear();
+    }
+
+    void RenderScene::addCreatedComponents() {
+        for (auto renderer : createdRenderers){
+            proxyIndices[renderer] = proxies.size();
+            RenderProxy proxy;
+            proxy.renderer = renderer;
+            proxy.command.mesh = nullptr;
+            proxy.command.material = nullptr;
+            proxies.push_back(proxy);
+            culler.push(AABB());
+        }
+        createdRenderers.clear();
+
+        directionalLights.insert(directionalLights.end(), createdDirectionalLights.begin(), createdDirectionalLights.end());
+        createdDirectionalLights.clear();
+        for (auto light : createdSpotLights) spotLights.push_back({light});
+        createdSpotLights.clear();
+        for (auto light : createdConeLights) coneLights.push_back({light});
+        createdConeLights.clear();
+    }
+
+    void RenderScene::sync() {
+        addCreatedComponents();
+        changedProxies.clear();
+
+        for (size_t i = 0; i < proxies.size(); i++){
+            auto& proxy = proxies[i];
+            auto renderer = proxy.renderer;
+            auto& command = proxy.command;
+            bool meshChanged = command.mesh != renderer->mesh || command.shapeID != renderer->shapeID;
+            if (meshChanged || command.material != renderer->material){
+                command.mesh = renderer->mesh;
+                command.shapeID = renderer->shapeID;
+                command.material = renderer->material;
+                changedProxies.push_back(i);
+            }
+
+            const Entity* owner = renderer->getOwner();
+            if (owner->getTransformVersion() != 0 && owner->getTransformVersion() == proxy.transformVersion && !meshChanged) continue;
+            // The matrix is only read (and validated if needed) for the proxies whose owner moved
+            command.localToWorld = owner->getLocalToWorldMatrix();
+            // The normals are transformed by the inverse transpose, which is computed here once instead of for every vertex
+            command.normalMatrix = glm::transpose(glm::inverse(glm::mat3(command.localToWorld)));
+            command.center = glm::vec3(command.localToWorld[3]);
+            proxy.transformVersion = owner->getTransformVersion();
+            if (command.mesh != nullptr){
+                culler.set(i, command.mesh->getBounds(command.shapeID).box.transformed(command.localToWorld));
+            }
+        }
+
+        for (auto& proxy : spotLights){
+            const Entity* owner = proxy.light->getOwner();
+            if (owner->getTransformVersion() != 0 && owner->getTransformVersion() == proxy.transformVersion) continue;
+            proxy.light->worldPosition = owner->getWorldPosition();
+            proxy.transformVersion = owner->getTransformVersion();
+        }
+
+        for (auto& proxy : coneLights){
+            const Entity* owner = proxy.light->getOwner();
+            if (owner->getTransformVersion() != 0 && owner->getTransformVersion() == proxy.transformVersion) continue;
+            const glm::mat4& localToWorld = owner->getLocalToWorldMatrix();
+            proxy.light->worldPosition = glm::vec3(localToWorld * glm::vec4(0, 0, 0, 1));
+            proxy.light->worldDirection = glm::vec3(localToWorld * glm::vec4(proxy.light->direction, 0.0));
+            proxy.transformVersion = owner->getTransformVersion();
+        }
+    }
+
+}
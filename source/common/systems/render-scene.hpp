@@ -0,0 +1,119 @@
+#pragma once
+
+#include "../ecs/world.hpp"
+#include "../components/mesh-renderer.hpp"
+#include "../components/DirectionalLight.hpp"
+#include "components/SpotLight.h"
+#include "components/ConeLight.h"
+#include "frustum-culler.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+namespace our {
+
+    // The render command stores command that tells the renderer that it should draw
+    // the given mesh at the given localToWorld matrix using the given material
+    // The renderer will fill this struct using the mesh renderer components
+    struct RenderCommand {
+        glm::mat4 localToWorld;
+        glm::mat3 normalMatrix;   // The inverse transpose of the upper 3x3 of localToWorld (computed only when the matrix changes)
+        glm::vec3 center;
+        Mesh* mesh;
+        int shapeID;
+        Material* material;
+        uint32_t pipelineStateId; // Commands whose materials have equal pipeline states share the same id (see "getPipelineStateId")
+        uint32_t instanceGroup;   // Consecutive commands with the same mesh and instance group are drawn as one instanced draw (see "getInstanceGroup")
+        bool staticBatch = false; // The mesh is a static batch which is already in the world space and has a tint per vertex
+        bool depthPrepass = false; // The command can be drawn in the depth pre-pass (see "ForwardRenderer::canDepthPrepass")
+        bool instanced = false;    // The command is drawn by the instanced vertex shader in every pass of the frame (see "ForwardRenderer::markInstancedRuns")
+        uint32_t objectIndex = 0;  // The index of the command's data in the object texture buffer of the frame (see "ForwardRenderer::uploadObjectData")
+        glm::vec4 tint = glm::vec4(1.0f); // The tint of the material when the frame was prepared (the systems may change it while the frame is submitted)
+    };
+
+    // The instance group of the commands whose materials can't be instanced
+    constexpr uint32_t NO_INSTANCE_GROUP = UINT32_MAX;
+
+    // The render proxy of a mesh renderer: the command that draws it, kept from one frame to the next
+    struct RenderProxy {
+        MeshRendererComponent* renderer;
+        std::uint64_t transformVersion = 0; // The transform version of the owner when "command" was updated (0 means never)
+        RenderCommand command;
+    };
+
+    // The render proxy of a light: its world position (and direction) is only recomputed when its owner moves
+    template<typename T>
+    struct LightProxy {
+        T* light;
+        std::uint64_t transformVersion = 0;
+    };
+
+    // The render scene is the retained representation of the world that the renderer draws.
+    // It listens to the mesh renderer and light pools of the world, so a proxy is created when a component is added
+    // and removed when it is destroyed (e.g. when its entity is deleted), instead of gathering every component each frame.
+    // Every frame, "sync" compares the transform version of each owner (and the mesh & material of each renderer) with the ones
+    // stored in its proxy and only recomputes the matrix, the world bounds and the ids of the proxies that changed.
+    // The world bounds of the proxies are kept in "culler" at the same indices as the proxies.
+    class RenderScene : ComponentListener<MeshRendererComponent>,
+                        ComponentListener<DirectionalLight>,
+                        ComponentListener<SpotLight>,
+                        ComponentListener<ConeLight> {
+        World* world = nullptr;
+
+        std::vector<RenderProxy> proxies;
+        std::unordered_map<const MeshRendererComponent*, size_t> proxyIndices; // The index of each renderer's proxy
+        FrustumCuller culler;
+        std::vector<size_t> changedProxies; // The proxies whose material or mesh was set in the last sync
+
+        std::vector<DirectionalLight*> directionalLights;
+        std::vector<LightProxy<SpotLight>> spotLights;
+        std::vector<LightProxy<ConeLight>> coneLights;
+
+        // The components created since the last sync. They are deserialized after they are created, so they are only read on the next sync
+        std::vector<MeshRendererComponent*> createdRenderers;
+        std::vector<DirectionalLight*> createdDirectionalLights;
+        std::vector<SpotLight*> createdSpotLights;
+        std::vector<ConeLight*> createdConeLights;
+
+        void onComponentCreated(MeshRendererComponent* renderer) override { createdRenderers.push_back(renderer); }
+        void onComponentCreated(DirectionalLight* light) override { createdDirectionalLights.push_back(light); }
+        void onComponentCreated(SpotLight* light) override { createdSpotLights.push_back(light); }
+        void onComponentCreated(ConeLight* light) override { createdConeLights.push_back(light); }
+        void onComponentDestroyed(MeshRendererComponent* renderer) override;
+        void onComponentDestroyed(DirectionalLight* light) override;
+        void onComponentDestroyed(SpotLight* light) override;
+        void onComponentDestroyed(ConeLight* light) override;
+
+        // Adds the proxies of the components created since the last sync
+        void addCreatedComponents();
+
+    public:
+        // Starts listening to the given world and creates the proxies of the components it already has.
+        // Attaching to another world detaches from the current one first
+        void attach(World* world);
+        // Stops listening and removes all the proxies. It must be called before the world (or the scene) is destructed
+        void detach();
+        World* getWorld() const { return world; }
+
+        // Brings the proxies up to date with the world. The transform system should have run before so the transform versions are valid
+        void sync();
+
+        const std::vector<RenderProxy>& getProxies() const { return proxies; }
+        std::vector<RenderProxy>& getProxies() { return proxies; }
+        // The indices of the proxies whose material or mesh was set in the last sync (their ids have to be recomputed by the renderer)
+        const std::vector<size_t>& getChangedProxies() const { return changedProxies; }
+        // The world bounds of the proxies (box i belongs to proxy i)
+        const FrustumCuller& getCuller() const { return culler; }
+
+        const std::vector<DirectionalLight*>& getDirectionalLights() const { return directionalLights; }
+        const std::vector<LightProxy<SpotLight>>& getSpotLights() const { return spotLights; }
+        const std::vector<LightProxy<ConeLight>>& getConeLights() const { return coneLights; }
+
+        RenderScene() = default;
+        ~RenderScene() { detach(); }
+
+        RenderScene(const RenderScene&) = delete;
+        RenderScene& operator=(const RenderScene&) = delete;
+    };
+
+}
@@ -17,7 +17,7 @@ namespace our{
         inline T lerp(const T& a, const T& b, float val){
             return a * (1 - val) + val * b;
         }
-        inline void update_state(StateAnimator* state, float deltaTime , World* world){
+        inline void update_state(StateAnimator* state, float deltaTime){
             if (state->currentState != state->nextState){
                 state->transitionProgress += deltaTime;
 
@@ -58,12 +58,12 @@ namespace our{
 
                 std::vector<Entity*> children;
                 std::vector<glm::vec3> positions;
-                for (auto child : world->getEntities()){
-                    if (child->getComponent<Ground>() && child->hasAncestor(k)){
+                k->forEachDescendant([&](Entity* child){
+                    if (child->getComponent<Ground>()){
                         positions.push_back(child->getWorldPosition());
                         children.push_back(child);
                     }
-                }
+                });
 
                 if (state->position) {
                     auto diff = k->getWorldPosition();
@@ -95,30 +95,27 @@ namespace our{
         }
     public:
         void init(World* world){
-            for (auto k : world->getEntities()){
-                auto state = k->getComponent<StateAnimator>();
-                if (state){
-                    state->nextState = state->currentState;
-                    if (state->position) k->localTransform.position = state->states[state->currentState].position;
-                    if (state->scale   ) k->localTransform.scale    = state->states[state->currentState].scale;
-                    if (state->rotation) k->localTransform.rotation = state->states[state->currentState].rotation;
-                    k->enabled = state->states[state->currentState].enabled;
+            for (auto state : world->getAllComponents<StateAnimator>()){
+                auto k = state->getOwner();
+                state->nextState = state->currentState;
+                if (state->position) k->localTransform.position = state->states[state->currentState].position;
+                if (state->scale   ) k->localTransform.scale    = state->states[state->currentState].scale;
+                if (state->rotation) k->localTransform.rotation = state->states[state->currentState].rotation;
+                k->enabled = state->states[state->currentState].enabled;
 
-                    if (state->tint){
-                        for (auto renderer: k->getAllComponents<MeshRendererComponent>()) {
-                            auto mat = (DefaultMaterial *) renderer->material;
-                            mat->tint = state->states[state->currentState].tint;
-                        }
+                if (state->tint){
+                    for (auto renderer: k->getAllComponents<MeshRendererComponent>()) {
+                        auto mat = (DefaultMaterial *) renderer->material;
+                        mat->tint = state->states[state->currentState].tint;
                     }
                 }
             }
         }
 
         void update(World* world, float deltaTime){
-            for (auto k : world->getEntities()){
-                auto state = k->getComponent<StateAnimator>();
-                if (state && state->currentState != state->nextState){
-                    update_state(state , deltaTime , world);
+            for (auto state : world->getAllComponents<StateAnimator>()){
+                if (state->currentState != state->nextState){
+                    update_state(state , deltaTime);
                 }
             }
         }
@@ -0,0 +1,219 @@
+#include "static-batcher.hpp"
+#include "../components/camera.hpp"
+#include "../components/movement.hpp"
+#include "../components/Paimon.hpp"
+#include "../components/PaimonIdle.hpp"
+#include "../components/Mora.hpp"
+#include "../components/actions/StateAnimator.h"
+
+namespace our {
+
+    bool StaticBatcher::isDynamic(const Entity* entity) {
+        // The components whose systems write the transform of their owner (and so of its descendants)
+        static const ComponentMask dynamicMask =
+                makeComponentMask<StateAnimator, MovementComponent, Paimon, PaimonIdle, Mora, CameraComponent>();
+        for (; entity != nullptr; entity = entity->getParent()){
+            if ((entity->getComponentMask() & dynamicMask).any()) return true;
+        }
+        return false;
+    }
+
+    bool StaticBatcher::canBatch(const MeshRendererComponent* renderer) {
+        if (renderer->mesh == nullptr) return false;
+        auto material = dynamic_cast<const DefaultMaterial*>(renderer->material);
+        // The batch is drawn with the batched variant of the default vertex shader
+        return material != nullptr && !material->isSkybox && material->shader != nullptr &&
+               material->shader->getAttachedFile(GL_VERTEX_SHADER) == "assets/shaders/default.vert";
+    }
+
+    const StaticBatcher::MeshData& StaticBatcher::getMeshData(const Mesh* mesh) {
+        auto it = meshData.find(mesh);
+        if (it == meshData.end()){
+            it = meshData.emplace(mesh, MeshData()).first;
+            mesh->readBack(it->second.vertices, it->second.elements);
+        }
+        return it->second;
+    }
+
+    void StaticBatcher::build(World* world) {
+        clear();
+
+        for (auto renderer : world->getAllComponents<MeshRendererComponent>()){
+            if (!canBatch(renderer) || isDynamic(renderer->getOwner())) continue;
+
+            // The objects whose materials only differ by the tint share a batch
+            auto material = static_cast<DefaultMaterial*>(renderer->material);
+            StaticBatch* batch = nullptr;
+            for (auto& other : batches){
+                if (other.material->isInstanceCompatible(*material)){
+                    batch = &other;
+                    break;
+                }
+            }
+            if (batch == nullptr){
+                batches.emplace_back();
+                batch = &batches.back();
+                batch->material = material;
+            }
+            StaticBatch::Member member;
+            member.renderer = renderer;
+            batch->members.push_back(member);
+            renderer->staticBatched = true;
+        }
+
+        for (auto& batch : batches){
+            merge(batch);
+        }
+    }
+
+    void StaticBatcher::merge(StaticBatch& batch) {
+        retire(batch);
+        batch.dirty = false;
+        if (batch.members.empty()) return;
+
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> elements;
+        tints.clear();
+        for (auto& member : batch.members){
+            auto renderer = member.renderer.get();
+            const MeshData& data = getMeshData(renderer->mesh);
+            const glm::mat4& localToWorld = renderer->getOwner()->getLocalToWorldMatrix();
+            // The same normal matrix as the one the render scene computes for the default vertex shaders
+            glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(localToWorld)));
+
+            int count;
+            unsigned long long offset;
+            renderer->mesh->getRange(renderer->shapeID, count, offset);
+            size_t first = offset / sizeof(unsigned int);
+
+            // Only the vertices used by the shape are copied, each one once
+            remap.assign(data.vertices.size(), -1);
+            member.firstVertex = (GLint) vertices.size();
+            for (size_t i = first; i < first + count; i++){
+                unsigned int source = data.elements[i];
+                if (remap[source] == -1){
+                    remap[source] = (int) vertices.size();
+                    Vertex vertex = data.vertices[source];
+                    vertex.position = glm::vec3(localToWorld * glm::vec4(vertex.position, 1.0f));
+                    vertex.normal = normalMatrix * vertex.normal;
+                    vertices.push_back(vertex);
+                }
+                elements.push_back((unsigned int) remap[source]);
+            }
+            member.vertexCount = (GLsizei) (vertices.size() - member.firstVertex);
+            member.tint = static_cast<const DefaultMaterial*>(renderer->material)->tint;
+            tints.insert(tints.end(), member.vertexCount, member.tint);
+        }
+
+        batch.mesh = new Mesh(vertices, elements);
+        batch.mesh->bounds = computeBounds(vertices, elements, 0, elements.size() - 1);
+
+        glGenBuffers(1, &batch.tintBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, batch.tintBuffer);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (tints.size() * sizeof(glm::vec4)), tints.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        batch.mesh->setTintBuffer(batch.tintBuffer);
+    }
+
+    void StaticBatcher::release(StaticBatch& batch) {
+        delete batch.mesh;
+        batch.mesh = nullptr;
+        glDeleteBuffers(1, &batch.tintBuffer);
+        batch.tintBuffer = 0;
+    }
+
+    void StaticBatcher::retire(StaticBatch& batch) {
+        if (batch.mesh) retiredMeshes.push_back(batch.mesh);
+        if (batch.tintBuffer) retiredTintBuffers.push_back(batch.tintBuffer);
+        batch.mesh = nullptr;
+        batch.tintBuffer = 0;
+    }
+
+    void StaticBatcher::deleteRetired() {
+        for (auto mesh : retiredMeshes) delete mesh;
+        retiredMeshes.clear();
+        if (!retiredTintBuffers.empty()) glDeleteBuffers((GLsizei) retiredTintBuffers.size(), retiredTintBuffers.data());
+        retiredTintBuffers.clear();
+    }
+
+    void StaticBatcher::demote(Entity* entity) {
+        auto demoteRenderers = [this](Entity* e){
+            for (auto renderer : e->getAllComponents<MeshRendererComponent>()){
+                if (!renderer->staticBatched) continue;
+                renderer->staticBatched = false;
+                for (auto& batch : batches){
+                    auto& members = batch.members;
+                    auto it = std::find_if(members.begin(), members.end(), [renderer](const StaticBatch::Member& member){
+                        return member.renderer.get() == renderer;
+                    });
+                    if (it != members.end()){
+                        members.erase(it);
+                        batch.dirty = true;
+                        break;
+                    }
+                }
+            }
+        };
+        demoteRenderers(entity);
+        entity->forEachDescendant(demoteRenderers);
+    }
+
+    void StaticBatcher::update(World* world) {
+        // The frame packets prepared before the last update have been submitted by now
+        deleteRetired();
+        if (batches.empty()) return;
+
+        // Animators are only checked while they are moving their entity, so an idle animator doesn't cost anything
+        for (auto animator : world->getAllComponents<StateAnimator>()){
+            if (animator->currentState != animator->nextState) demote(animator->getOwner());
+        }
+        for (auto movement : world->getAllComponents<MovementComponent>()){
+            demote(movement->getOwner());
+        }
+
+        for (auto& batch : batches){
+            auto& members = batch.members;
+            // Members whose entities were removed from the world leave the batch
+            auto removed = std::remove_if(members.begin(), members.end(), [](const StaticBatch::Member& member){
+                return member.renderer.get() == nullptr;
+            });
+            if (removed != members.end()){
+                members.erase(removed, members.end());
+                batch.dirty = true;
+            }
+            if (batch.dirty){
+                merge(batch);
+                continue;
+            }
+
+            // The tints can change without moving anything (e.g. the highlighted ground), so only their range of the buffer is updated
+            for (auto& member : members){
+                const glm::vec4& tint = static_cast<const DefaultMaterial*>(member.renderer->material)->tint;
+                if (tint == member.tint) continue;
+                member.tint = tint;
+                tints.assign(member.vertexCount, tint);
+                glBindBuffer(GL_ARRAY_BUFFER, batch.tintBuffer);
+                glBufferSubData(GL_ARRAY_BUFFER, (GLintptr) (member.firstVertex * sizeof(glm::vec4)),
+                                (GLsizeiptr) (tints.size() * sizeof(glm::vec4)), tints.data());
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+        }
+
+        batches.erase(std::remove_if(batches.begin(), batches.end(), [](const StaticBatch& batch){
+            return batch.members.empty();
+        }), batches.end());
+    }
+
+    void StaticBatcher::clear() {
+        for (auto& batch : batches){
+            for (auto& member : batch.members){
+                if (auto renderer = member.renderer.get()) renderer->staticBatched = false;
+            }
+            release(batch);
+        }
+        batches.clear();
+        meshData.clear();
+        deleteRetired();
+    }
+
+}
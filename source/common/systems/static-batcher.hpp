@@ -0,0 +1,95 @@
+#pragma once
+
+#include "../ecs/world.hpp"
+#include "../ecs/component-ref.hpp"
+#include "../components/mesh-renderer.hpp"
+
+#include <glad/gl.h>
+#include <unordered_map>
+#include <vector>
+
+namespace our {
+
+    // A static batch is the geometry of many static objects that share a material (up to their tints) merged into one mesh.
+    // The vertices are moved to the world space when the batch is built and the tint of every object is stored per vertex,
+    // so the whole batch is drawn with one draw call and no model matrix.
+    struct StaticBatch {
+        // An object merged in the batch and the range of the batch vertices that came from it
+        struct Member {
+            ComponentRef<MeshRendererComponent> renderer;
+            GLint firstVertex = 0;
+            GLsizei vertexCount = 0;
+            glm::vec4 tint; // The tint written in the tint buffer (compared to the material tint every frame)
+        };
+
+        DefaultMaterial* material = nullptr; // The material of the first member, the batch is drawn with it
+        std::vector<Member> members;
+        Mesh* mesh = nullptr;                // The merged mesh (its bounds are in the world space)
+        GLuint tintBuffer = 0;               // One glm::vec4 tint per vertex of "mesh"
+        bool dirty = false;                  // True if members were removed and the mesh has to be merged again
+    };
+
+    // The static batcher merges the objects that never move into static batches when a level is loaded.
+    // An entity is dynamic if it (or one of its ancestors) has a component whose system moves it (see "isDynamic"),
+    // otherwise its mesh renderers are batched and flagged so the renderer doesn't draw them on their own.
+    // If an animator starts moving a batched entity (or a movement component is added to it) later, the entity is demoted:
+    // its mesh renderers leave their batches and are drawn as dynamic objects from then on.
+    class StaticBatcher {
+        std::vector<StaticBatch> batches;
+
+        // The vertex & element data of the source meshes, read back once and kept till the batches are cleared
+        // since they are needed again to merge a batch after one of its members is demoted
+        struct MeshData {
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> elements;
+        };
+        std::unordered_map<const Mesh*, MeshData> meshData;
+        std::vector<int> remap;                 // Maps the vertices of a source mesh to the vertices of the batch while merging
+        std::vector<glm::vec4> tints;           // Scratch buffer for updating the tints
+
+        // Returns the data of the given mesh, reading it back from the VRAM the first time
+        const MeshData& getMeshData(const Mesh* mesh);
+        // Returns true if the renderer can be merged in a batch (lit materials drawn with the default vertex shader)
+        static bool canBatch(const MeshRendererComponent* renderer);
+        // Returns true if the entity or one of its ancestors can be moved by a system
+        static bool isDynamic(const Entity* entity);
+        // Merges the members of the batch into a new mesh and tint buffer
+        void merge(StaticBatch& batch);
+        // Deletes the mesh and the tint buffer of the batch
+        static void release(StaticBatch& batch);
+
+        // The meshes and the tint buffers of the batches that were merged again by the last update.
+        // A frame packet prepared before that update can still be submitted after it (see "ForwardRenderer::isPipelined"),
+        // so they are only deleted by the next update
+        std::vector<Mesh*> retiredMeshes;
+        std::vector<GLuint> retiredTintBuffers;
+        // Moves the mesh and the tint buffer of the batch to the retired ones
+        void retire(StaticBatch& batch);
+        // Deletes the retired meshes and tint buffers
+        void deleteRetired();
+
+    public:
+        // Classifies the entities of the world and builds the batches of the static ones (the old batches are cleared first).
+        // It should be called after the level is loaded and the initial transforms are applied
+        void build(World* world);
+
+        // Demotes the entities that started moving, then updates the tints that changed and merges the batches that lost members.
+        // It should be called every frame before the renderer gathers its commands
+        void update(World* world);
+
+        // Removes the mesh renderers of the entity and of its descendants from their batches
+        void demote(Entity* entity);
+
+        // Deletes all the batches and gives the mesh renderers back to the renderer
+        void clear();
+
+        const std::vector<StaticBatch>& getBatches() const { return batches; }
+
+        StaticBatcher() = default;
+        ~StaticBatcher() { clear(); }
+
+        StaticBatcher(const StaticBatcher&) = delete;
+        StaticBatcher& operator=(const StaticBatcher&) = delete;
+    };
+
+}
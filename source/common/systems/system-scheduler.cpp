@@ -0,0 +1,132 @@
+#include "system-scheduler.hpp"
+#include "../ecs/world.hpp"
+
+#include <algorithm>
+
+namespace our {
+
+    // The resource key of "WorldStructure", writing it conflicts with everything
+    static const std::uint64_t WORLD_STRUCTURE_KEY = (std::uint64_t(1) << 32) | std::uint32_t(SystemResource::WorldStructure);
+
+    bool ScopeOverlaps::overlap(ComponentTypeId first, ComponentTypeId second) {
+        if (!computed) {
+            for (auto entity : world->getEntities()) {
+                ComponentMask mask;
+                for (const Entity* ancestor = entity; ancestor != nullptr; ancestor = ancestor->getParent()) {
+                    mask |= ancestor->getComponentMask();
+                }
+                if (std::find(pathMasks.begin(), pathMasks.end(), mask) == pathMasks.end()) pathMasks.push_back(mask);
+            }
+            computed = true;
+        }
+        // Both types are on the path from an entity to its root, so one of their entities is the other one or one of its ancestors
+        return std::any_of(pathMasks.begin(), pathMasks.end(), [first, second](const ComponentMask& mask){
+            return mask.test(first) && mask.test(second);
+        });
+    }
+
+    bool SystemAccess::writesWorldStructure() const {
+        return std::any_of(entries.begin(), entries.end(), [](const Entry& entry){
+            return entry.write && entry.key == WORLD_STRUCTURE_KEY;
+        });
+    }
+
+    bool SystemAccess::conflictsWith(const SystemAccess& other, ScopeOverlaps& overlaps) const {
+        if (writesWorldStructure() || other.writesWorldStructure()) return true;
+
+        for (auto& a : entries){
+            for (auto& b : other.entries){
+                if (a.key != b.key || !(a.write || b.write)) continue;
+                // Accesses for all the entities or for the same scope always overlap, the others only if their entities do
+                if (a.scope == UNSCOPED || b.scope == UNSCOPED || a.scope == b.scope) return true;
+                if (overlaps.overlap(a.scope, b.scope)) return true;
+            }
+        }
+        return false;
+    }
+
+    SystemScheduler::SystemId SystemScheduler::add(std::string name, SystemAccess access, std::function<void()> run) {
+        System system;
+        system.name = std::move(name);
+        system.access = std::move(access);
+        system.run = std::move(run);
+        systems.push_back(std::move(system));
+        return systems.size() - 1;
+    }
+
+    void SystemScheduler::setEnabled(SystemId id, bool enabled) {
+        systems[id].enabled = enabled;
+    }
+
+    void SystemScheduler::submit(SystemId id, JobCounter& counter) {
+        jobs.submit([this, id, &counter](){
+            systems[id].run();
+
+            // Release the systems that were waiting for this one
+            std::vector<SystemId> released;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto dependent : systems[id].dependents){
+                    if (--systems[dependent].remainingDependencies == 0){
+                        released.push_back(dependent);
+                    }
+                }
+            }
+            // They are submitted before this job finishes, so the counter never reaches zero too early
+            for (auto dependent : released){
+                submit(dependent, counter);
+            }
+        }, &counter);
+    }
+
+    void SystemScheduler::runSegment(World* world, SystemId begin, SystemId end) {
+        std::vector<SystemId> enabled;
+        for (SystemId id = begin; id < end; id++){
+            if (systems[id].enabled) enabled.push_back(id);
+        }
+        if (enabled.empty()) return;
+
+        // Build the dependency graph of the segment. The scopes are only checked against the world if two accesses need it
+        ScopeOverlaps overlaps(world);
+        bool chain = true; // True if every system conflicts with the one before, then nothing can run at the same time
+        for (auto id : enabled){
+            systems[id].dependents.clear();
+            systems[id].remainingDependencies = 0;
+        }
+        for (size_t j = 1; j < enabled.size(); j++){
+            for (size_t i = 0; i < j; i++){
+                if (systems[enabled[i]].access.conflictsWith(systems[enabled[j]].access, overlaps)){
+                    systems[enabled[i]].dependents.push_back(enabled[j]);
+                    systems[enabled[j]].remainingDependencies++;
+                } else if (i == j - 1){
+                    chain = false;
+                }
+            }
+        }
+        if (chain){
+            for (auto id : enabled) systems[id].run();
+            return;
+        }
+
+        JobCounter counter;
+        for (auto id : enabled){
+            if (systems[id].remainingDependencies == 0) submit(id, counter);
+        }
+        // The calling thread runs systems (and any other jobs) too instead of just waiting
+        jobs.wait(counter);
+    }
+
+    void SystemScheduler::run(World* world) {
+        SystemId begin = 0;
+        while (begin < systems.size()){
+            // The segment ends at the next enabled system that writes the world structure
+            SystemId end = begin;
+            while (end < systems.size() && !(systems[end].enabled && systems[end].access.writesWorldStructure())) end++;
+            runSegment(world, begin, end);
+            // The barrier runs alone, after the segment before it and before the segment after it
+            if (end < systems.size()) systems[end].run();
+            begin = end + 1;
+        }
+    }
+
+}
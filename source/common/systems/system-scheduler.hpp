@@ -0,0 +1,164 @@
+#pragma once
+
+#include "../ecs/component-storage.hpp"
+#include "../jobs/job-system.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace our
+{
+
+    // The data that systems share but that is not stored in a component
+    enum class SystemResource : std::uint32_t {
+        Transforms,       // The local transforms, the cached matrices and the enabled flags of the entities
+        WorldStructure,   // Adding and removing entities or components, or changing parents. Writing it conflicts with every other system
+        Events,           // The trigger and action queues of the events system
+        LevelMapping,     // The ground graph built every frame by the level mapping system
+        PaimonController, // The state of the paimon movement system (its target and next block)
+        Materials,        // The material parameters such as the tint of the highlighted blocks
+    };
+
+    class World;
+
+    // Tells whether the entities of two scopes (component types) overlap in a world: an entity of one scope is also in the other scope,
+    // or is an ancestor or a descendant of an entity of the other scope (a world matrix depends on the transforms of all the ancestors).
+    // For every entity, the components of the entity and of all its ancestors are merged in a "path mask", so two scopes overlap
+    // if one of the path masks contains both. The masks are computed on the first query, which walks every entity up to its root once.
+    class ScopeOverlaps {
+        World* world;
+        bool computed = false;
+        std::vector<ComponentMask> pathMasks; // The distinct path masks of the entities (there are only a few in a level)
+    public:
+        explicit ScopeOverlaps(World* world) : world(world) {}
+        // Returns true if the entities of the two component types overlap
+        bool overlap(ComponentTypeId first, ComponentTypeId second);
+    };
+
+    // A system access declares the components and the resources that a system reads and writes.
+    // Two systems conflict (and so can not run at the same time) if one of them writes something the other reads or writes.
+    // An access can be scoped to the entities that hold a component type, e.g. "writesFor<MovementComponent>(Transforms)"
+    // means that the system only writes the transforms of the entities that have a MovementComponent.
+    // Two accesses to the same resource with different scopes only conflict if their scopes overlap in the world (see "ScopeOverlaps").
+    // The scheduler checks it every frame, so the declarations only have to be true for the entities of the scope.
+    class SystemAccess {
+    public:
+        static constexpr std::uint32_t UNSCOPED = ~0u;
+
+        struct Entry {
+            std::uint64_t key;   // The component type id or the resource (resources are offset so they never equal a component type id)
+            std::uint32_t scope; // The component type id of the scope or UNSCOPED
+            bool write;
+        };
+
+    private:
+        std::vector<Entry> entries;
+
+        static std::uint64_t resourceKey(SystemResource resource) {
+            return (std::uint64_t(1) << 32) | std::uint32_t(resource);
+        }
+
+    public:
+        // Declares that the system reads the components of the given types
+        template<typename... T>
+        SystemAccess& reads() {
+            (entries.push_back({getComponentTypeId<T>(), UNSCOPED, false}), ...);
+            return *this;
+        }
+
+        // Declares that the system writes the components of the given types
+        template<typename... T>
+        SystemAccess& writes() {
+            (entries.push_back({getComponentTypeId<T>(), UNSCOPED, true}), ...);
+            return *this;
+        }
+
+        // Declares that the system reads the given resource for all the entities
+        SystemAccess& reads(SystemResource resource) {
+            entries.push_back({resourceKey(resource), UNSCOPED, false});
+            return *this;
+        }
+
+        // Declares that the system writes the given resource for all the entities
+        SystemAccess& writes(SystemResource resource) {
+            entries.push_back({resourceKey(resource), UNSCOPED, true});
+            return *this;
+        }
+
+        // Declares that the system only reads the given resource for the entities that have a component of type S
+        template<typename S>
+        SystemAccess& readsFor(SystemResource resource) {
+            entries.push_back({resourceKey(resource), getComponentTypeId<S>(), false});
+            return *this;
+        }
+
+        // Declares that the system only writes the given resource for the entities that have a component of type S
+        template<typename S>
+        SystemAccess& writesFor(SystemResource resource) {
+            entries.push_back({resourceKey(resource), getComponentTypeId<S>(), true});
+            return *this;
+        }
+
+        // Returns true if the system writes the world structure (it can not run at the same time as any other system)
+        bool writesWorldStructure() const;
+        // Returns true if the two systems can not run at the same time in the world of the given overlaps
+        bool conflictsWith(const SystemAccess& other, ScopeOverlaps& overlaps) const;
+    };
+
+    // The system scheduler runs a list of systems every frame.
+    // The systems that write the world structure are barriers: they split the other systems into segments that run one after another,
+    // and each barrier runs alone on the calling thread. Right before a segment runs, the scheduler builds its dependency graph
+    // from the declared accesses of its enabled systems (so the scopes are checked against the world as the previous barrier left it):
+    // a system depends on every system that was added before it and conflicts with it.
+    // The systems that don't depend on each other run concurrently as jobs on the job system (the calling thread helps too),
+    // and the systems that conflict always run in the order in which they were added, so the results stay deterministic.
+    // A segment with a single system, or whose systems each conflict with the one before, runs directly on the calling thread.
+    class SystemScheduler {
+    public:
+        using SystemId = size_t;
+
+    private:
+        struct System {
+            std::string name;
+            SystemAccess access;
+            std::function<void()> run;
+            bool enabled = true;
+
+            std::vector<SystemId> dependents; // The systems that wait for this system in the current frame
+            int remainingDependencies = 0;    // The number of systems this system still waits for in the current frame
+        };
+
+        std::vector<System> systems;
+        JobSystem& jobs;
+        std::mutex mutex; // Guards the dependency counters while the systems run
+
+        // Submits the system as a job. When it is done, the systems that depend on it are submitted in turn
+        void submit(SystemId id, JobCounter& counter);
+        // Runs the enabled systems in [begin, end), none of which writes the world structure
+        void runSegment(World* world, SystemId begin, SystemId end);
+
+    public:
+        // The systems run on the given job system (the tests use their own to choose the worker count)
+        explicit SystemScheduler(JobSystem& jobs = JobSystem::getInstance()) : jobs(jobs) {}
+
+        // Adds a system to the scheduler and returns its id. The order of addition is the order of execution of conflicting systems
+        SystemId add(std::string name, SystemAccess access, std::function<void()> run);
+
+        // Removes all the systems from the scheduler
+        void clear() { systems.clear(); }
+
+        // Enables or disables a system. Disabled systems are skipped (and don't delay other systems)
+        void setEnabled(SystemId id, bool enabled);
+
+        // Runs all the enabled systems once on the given world and returns after all of them are done
+        void run(World* world);
+
+        // The scheduler should not be copyable
+        SystemScheduler(const SystemScheduler&) = delete;
+        SystemScheduler& operator=(const SystemScheduler&) = delete;
+    };
+
+}
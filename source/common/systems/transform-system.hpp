@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../ecs/world.hpp"
+#include "../ecs/transform-batch.hpp"
+#include "../jobs/job-system.hpp"
+
+namespace our
+{
+
+    // The transform system brings the cached local to world matrices of all the entities up to date once per frame.
+    // First, the local matrices of the entities whose transform changed are computed together in a SIMD batch (split between the workers of the job system).
+    // Then, since every entity validates its parent before itself, parents are always updated before their children,
+    // and only the entities whose transform (or an ancestor's transform) changed since the last frame do any matrix math.
+    // After this system runs, every other system (and the renderer) reads the cached matrices directly.
+    class TransformSystem {
+        static constexpr size_t BATCH_SIZE = 256; // The number of transforms computed by each job
+
+        std::vector<Entity*> dirtyEntities;  // The entities whose local matrices are computed in this frame
+        TransformBatch batch;                // Their transforms in SoA form
+        std::vector<glm::mat4> localMatrices; // Their new local matrices
+    public:
+
+        // This should be called every frame after the systems that move the entities and before the ones that read their matrices
+        // It should not run while other systems are running since it writes the caches without locking them
+        void update(World* world) {
+            dirtyEntities.clear();
+            batch.clear();
+            for(auto entity : world->getEntities()){
+                if(entity->isLocalMatrixDirty()){
+                    dirtyEntities.push_back(entity);
+                    batch.push(entity->localTransform);
+                }
+            }
+
+            localMatrices.resize(dirtyEntities.size());
+            size_t batchCount = (dirtyEntities.size() + BATCH_SIZE - 1) / BATCH_SIZE;
+            JobSystem::getInstance().parallelFor(0, batchCount, 1, [this](size_t index){
+                size_t begin = index * BATCH_SIZE;
+                size_t end = std::min(begin + BATCH_SIZE, dirtyEntities.size());
+                batch.computeMatrices(begin, end, localMatrices.data());
+            });
+            for(size_t i = 0; i < dirtyEntities.size(); i++){
+                dirtyEntities[i]->setLocalMatrix(localMatrices[i]);
+            }
+
+            for(auto entity : world->getEntities()){
+                entity->getLocalToWorldMatrix();
+            }
+        }
+
+    };
+
+}
@@ -0,0 +1,46 @@
+#include "transparent-sorter.hpp"
+
+namespace our {
+
+    bool TransparentSorter::sort(std::vector<RenderCommand>& commands, const glm::vec3& cameraCenter, const glm::vec3& cameraForward){
+        size_t count = commands.size();
+        // The last order can only be reused if the same commands were gathered in the same order
+        bool sameCommands = identities.size() == count && order.size() == count;
+        identities.resize(count);
+        depthKeys.resize(count);
+        for (size_t i = 0; i < count; i++){
+            const auto& command = commands[i];
+            CommandIdentity identity{command.mesh, command.material, command.shapeID};
+            sameCommands = sameCommands && identities[i] == identity;
+            identities[i] = identity;
+            // The depth is computed once per command, and inverted so that the farthest command gets the smallest key
+            depthKeys[i] = ~floatSortKey(glm::dot(command.center - cameraCenter, cameraForward));
+        }
+
+        items.clear();
+        bool reused = false;
+        if (sameCommands){
+            // When the camera moves a little, the last order is almost right and an insertion sort fixes it in a few moves
+            for (auto index : order){
+                items.push_back({depthKeys[index], index});
+            }
+            reused = insertionSort(items, MAX_FIXUP_SHIFTS * count);
+        } else {
+            for (uint32_t i = 0; i < count; i++){
+                items.push_back({depthKeys[i], i});
+            }
+        }
+        // Otherwise (or if the fix up gave up since the camera moved too much) the depth keys are radix sorted
+        if (!reused) radixSort(items, scratch);
+
+        order.clear();
+        sortedCommands.clear();
+        for (const auto& item : items){
+            order.push_back(item.index);
+            sortedCommands.push_back(commands[item.index]);
+        }
+        std::swap(commands, sortedCommands);
+        return reused;
+    }
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "render-scene.hpp"
+#include "../radix-sort.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace our {
+
+    // The transparent sorter orders the transparent commands of every frame from back to front.
+    // The depth of every command is computed once into a 32-bit key (see "floatSortKey") which is radix sorted.
+    // If the same commands are sorted again (gathered in the same order), the last order is reused and fixed by an insertion sort,
+    // which only needs a few moves when the camera moved a little. It gives up after MAX_FIXUP_SHIFTS moves per command
+    // (e.g. when the camera turned around) and falls back to the radix sort.
+    class TransparentSorter {
+        struct CommandIdentity {
+            const Mesh* mesh;
+            const Material* material;
+            int shapeID;
+            bool operator==(const CommandIdentity& other) const {
+                return mesh == other.mesh && material == other.material && shapeID == other.shapeID;
+            }
+        };
+        std::vector<CommandIdentity> identities; // The commands of the last sort in the order they were gathered
+        std::vector<uint32_t> order;             // Their sorted order (indices into the gathered order)
+        std::vector<uint32_t> depthKeys;
+        std::vector<SortItem> items, scratch;
+        std::vector<RenderCommand> sortedCommands;
+
+    public:
+        static constexpr size_t MAX_FIXUP_SHIFTS = 4;
+
+        // Sorts the commands from back to front along the camera forward direction.
+        // Returns true if the last order was reused (fixed by the insertion sort), false if the commands were radix sorted
+        bool sort(std::vector<RenderCommand>& commands, const glm::vec3& cameraCenter, const glm::vec3& cameraForward);
+        // Forgets the last order, so the next sort is a full radix sort
+        void clear() {
+            identities.clear();
+            order.clear();
+        }
+    };
+
+}
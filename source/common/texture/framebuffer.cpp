@@ -4,6 +4,7 @@
 
 #include "framebuffer.h"
 #include "texture-utils.hpp"
+#include "../gl-state-cache.hpp"
 #include <unordered_map>
 #include <thread>
 
@@ -32,7 +33,7 @@ void our::Framebuffer::addDepthTexture(GLenum format) {
 bool our::Framebuffer::bind() const {
     auto thread_id = std::this_thread::get_id();
     if (map[thread_id].empty() || map[thread_id].back() != id){
-        glBindFramebuffer(GL_FRAMEBUFFER,id);
+        GLStateCache::getInstance().bindFramebuffer(id);
         map[thread_id].emplace_back(id);
         return true;
     }
@@ -48,7 +49,7 @@ void our::Framebuffer::unbind() const {
     GLuint bind_target = 0;
     if (!map[thread_id].empty())
         bind_target = map[thread_id].back();
-    glBindFramebuffer(GL_FRAMEBUFFER,bind_target);
+    GLStateCache::getInstance().bindFramebuffer(bind_target);
 }
 
 our::Texture2D* our::Framebuffer::getColorTexture(int index) {
@@ -60,6 +61,7 @@ our::Texture2D *our::Framebuffer::getDepthTexture() {
 }
 
 our::Framebuffer::~Framebuffer() {
+    GLStateCache::getInstance().forgetFramebuffer(id);
     glDeleteFramebuffers(1 , &id);
     for (auto k : color){
         delete k;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <cstddef>
+#include "../gl-state-cache.hpp"
+
+namespace our {
+
+    // This class defines an OpenGL buffer texture: a buffer that the shaders read with texelFetch through a samplerBuffer
+    // (or an isamplerBuffer/usamplerBuffer) where every texel has the given internal format (e.g. GL_RGBA32F or GL_R16UI).
+    // Unlike a uniform buffer, its size is only limited by GL_MAX_TEXTURE_BUFFER_SIZE (at least 65536 texels),
+    // so it can hold lists whose length changes every frame.
+    class TextureBuffer {
+        // The OpenGL object names of the buffer and of the texture that reads it
+        GLuint buffer, texture;
+        // The size of the buffer storage (in bytes), the storage is only reallocated if a larger size is needed
+        size_t capacity = 0;
+    public:
+        explicit TextureBuffer(GLenum format) {
+            glGenBuffers(1, &buffer);
+            glGenTextures(1, &texture);
+            // The texture reads the buffer object itself, so it keeps working when the storage is reallocated
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+            capacity = 16;
+            glBindTexture(GL_TEXTURE_BUFFER, texture);
+            glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+
+        ~TextureBuffer() {
+            glDeleteTextures(1, &texture);
+            glDeleteBuffers(1, &buffer);
+        }
+
+        // Uploads "size" bytes from "data" to the start of the buffer.
+        // The storage is orphaned first so that the driver doesn't wait for the draws of the previous frame that still read the old data.
+        void setData(const void* data, size_t size) {
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            if (size > capacity) capacity = size;
+            glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr) capacity, nullptr, GL_STREAM_DRAW);
+            if (size > 0) glBufferSubData(GL_TEXTURE_BUFFER, 0, (GLsizeiptr) size, data);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+
+        // Binds the texture to GL_TEXTURE_BUFFER of the given texture unit
+        void bind(GLuint textureUnit) const {
+            GLStateCache::getInstance().activeTexture(textureUnit);
+            glBindTexture(GL_TEXTURE_BUFFER, texture);
+        }
+
+        TextureBuffer(const TextureBuffer&) = delete;
+        TextureBuffer& operator=(const TextureBuffer&) = delete;
+    };
+
+}
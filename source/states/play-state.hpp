@@ -17,6 +17,9 @@
 #include "audio/audio.hpp"
 
 #include "systems/state-system.hpp"
+#include "systems/transform-system.hpp"
+#include "systems/system-scheduler.hpp"
+#include "jobs/job-system.hpp"
 #include "texture/texture-utils.hpp"
 
 using namespace irrklang;
@@ -36,6 +39,14 @@ class Playstate: public our::State {
     our::PaimonMovement paimonMovement;
     our::AudioPlayer* audioPlayer = our::AudioPlayer::getInstance();
     our::StateSystem stateSystem;
+    our::TransformSystem transformSystem;
+    // runs the logic systems every frame: the ones whose declared accesses don't conflict in the current world run in parallel (see initScheduler)
+    our::SystemScheduler scheduler;
+    std::vector<our::SystemScheduler::SystemId> playingSystems; // the systems that only run while the game is playing
+    // the inputs and outputs of the scheduled systems for the current frame
+    float frameDeltaTime = 0;
+    int frameGold = 0, frameBlue = 0, frameRed = 0;
+    bool frameWon = false;
     // textures
     our::Texture2D* mora_tex;
     our::Texture2D* game_over_tex;
@@ -67,6 +78,7 @@ class Playstate: public our::State {
     ImVec2 button_style_pos_offset = {200.0f, 19.0f};
     std::vector<float> hudPadding = {30.0f, 30.0f, 30.0f, 30.0f}; // {top, left , bottom , right}
     bool showMenu = false;
+    bool showRenderStats = false; // toggled with F3, shows what the renderer did in the last frame
     float fade = 0.0f;
 
     our::OrbitalCameraComponent* cameraComponent;
@@ -415,6 +427,23 @@ class Playstate: public our::State {
         ImGui::End();
     }
 
+    // a small overlay with the renderer stats of the last submitted frame (commands, draw calls and the state changes that were saved)
+    void drawRenderStats() {
+        const our::RenderStats& stats = renderer.getStats();
+        ImGui::Begin("render_stats", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize
+            | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav);
+        ImGui::SetWindowPos({hudPadding[1], windowSize.y - 260});
+        ImGui::Text("%s renderer", renderer.isPipelined() ? "pipelined" : "serial");
+        ImGui::Text("commands: %zu (%zu culled, %zu dropped)", stats.commands, stats.culledCommands, stats.droppedCommands);
+        ImGui::Text("draw calls: %zu (%zu instanced, %zu static batches)", stats.drawCalls, stats.instancedDrawCalls, stats.staticBatchDrawCalls);
+        ImGui::Text("depth pre-pass draw calls: %zu", stats.depthPrepassDrawCalls);
+        ImGui::Text("state changes: %zu pipeline, %zu shader, %zu material", stats.pipelineStateChanges, stats.shaderChanges, stats.materialChanges);
+        ImGui::Text("saved state changes: %zu", stats.getSavedStateChanges());
+        ImGui::Text("clustered lights: %zu (%zu indices)", stats.clusteredLights, stats.clusterLightIndices);
+        ImGui::Text("transparent order reused: %s", stats.transparentOrderReused ? "yes" : "no");
+        ImGui::End();
+    }
+
     void drawHUD() {
         static double time = glfwGetTime();
         ImGui::PushStyleVar(ImGuiStyleVar_Alpha, fade);
@@ -424,6 +453,7 @@ class Playstate: public our::State {
         drawHint();
         ImGui::PopStyleVar();
         time = glfwGetTime();
+        if(showRenderStats) drawRenderStats();
         if(gameState != PLAYING) drawEndGame();
         if(showMenu && gameState == PLAYING) drawMenu();
     }
@@ -441,6 +471,84 @@ class Playstate: public our::State {
         fade = 0;
     }
 
+    // registers the logic systems in the scheduler with the components and resources each one reads and writes
+    // the systems are added in the order in which they used to run, so the systems that conflict still run in that order
+    // the scoped accesses ("readsFor", "writesFor") only conflict if their entities share an entity or a branch of the hierarchy,
+    // which the scheduler checks against the world every frame. e.g. in the first levels, after the state system,
+    // movement, paimon idle and level mapping run at the same time, then paimon movement runs next to movement
+    // (in level 4 some moving entities are grounds, so there movement waits for level mapping and paimon movement instead).
+    // the events and the collision systems change the world structure so they run alone
+    void initScheduler() {
+        using our::SystemAccess;
+        using our::SystemResource;
+        scheduler.clear();
+        playingSystems.clear();
+
+        // the actions triggered by the events can change anything, so this system is a barrier
+        playingSystems.push_back(scheduler.add("events", SystemAccess()
+                .writes(SystemResource::Events)
+                .writes(SystemResource::WorldStructure),
+            [this](){ our::Events::Update(frameDeltaTime); }));
+
+        // moves whole subtrees (and paimon with its ground) so it writes all the transforms
+        playingSystems.push_back(scheduler.add("state", SystemAccess()
+                .writes<our::StateAnimator>()
+                .reads<our::Ground>()
+                .writes(SystemResource::Transforms)
+                .writes(SystemResource::PaimonController)
+                .writes(SystemResource::Materials),
+            [this](){ stateSystem.update(&world, frameDeltaTime); }));
+
+        // registered after the state system (which moves its ancestors) so it can run next to movement, whose entities it never shares.
+        // it also runs while the game is paused
+        scheduler.add("paimon idle", SystemAccess()
+                .reads<our::PaimonIdle>()
+                .writesFor<our::PaimonIdle>(SystemResource::Transforms),
+            [this](){ paimonIdleSystem.update(&world, frameDeltaTime); });
+
+        playingSystems.push_back(scheduler.add("movement", SystemAccess()
+                .reads<our::MovementComponent>()
+                .writesFor<our::MovementComponent>(SystemResource::Transforms),
+            [this](){ movementSystem.update(&world, frameDeltaTime); }));
+
+        playingSystems.push_back(scheduler.add("level mapping", SystemAccess()
+                .reads<our::Ground, our::CameraComponent>()
+                .readsFor<our::Ground>(SystemResource::Transforms)
+                .readsFor<our::CameraComponent>(SystemResource::Transforms)
+                .writes(SystemResource::LevelMapping),
+            [this](){ levelMapping.update(); }));
+
+        playingSystems.push_back(scheduler.add("paimon movement", SystemAccess()
+                .writes<our::Paimon>()
+                .reads<our::Ground, our::CameraComponent, our::OrbitalCameraComponent, our::MeshRendererComponent>()
+                .writesFor<our::Paimon>(SystemResource::Transforms)
+                .readsFor<our::Ground>(SystemResource::Transforms)
+                .readsFor<our::CameraComponent>(SystemResource::Transforms)
+                .reads(SystemResource::LevelMapping)
+                .writes(SystemResource::PaimonController)
+                .writes(SystemResource::Materials)
+                .writes(SystemResource::Events),
+            [this](){ paimonMovement.update(&world, &levelMapping, frameDeltaTime, frameWon); }));
+
+        // the camera follows arbitrary entities by name so it reads all the transforms
+        playingSystems.push_back(scheduler.add("orbital camera", SystemAccess()
+                .writes<our::OrbitalCameraComponent>()
+                .reads<our::CameraComponent>()
+                .reads(SystemResource::Transforms)
+                .writesFor<our::CameraComponent>(SystemResource::Transforms)
+                .writes(SystemResource::Events),
+            [this](){ orbitalCameraControllerSystem.update(&world, frameDeltaTime); }));
+
+        // picking a mora removes it from the world so this system is a barrier too
+        playingSystems.push_back(scheduler.add("collision", SystemAccess()
+                .reads<our::Paimon, our::Mora>()
+                .readsFor<our::Paimon>(SystemResource::Transforms)
+                .readsFor<our::Mora>(SystemResource::Transforms)
+                .writes(SystemResource::Events)
+                .writes(SystemResource::WorldStructure),
+            [this](){ collisionSystem.update(&world, frameGold, frameBlue, frameRed); }));
+    }
+
     void onImmediateGui() override {
         drawHUD();
     }
@@ -473,6 +581,9 @@ class Playstate: public our::State {
         paimonMovement.init(getApp());
         collisionSystem.init(getApp());
         stateSystem.init(&world);
+        // The animators have placed their entities, so everything that will never move can be merged now
+        renderer.buildStaticBatches(&world);
+        initScheduler();
 
 
         auto audio = our::AssetLoader<std::pair<std::string, float>>::get("ost");
@@ -482,13 +593,7 @@ class Playstate: public our::State {
             ost = audioPlayer->playSound(audio->first.c_str(), true, audio->second); // Play a sound with volume 0.5
         }
 
-        for (auto k : world.getEntities()){
-            auto c = k->getComponent<our::OrbitalCameraComponent>();
-            if (c != nullptr){
-                cameraComponent = c;
-                break;
-            }
-        }
+        cameraComponent = world.getSingleton<our::OrbitalCameraComponent>();
     }
 
     void onDraw(double deltaTime) override {
@@ -497,20 +602,45 @@ class Playstate: public our::State {
         if(fade < 1) fade += 0.01f;
         // Here, we just run a bunch of systems to control the world logic
 
-        paimonIdleSystem.update(&world, (float)deltaTime);
-
-
-        if ((gameState == PLAYING || gameState == WON) && !showMenu) { //stop everything if the game is paused or we lost
+        bool playing = (gameState == PLAYING || gameState == WON) && !showMenu; //stop everything if the game is paused or we lost
+        frameDeltaTime = (float) deltaTime;
+        frameGold = frameBlue = frameRed = 0;
+        frameWon = false;
+        // the systems may run on the workers (while this thread submits the last frame when pipelined),
+        // so everything they need from glfw and the input is read here on the main thread
+        levelMapping.setFrameBufferSize(getApp()->getFrameBufferSize());
+        paimonMovement.setInput(getApp()->getMouse().getMousePosition(), getApp()->getMouse().isPressed(GLFW_MOUSE_BUTTON_LEFT));
+        orbitalCameraControllerSystem.setInput(getApp()->getKeyboard().isPressed(GLFW_KEY_Q), getApp()->getKeyboard().isPressed(GLFW_KEY_E));
+        for (auto id : playingSystems)
+            scheduler.setEnabled(id, playing);
+
+        if (renderer.isPipelined()) {
+            // the static batches use OpenGL, so they are updated here before anything else touches the world
+            renderer.updateStaticBatches(&world);
+            // the systems and the preparation of this frame's packet run on the job system
+            // while this thread (which owns the OpenGL context) submits the packet of the last frame
+            auto& jobs = our::JobSystem::getInstance();
+            our::JobCounter simulation;
+            jobs.submit([this](){
+                scheduler.run(&world);
+                transformSystem.update(&world);
+                renderer.prepareFrame(&world);
+            }, &simulation);
+            bool submitted = renderer.submitFrame();
+            jobs.wait(simulation);
+            // the first frame has no packet from a previous frame, so it draws the one it just prepared
+            if (!submitted) renderer.submitFrame();
+        } else {
+            scheduler.run(&world);
+            // Bring the cached transforms up to date before drawing
+            transformSystem.update(&world);
+            // And finally we use the renderer system to draw the scene
+            renderer.render(&world);
+        }
 
-            our::Events::Update((float) deltaTime);
-            int gold = 0, red = 0, blue = 0;
-            bool won = false;
-            stateSystem.update(&world , (float) deltaTime);
-            movementSystem.update(&world, (float)deltaTime);
-            levelMapping.update();
-            paimonMovement.update(&world , &levelMapping, (float) deltaTime , won);
-            orbitalCameraControllerSystem.update(&world , (float) deltaTime);
-            collisionSystem.update(&world , gold , blue , red);
+        if (playing) {
+            int gold = frameGold, red = frameRed, blue = frameBlue;
+            bool won = frameWon;
 
             remainingTime += gold * 10;
             cameraComponent->switches += blue;
@@ -525,11 +655,6 @@ class Playstate: public our::State {
             }
         }
 
-
-
-        // And finally we use the renderer system to draw the scene
-        renderer.render(&world);
-
         // Get a reference to the keyboard object
         auto& keyboard = getApp()->getKeyboard();
 
@@ -537,6 +662,9 @@ class Playstate: public our::State {
             // If the escape  key is pressed in this frame, go to the play state
             showMenu = !showMenu;
         }
+        if(keyboard.justPressed(GLFW_KEY_F3)){
+            showRenderStats = !showRenderStats;
+        }
 
         world.deleteMarkedEntities();
     }
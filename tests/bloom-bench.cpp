@@ -0,0 +1,85 @@
+#include "test-utils.hpp"
+#include "gl-context.hpp"
+
+#include <systems/postprocess-plan.hpp>
+#include <texture/framebuffer.h>
+#include <gl-state-cache.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+namespace our {
+    bool SUPPRESS_SHADER_ERRORS = false; // Normally defined by the game's main.cpp
+}
+
+// The blur chain the levels used before the dual filter bloom: a horizontal and a vertical 19 tap blur of the bright color
+// at the full resolution (each pass writes both attachments), then bloom.frag adds the result to the scene
+static const char* BLUR_CHAIN_CONFIG = R"({
+    "channels": 2,
+    "effects": [
+        { "target": "assets/shaders/postprocess/blur.frag", "params": { "horizontal": true } },
+        { "target": "assets/shaders/postprocess/blur.frag", "params": { "horizontal": false } },
+        { "target": "assets/shaders/postprocess/bloom.frag", "params": {} }
+    ]
+})";
+
+// The bloom the levels use now (see the "postprocess" of the level configs)
+static const char* DUAL_FILTER_CONFIG = R"({
+    "channels": 2,
+    "bloom": { "scale": 0.5, "iterations": 4, "intensity": 1.0 },
+    "effects": []
+})";
+
+// Returns the average milliseconds per frame of running the plan at the given size (glFinish waits for the GPU every frame)
+static double measurePlan(const char* config, glm::ivec2 size, int iterations) {
+    our::PostprocessPlan plan;
+    plan.compile(size, nlohmann::json::parse(config));
+    // The last pass draws to the framebuffer that was bound before the scene, there is no window so it is this one
+    our::Framebuffer output(size);
+    output.addColorTexture(GL_RGBA8);
+    output.bind();
+    glViewport(0, 0, size.x, size.y);
+
+    double milliseconds = our::test::measureMilliseconds(iterations, [&]() {
+        plan.beginScene();
+        glClearColor(0.5f, 0.4f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        plan.execute();
+        glFinish();
+    });
+    output.unbind();
+    // A broken pass would make the timing meaningless, so report it
+    if (GLenum error = glGetError(); error != GL_NO_ERROR) std::fprintf(stderr, "OpenGL error 0x%x while running the plan\n", error);
+    return milliseconds;
+}
+
+// Measures the post-process plan of the dual filter bloom against the old full resolution blur chain at 720p and 4K.
+// Usage: bloom-bench [iterations at 720p] (4K runs a quarter of them, at least 2)
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 20;
+    // The shaders are loaded relative to the root of the repository
+    std::filesystem::current_path(PAIMON_SOURCE_DIR);
+
+    our::test::GLContext context;
+    if (!context.create()) return 1;
+    std::printf("%s | %s\n", (const char*) glGetString(GL_RENDERER), (const char*) glGetString(GL_VERSION));
+
+    struct Resolution { const char* name; glm::ivec2 size; int iterations; };
+    Resolution resolutions[] = {
+            {"720p", {1280, 720}, iterations},
+            {"4K", {3840, 2160}, std::max(iterations / 4, 2)},
+    };
+    double results[2][2];
+    for (int r = 0; r < 2; r++) {
+        results[r][0] = measurePlan(BLUR_CHAIN_CONFIG, resolutions[r].size, resolutions[r].iterations);
+        results[r][1] = measurePlan(DUAL_FILTER_CONFIG, resolutions[r].size, resolutions[r].iterations);
+    }
+    // The frame includes clearing the scene framebuffer, which is the same for both
+    std::printf("%10s %16s %16s %9s\n", "resolution", "blur chain ms", "dual filter ms", "speedup");
+    for (int r = 0; r < 2; r++) {
+        std::printf("%10s %16.2f %16.2f %9.2f\n", resolutions[r].name, results[r][0], results[r][1], results[r][0] / results[r][1]);
+    }
+    return 0;
+}
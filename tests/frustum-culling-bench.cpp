@@ -0,0 +1,54 @@
+#include "test-utils.hpp"
+
+#include <systems/frustum-culler.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Measures FrustumCuller::cull (the SIMD version of this build) against the scalar loop for 1k and 10k boxes,
+// and checks that both give the same result. The boxes are scattered around the camera so roughly a third of them is visible
+int main() {
+#if defined(__AVX__)
+    const char* simd = "AVX";
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    const char* simd = "SSE";
+#else
+    const char* simd = "none (scalar)";
+#endif
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(0.0f, 5.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    our::Frustum frustum = our::Frustum::fromMatrix(projection * view);
+
+    std::printf("SIMD path: %s\n", simd);
+    std::printf("%8s %10s %12s %12s %9s\n", "boxes", "visible", "simd us", "scalar us", "speedup");
+    int mismatches = 0;
+    for (size_t count : {1000, 10000}) {
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> position(-150.0f, 150.0f), size(0.25f, 4.0f);
+        our::FrustumCuller culler;
+        for (size_t i = 0; i < count; i++) {
+            our::AABB box;
+            box.center = {position(random), position(random) * 0.1f, position(random)};
+            box.extent = {size(random), size(random), size(random)};
+            culler.push(box);
+        }
+
+        std::vector<uint8_t> simdVisible, scalarVisible;
+        // Enough iterations for a stable average (the 10k case takes a few microseconds per call)
+        int iterations = count < 5000 ? 20000 : 2000;
+        double simdTime = our::test::measureMilliseconds(iterations, [&]() { culler.cull(frustum, simdVisible); }) * 1000.0;
+        double scalarTime = our::test::measureMilliseconds(iterations, [&]() { culler.cullScalar(frustum, scalarVisible); }) * 1000.0;
+
+        size_t visible = 0;
+        for (size_t i = 0; i < count; i++) {
+            visible += simdVisible[i];
+            if (simdVisible[i] != scalarVisible[i]) mismatches++;
+        }
+        std::printf("%8zu %10zu %12.2f %12.2f %9.2f\n", count, visible, simdTime, scalarTime, scalarTime / simdTime);
+    }
+    if (mismatches != 0) std::fprintf(stderr, "%d boxes differ between the SIMD and the scalar culling\n", mismatches);
+    return mismatches != 0;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstdio>
+
+// Creates an OpenGL 3.3 core context without showing a window, for the tests and the benchmarks that need OpenGL.
+// With PAIMON_TESTS_EGL (set by CMake where EGL is available, e.g. on Linux) it is a surfaceless EGL context
+// so it even works without a display, otherwise it is the context of a hidden GLFW window.
+// The context draws to framebuffer objects only, since there is no window to present to.
+#ifdef PAIMON_TESTS_EGL
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+namespace our::test {
+
+    class GLContext {
+        EGLDisplay display = EGL_NO_DISPLAY;
+        EGLContext context = EGL_NO_CONTEXT;
+    public:
+        // Returns false if no context could be created
+        bool create() {
+            // The surfaceless platform needs no display server. If it is missing, fall back to the default display
+            auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+            if (getPlatformDisplay != nullptr)
+                display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+            if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+                std::fprintf(stderr, "Couldn't initialize EGL\n");
+                return false;
+            }
+            eglBindAPI(EGL_OPENGL_API);
+            const EGLint attributes[] = {
+                    EGL_CONTEXT_MAJOR_VERSION, 3,
+                    EGL_CONTEXT_MINOR_VERSION, 3,
+                    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                    EGL_NONE
+            };
+            context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+            if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+                std::fprintf(stderr, "Couldn't create a surfaceless OpenGL 3.3 context\n");
+                return false;
+            }
+            return gladLoadGL((GLADloadfunc) eglGetProcAddress) != 0;
+        }
+
+        ~GLContext() {
+            if (context != EGL_NO_CONTEXT) {
+                eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+                eglDestroyContext(display, context);
+            }
+            if (display != EGL_NO_DISPLAY) eglTerminate(display);
+        }
+    };
+
+}
+
+#else
+
+#include <GLFW/glfw3.h>
+
+namespace our::test {
+
+    class GLContext {
+        GLFWwindow* window = nullptr;
+    public:
+        // Returns false if no context could be created
+        bool create() {
+            if (!glfwInit()) {
+                std::fprintf(stderr, "Couldn't initialize GLFW\n");
+                return false;
+            }
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+            glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            window = glfwCreateWindow(64, 64, "test", nullptr, nullptr);
+            if (window == nullptr) {
+                std::fprintf(stderr, "Couldn't create a hidden window with an OpenGL 3.3 context\n");
+                return false;
+            }
+            glfwMakeContextCurrent(window);
+            return gladLoadGL(glfwGetProcAddress) != 0;
+        }
+
+        ~GLContext() {
+            if (window != nullptr) glfwDestroyWindow(window);
+            glfwTerminate();
+        }
+    };
+
+}
+
+#endif
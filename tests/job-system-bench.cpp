@@ -0,0 +1,56 @@
+#include "test-utils.hpp"
+
+#include <jobs/job-system.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// Measures how parallelFor scales with the worker count on a balanced and an imbalanced workload.
+// Usage: job-system-bench [max worker count] (defaults to one worker per core except the calling thread)
+int main(int argc, char** argv) {
+    unsigned int cores = std::thread::hardware_concurrency();
+    size_t maxWorkers = argc > 1 ? size_t(std::atoi(argv[1])) : (cores > 1 ? cores - 1 : 1);
+
+    constexpr size_t COUNT = 1 << 20;
+    std::vector<float> values(COUNT);
+    volatile float sink = 0;
+
+    // Every index does the same amount of work
+    auto balanced = [&](our::JobSystem& jobs) {
+        jobs.parallelFor(0, COUNT, 4096, [&](size_t i) {
+            float x = float(i);
+            for (int k = 0; k < 16; k++) x = std::sin(x) * 0.5f + std::cos(x);
+            values[i] = x;
+        });
+        sink = values[COUNT / 2];
+    };
+    // The first eighth of the indices does 16 times more work, so the batches must be stolen to stay balanced
+    auto imbalanced = [&](our::JobSystem& jobs) {
+        jobs.parallelFor(0, COUNT, 4096, [&](size_t i) {
+            float x = float(i);
+            int steps = i < COUNT / 8 ? 128 : 8;
+            for (int k = 0; k < steps; k++) x = std::sin(x) * 0.5f + std::cos(x);
+            values[i] = x;
+        });
+        sink = values[COUNT / 2];
+    };
+
+    std::printf("%u hardware threads, the calling thread helps in addition to the workers\n", cores);
+    std::printf("%8s %14s %9s %14s %9s\n", "workers", "balanced ms", "speedup", "imbalanced ms", "speedup");
+    double balancedBase = 0, imbalancedBase = 0;
+    for (size_t workers = 0; workers <= maxWorkers; workers++) {
+        our::JobSystem jobs(workers);
+        double balancedTime = our::test::measureMilliseconds(5, [&]() { balanced(jobs); });
+        double imbalancedTime = our::test::measureMilliseconds(5, [&]() { imbalanced(jobs); });
+        if (workers == 0) {
+            balancedBase = balancedTime;
+            imbalancedBase = imbalancedTime;
+        }
+        std::printf("%8zu %14.2f %9.2f %14.2f %9.2f\n", workers,
+                    balancedTime, balancedBase / balancedTime, imbalancedTime, imbalancedBase / imbalancedTime);
+    }
+    return 0;
+}
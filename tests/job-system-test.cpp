@@ -0,0 +1,136 @@
+#include "test-utils.hpp"
+
+#include <jobs/job-system.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+// Spins till "done" returns true or the time runs out. Returns false on timeout so a broken job system fails instead of hanging
+template<typename Done>
+static bool spinUntil(Done&& done) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+// Every submitted job runs exactly once and "wait" returns only after all of them are done
+static void testSubmitAndWait(our::JobSystem& jobs) {
+    constexpr int JOB_COUNT = 1000;
+    std::vector<std::atomic<int>> runs(JOB_COUNT);
+    our::JobCounter counter;
+    CHECK(counter.isDone());
+    for (int i = 0; i < JOB_COUNT; i++) {
+        jobs.submit([&runs, i]() { runs[i]++; }, &counter);
+    }
+    jobs.wait(counter);
+    CHECK(counter.isDone());
+    for (auto& run : runs) CHECK(run.load() == 1);
+
+    // Jobs without a counter still run (the calling thread can run them itself)
+    std::atomic<int> uncounted{0};
+    for (int i = 0; i < 10; i++) jobs.submit([&uncounted]() { uncounted++; });
+    while (jobs.runPendingJob()) {}
+    CHECK(spinUntil([&]() { return uncounted.load() == 10; }));
+}
+
+// A parallelFor inside the jobs of another parallelFor (and a wait inside a job) completes without deadlocks
+static void testNestedParallelFor(our::JobSystem& jobs) {
+    constexpr size_t OUTER = 64, INNER = 256;
+    std::vector<int> values(OUTER * INNER, 0);
+    jobs.parallelFor(0, OUTER, 1, [&](size_t i) {
+        jobs.parallelFor(0, INNER, 16, [&](size_t j) { values[i * INNER + j] += int(i + j); });
+    });
+    bool correct = true;
+    for (size_t i = 0; i < OUTER; i++)
+        for (size_t j = 0; j < INNER; j++)
+            correct = correct && values[i * INNER + j] == int(i + j);
+    CHECK(correct);
+
+    std::atomic<int> innerRuns{0};
+    our::JobCounter outer;
+    for (int i = 0; i < 8; i++) {
+        jobs.submit([&]() {
+            our::JobCounter inner;
+            for (int j = 0; j < 8; j++) jobs.submit([&]() { innerRuns++; }, &inner);
+            jobs.wait(inner);
+        }, &outer);
+    }
+    jobs.wait(outer);
+    CHECK(innerRuns.load() == 64);
+}
+
+// The jobs a worker pushes to its own queue are stolen by the other threads when that worker is busy,
+// and an imbalanced parallelFor (a few very long batches) still spreads over several threads
+static void testWorkStealing(our::JobSystem& jobs) {
+    if (jobs.getWorkerCount() == 0) return;
+
+    // The owner pushes jobs to its own queue and then spins without running any of them,
+    // so they can only finish if another worker (or the main thread through "wait") steals them
+    constexpr int STOLEN_COUNT = 32;
+    std::atomic<int> finished{0};
+    std::atomic<bool> ownerRanOne{false};
+    std::atomic<bool> ownerSawAll{false};
+    our::JobCounter counter;
+    jobs.submit([&]() {
+        auto owner = std::this_thread::get_id();
+        for (int i = 0; i < STOLEN_COUNT; i++) {
+            jobs.submit([&, owner]() {
+                if (std::this_thread::get_id() == owner) ownerRanOne = true;
+                finished++;
+            });
+        }
+        ownerSawAll = spinUntil([&]() { return finished.load() == STOLEN_COUNT; });
+    }, &counter);
+    jobs.wait(counter);
+    CHECK(ownerSawAll.load());
+    CHECK(!ownerRanOne.load());
+
+    // Half of the batches sleep, the rest are instant. Every thread that runs a batch records itself
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::vector<int> done(64, 0);
+    jobs.parallelFor(0, done.size(), 1, [&](size_t i) {
+        if (i % 2 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        done[i] = 1;
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+    });
+    bool allDone = true;
+    for (int value : done) allDone = allDone && value == 1;
+    CHECK(allDone);
+    CHECK(threads.size() > 1);
+}
+
+int main() {
+    // The tests use their own job systems so the worker count does not depend on the machine
+    for (size_t workerCount : {0, 1, 3}) {
+        our::JobSystem jobs(workerCount);
+        testSubmitAndWait(jobs);
+        testNestedParallelFor(jobs);
+        testWorkStealing(jobs);
+    }
+    // A worker of one job system submitting to another one must use the other system's shared queue
+    our::JobSystem first(2), second(2);
+    std::atomic<int> crossRuns{0};
+    first.parallelFor(0, 8, 1, [&](size_t) {
+        second.parallelFor(0, 8, 1, [&](size_t) { crossRuns++; });
+    });
+    CHECK(crossRuns.load() == 64);
+
+    // The engine's job system leaves one core to the main thread, so on a single core it has no workers at all
+    unsigned int cores = std::thread::hardware_concurrency();
+    auto& engineJobs = our::JobSystem::getInstance();
+    CHECK(engineJobs.getWorkerCount() == (cores > 1 ? cores - 1 : 0));
+    testSubmitAndWait(engineJobs);
+    testNestedParallelFor(engineJobs);
+
+    if (our::test::failures == 0) std::printf("job system: all checks passed\n");
+    return our::test::failures;
+}
@@ -0,0 +1,153 @@
+#include "test-utils.hpp"
+#include "gl-context.hpp"
+
+#include <asset-loader.hpp>
+#include <ecs/world.hpp>
+#include <components/mesh-renderer.hpp>
+#include <material/material.hpp>
+#include <systems/forward-renderer.hpp>
+#include <systems/state-system.hpp>
+#include <systems/transform-system.hpp>
+#include <jobs/job-system.hpp>
+#include <texture/framebuffer.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace our {
+    bool SUPPRESS_SHADER_ERRORS = true; // Normally defined by the game's main.cpp (the levels set some uniforms their shaders don't use)
+}
+
+// Runs a level with the pipelined renderer like the play state does: every frame, a job runs the logic that changes the world
+// (the state animators and a highlight that changes the material tints every frame, like the paimon movement system does)
+// then prepares the next packet, while this thread submits the previous packet.
+// It checks that the frames are drawn without OpenGL errors and that the last frame is the same as the one the serial renderer
+// draws for the same world. Built with a thread sanitizer, it also checks that submitting never races with the logic.
+// Usage: pipelined-render-test [level config] [frames]
+int main(int argc, char** argv) {
+    std::string levelPath = argc > 1 ? argv[1] : "config/levels/level-0.jsonc";
+    int frames = argc > 2 ? std::atoi(argv[2]) : 30;
+    // The assets are loaded relative to the root of the repository
+    std::filesystem::current_path(PAIMON_SOURCE_DIR);
+
+    our::test::GLContext context;
+    if (!context.create()) return 1;
+
+    std::ifstream file(levelPath);
+    if (!file) {
+        std::fprintf(stderr, "Couldn't open %s\n", levelPath.c_str());
+        return 1;
+    }
+    nlohmann::json config = nlohmann::json::parse(file, nullptr, true, true);
+    if (config.contains("assets")) our::deserializeAllAssets(config["assets"]);
+
+    const glm::ivec2 size = {320, 180};
+    // The renderer draws to the framebuffer bound before it, there is no window so it is this one
+    our::Framebuffer output(size);
+    output.addColorTexture(GL_RGBA8);
+    output.addDepthTexture(GL_DEPTH_COMPONENT24);
+    output.bind();
+
+    // Renders the level with the given renderer mode and returns the pixels of the last frame
+    auto renderLevel = [&](bool pipelined, our::RenderStats& stats) {
+        our::World world;
+        if (config.contains("world")) world.deserialize(config["world"]);
+        our::ForwardRenderer renderer;
+        nlohmann::json rendererConfig = config["renderer"];
+        rendererConfig["pipelined"] = pipelined;
+        renderer.initialize(size, rendererConfig);
+        CHECK(renderer.isPipelined() == pipelined);
+        our::StateSystem stateSystem;
+        our::TransformSystem transformSystem;
+        stateSystem.init(&world);
+        renderer.buildStaticBatches(&world);
+
+        std::vector<our::DefaultMaterial*> materials;
+        for (auto meshRenderer : world.getAllComponents<our::MeshRendererComponent>()) {
+            auto material = dynamic_cast<our::DefaultMaterial*>(meshRenderer->material);
+            if (material && std::find(materials.begin(), materials.end(), material) == materials.end()) materials.push_back(material);
+        }
+        // The logic of a frame: a fixed time step keeps the two modes in step
+        int frame = 0;
+        auto simulate = [&]() {
+            stateSystem.update(&world, 1.0f / 60.0f);
+            // Like the highlight of the paimon movement system, but on every lit material so whatever the camera sees is affected:
+            // the tints are doubled then restored
+            for (auto material : materials) {
+                material->tint = frame % 2 == 0 ? material->tint * 2.0f : material->tint / 2.0f;
+            }
+            frame++;
+        };
+
+        // The engine's job system has no workers on a single core, so the frame job gets a worker of its own
+        // to always run at the same time as the submit (the systems inside it still use the engine's job system)
+        our::JobSystem jobs(1);
+        for (int i = 0; i < frames; i++) {
+            if (pipelined) {
+                renderer.updateStaticBatches(&world);
+                our::JobCounter simulation;
+                jobs.submit([&]() {
+                    simulate();
+                    transformSystem.update(&world);
+                    renderer.prepareFrame(&world);
+                }, &simulation);
+                bool submitted = renderer.submitFrame();
+                // Unlike JobSystem::wait, this doesn't run the job on this thread, so the logic always runs on the worker
+                // at the same time as the submit and the thread sanitizer sees both
+                while (!simulation.isDone()) std::this_thread::yield();
+                if (!submitted) renderer.submitFrame();
+            } else {
+                simulate();
+                transformSystem.update(&world);
+                renderer.render(&world);
+            }
+            if (GLenum error = glGetError(); error != GL_NO_ERROR) {
+                std::fprintf(stderr, "OpenGL error 0x%x in frame %d\n", error, i);
+                our::test::failures++;
+                break;
+            }
+        }
+        // One more frame without any logic: the pipelined renderer updates the static batches before the logic runs,
+        // so a tint changed on a batched object shows one frame later than with the serial renderer. Then both draw the same world
+        if (pipelined) {
+            renderer.updateStaticBatches(&world);
+            renderer.prepareFrame(&world);
+            CHECK(renderer.submitFrame());
+        } else {
+            renderer.render(&world);
+        }
+        stats = renderer.getStats();
+
+        std::vector<uint8_t> pixels(size.x * size.y * 4);
+        glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        renderer.destroy();
+        world.clear();
+        return pixels;
+    };
+
+    our::RenderStats serialStats, pipelinedStats;
+    auto serial = renderLevel(false, serialStats);
+    auto pipelined = renderLevel(true, pipelinedStats);
+    output.unbind();
+    our::clearAllAssets();
+
+    CHECK(pipelinedStats.drawCalls > 0);
+    CHECK(pipelinedStats.drawCalls == serialStats.drawCalls);
+    CHECK(pipelinedStats.commands == serialStats.commands);
+    bool drewSomething = false;
+    for (size_t i = 0; i < pipelined.size(); i++) drewSomething = drewSomething || pipelined[i] != 0;
+    CHECK(drewSomething);
+    // Both modes ran the same logic for the same number of frames, so the last frames must match
+    size_t differentBytes = 0;
+    for (size_t i = 0; i < pipelined.size(); i++) differentBytes += pipelined[i] != serial[i];
+    CHECK(differentBytes == 0);
+
+    std::printf("%s: %d frames, %zu commands, %zu draw calls, %zu bytes differ from the serial renderer\n",
+                levelPath.c_str(), frames, pipelinedStats.commands, pipelinedStats.drawCalls, differentBytes);
+    if (our::test::failures == 0) std::printf("pipelined renderer: all checks passed\n");
+    return our::test::failures;
+}
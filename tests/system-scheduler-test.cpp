@@ -0,0 +1,169 @@
+#include "test-utils.hpp"
+
+#include <ecs/world.hpp>
+#include <systems/system-scheduler.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace our {
+    bool SUPPRESS_SHADER_ERRORS = false; // Normally defined by the game's main.cpp (globals.h declares it)
+}
+
+// Two components that only mark the entities of the scopes
+struct ScopeA : our::Component {
+    static std::string getID() { return "Scope A"; }
+    void deserialize(const nlohmann::json&) override {}
+};
+struct ScopeB : our::Component {
+    static std::string getID() { return "Scope B"; }
+    void deserialize(const nlohmann::json&) override {}
+};
+
+using our::SystemAccess;
+using our::SystemResource;
+
+static bool conflict(our::World& world, const SystemAccess& first, const SystemAccess& second) {
+    our::ScopeOverlaps overlaps(&world);
+    return first.conflictsWith(second, overlaps);
+}
+
+// Scoped accesses conflict exactly when their entities share an entity or a branch of the hierarchy
+static void testScopes() {
+    our::World world;
+    our::Entity* a = world.add();
+    our::Entity* b = world.add();
+    a->addComponent<ScopeA>();
+    b->addComponent<ScopeB>();
+    auto writesA = SystemAccess().writesFor<ScopeA>(SystemResource::Transforms);
+    auto writesB = SystemAccess().writesFor<ScopeB>(SystemResource::Transforms);
+    auto readsB = SystemAccess().readsFor<ScopeB>(SystemResource::Transforms);
+
+    // Separate entities
+    CHECK(!conflict(world, writesA, writesB));
+    CHECK(!conflict(world, writesA, readsB));
+    CHECK(!conflict(world, readsB, readsB));
+    // The same scope, or all the entities, always conflict
+    CHECK(conflict(world, writesA, writesA));
+    CHECK(conflict(world, writesA, SystemAccess().reads(SystemResource::Transforms)));
+    CHECK(conflict(world, SystemAccess().writes(SystemResource::Transforms), readsB));
+    // Other resources don't conflict
+    CHECK(!conflict(world, writesA, SystemAccess().writes(SystemResource::Materials)));
+
+    // An entity in both scopes
+    b->addComponent<ScopeA>();
+    CHECK(conflict(world, writesA, readsB));
+    b->deleteComponent<ScopeA>();
+    CHECK(!conflict(world, writesA, readsB));
+
+    // A descendant (even a grand child) or an ancestor of the other scope
+    our::Entity* middle = world.add();
+    middle->setParent(a);
+    b->setParent(middle);
+    CHECK(conflict(world, writesA, readsB));
+    CHECK(conflict(world, writesB, SystemAccess().readsFor<ScopeA>(SystemResource::Transforms)));
+    b->setParent(nullptr);
+    a->setParent(b);
+    CHECK(conflict(world, writesA, readsB));
+    a->setParent(nullptr);
+    CHECK(!conflict(world, writesA, readsB));
+
+    // Writing the world structure conflicts with everything
+    CHECK(conflict(world, SystemAccess().writes(SystemResource::WorldStructure), SystemAccess()));
+}
+
+// Records how many systems run at the same time
+struct Activity {
+    std::atomic<int> active{0}, maxActive{0};
+    std::mutex mutex;
+    std::vector<int> order;
+
+    void run(int id, std::chrono::milliseconds duration) {
+        int now = ++active;
+        int seen = maxActive.load();
+        while (now > seen && !maxActive.compare_exchange_weak(seen, now)) {}
+        std::this_thread::sleep_for(duration);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(id);
+        }
+        active--;
+    }
+};
+
+static void testScheduler() {
+    our::JobSystem jobs(2);
+    our::World world;
+    our::Entity* a = world.add();
+    our::Entity* b = world.add();
+    a->addComponent<ScopeA>();
+    b->addComponent<ScopeB>();
+
+    // Disjoint scopes run at the same time: each system waits for the other one to start
+    {
+        our::SystemScheduler scheduler(jobs);
+        std::atomic<int> started{0};
+        std::atomic<bool> overlapped{true};
+        auto meet = [&]() {
+            started++;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (started.load() < 2) {
+                if (std::chrono::steady_clock::now() > deadline) { overlapped = false; return; }
+                std::this_thread::yield();
+            }
+        };
+        scheduler.add("a", SystemAccess().writesFor<ScopeA>(SystemResource::Transforms), meet);
+        scheduler.add("b", SystemAccess().writesFor<ScopeB>(SystemResource::Transforms), meet);
+        scheduler.run(&world);
+        CHECK(overlapped.load());
+    }
+
+    // A barrier that puts an entity in both scopes makes the systems after it conflict in the same run,
+    // and the conflicting systems run in the order they were added
+    {
+        our::SystemScheduler scheduler(jobs);
+        Activity activity;
+        scheduler.add("structure", SystemAccess().writes(SystemResource::WorldStructure), [&]() { b->addComponent<ScopeA>(); });
+        scheduler.add("a", SystemAccess().writesFor<ScopeA>(SystemResource::Transforms),
+                      [&]() { activity.run(1, std::chrono::milliseconds(20)); });
+        scheduler.add("b", SystemAccess().readsFor<ScopeB>(SystemResource::Transforms),
+                      [&]() { activity.run(2, std::chrono::milliseconds(20)); });
+        scheduler.run(&world);
+        CHECK(activity.maxActive.load() == 1);
+        CHECK((activity.order == std::vector<int>{1, 2}));
+        b->deleteComponent<ScopeA>();
+    }
+
+    // A chain of conflicting systems runs on the calling thread without going through the job system
+    {
+        our::SystemScheduler scheduler(jobs);
+        std::vector<std::thread::id> threads;
+        for (int i = 0; i < 3; i++) {
+            scheduler.add("chain", SystemAccess().writes(SystemResource::Transforms), [&]() { threads.push_back(std::this_thread::get_id()); });
+        }
+        scheduler.run(&world);
+        CHECK(threads.size() == 3);
+        for (auto thread : threads) CHECK(thread == std::this_thread::get_id());
+    }
+
+    // Disabled systems are skipped, also when they are barriers
+    {
+        our::SystemScheduler scheduler(jobs);
+        int runs = 0;
+        auto barrier = scheduler.add("structure", SystemAccess().writes(SystemResource::WorldStructure), [&]() { runs += 10; });
+        scheduler.add("a", SystemAccess().writesFor<ScopeA>(SystemResource::Transforms), [&]() { runs++; });
+        scheduler.setEnabled(barrier, false);
+        scheduler.run(&world);
+        CHECK(runs == 1);
+    }
+}
+
+int main() {
+    testScopes();
+    testScheduler();
+    if (our::test::failures == 0) std::printf("system scheduler: all checks passed\n");
+    return our::test::failures;
+}
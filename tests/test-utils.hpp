@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+// A minimal check macro for the tests: it prints the failed condition with its location and counts the failure,
+// so a test runs all of its checks and returns the failure count from main (ctest treats non zero as a failure)
+namespace our::test {
+    inline int failures = 0;
+}
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            our::test::failures++; \
+        } \
+    } while (false)
+
+namespace our::test {
+
+    // Returns the time in milliseconds that "function" takes on average over "iterations" calls (after one warm up call)
+    template<typename Function>
+    double measureMilliseconds(int iterations, Function&& function) {
+        function();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) function();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+    }
+
+}
@@ -0,0 +1,120 @@
+#include "test-utils.hpp"
+
+#include <ecs/transform.hpp>
+#include <ecs/transform-batch.hpp>
+
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Returns true if the matrix from the batch matches Transform::toMat4.
+// The rotation columns are compared relative to the scale. A NaN angle must give a NaN matrix, but not necessarily
+// in the same elements: toMat4 multiplies whole matrices so the NaN spreads to every element (even the translation),
+// while the batch writes the translation and the constants directly. So only the elements that are numbers in both are compared
+static bool matches(const glm::mat4& batched, const glm::mat4& expected, const our::Transform& transform) {
+    bool batchedNaN = false, expectedNaN = false;
+    for (int column = 0; column < 4; column++) {
+        float scale = column < 3 ? std::abs(transform.scale[column]) : 1.0f;
+        for (int row = 0; row < 4; row++) {
+            float a = batched[column][row], b = expected[column][row];
+            batchedNaN = batchedNaN || std::isnan(a);
+            expectedNaN = expectedNaN || std::isnan(b);
+            if (std::isnan(a) || std::isnan(b)) continue;
+            float tolerance = column < 3 ? 2e-6f * (1.0f + scale) : 1e-5f * (1.0f + std::abs(b));
+            if (std::abs(a - b) > tolerance) return false;
+        }
+    }
+    return batchedNaN == expectedNaN;
+}
+
+// Computes the batch and compares every matrix with Transform::toMat4. Returns the number of mismatches
+static int compare(const std::vector<our::Transform>& transforms, const char* label) {
+    our::TransformBatch batch;
+    batch.reserve(transforms.size());
+    for (auto& transform : transforms) batch.push(transform);
+    std::vector<glm::mat4> matrices(transforms.size());
+    batch.computeMatrices(0, transforms.size(), matrices.data());
+
+    int mismatches = 0;
+    for (size_t i = 0; i < transforms.size(); i++) {
+        if (!matches(matrices[i], transforms[i].toMat4(), transforms[i])) {
+            if (mismatches == 0) {
+                auto& t = transforms[i];
+                std::fprintf(stderr, "%s: mismatch at %zu (rotation %g %g %g)\n", label, i, t.rotation.x, t.rotation.y, t.rotation.z);
+            }
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+int main() {
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> scale(0.05f, 10.0f);
+    std::uniform_real_distribution<float> angle(-2.0f * glm::pi<float>(), 2.0f * glm::pi<float>());
+    // Still inside the range of the SIMD sine but far from zero, where the range reduction matters
+    std::uniform_real_distribution<float> wideAngle(-8000.0f, 8000.0f);
+    // Outside of the SIMD range, so these go through the scalar fallback
+    std::uniform_real_distribution<float> hugeAngle(1e4f, 1e7f);
+
+    auto randomTransform = [&](std::uniform_real_distribution<float>& angles) {
+        our::Transform transform;
+        transform.position = {position(random), position(random), position(random)};
+        transform.rotation = {angles(random), angles(random), angles(random)};
+        transform.scale = {scale(random), scale(random), scale(random)};
+        if (random() % 8 == 0) transform.scale.x = -transform.scale.x; // Mirrored objects
+        return transform;
+    };
+
+    // An odd count so the scalar tail after the groups of 4 is covered too
+    std::vector<our::Transform> small, wide, mixed, halves;
+    for (int i = 0; i < 10001; i++) small.push_back(randomTransform(angle));
+    for (int i = 0; i < 10001; i++) wide.push_back(randomTransform(wideAngle));
+    // Every group of 4 gets one huge angle, so every group falls back to the scalar formula
+    for (int i = 0; i < 4000; i++) {
+        auto transform = randomTransform(angle);
+        if (i % 4 == 1) transform.rotation[random() % 3] = hugeAngle(random) * (random() % 2 ? 1.0f : -1.0f);
+        mixed.push_back(transform);
+    }
+    // Only the upper half of every group of 8 gets a huge angle, so with AVX the lower half still uses the 4 wide version
+    for (int i = 0; i < 4000; i++) {
+        auto transform = randomTransform(angle);
+        if (i % 8 == 5) transform.rotation[random() % 3] = hugeAngle(random);
+        halves.push_back(transform);
+    }
+    CHECK(compare(small, "small angles") == 0);
+    CHECK(compare(wide, "wide angles") == 0);
+    CHECK(compare(mixed, "huge angles") == 0);
+    CHECK(compare(halves, "huge angles in half of the groups") == 0);
+
+    // NaN and infinite angles must not be hidden by the SIMD path (they fail the range check and use the scalar formula)
+    std::vector<our::Transform> special;
+    const float nan = std::numeric_limits<float>::quiet_NaN(), infinity = std::numeric_limits<float>::infinity();
+    for (float value : {nan, infinity, -infinity}) {
+        for (int axis = 0; axis < 3; axis++) {
+            for (int lane = 0; lane < 4; lane++) {
+                auto transform = randomTransform(angle);
+                if (lane == axis % 4) transform.rotation[axis] = value;
+                special.push_back(transform);
+            }
+        }
+    }
+    CHECK(compare(special, "nan and infinity") == 0);
+
+    // A range that does not start at 0 writes only its own matrices
+    our::TransformBatch batch;
+    for (int i = 0; i < 7; i++) batch.push(small[i]);
+    std::vector<glm::mat4> matrices(7, glm::mat4(0.0f));
+    batch.computeMatrices(2, 6, matrices.data());
+    CHECK(matrices[0] == glm::mat4(0.0f) && matrices[1] == glm::mat4(0.0f) && matrices[6] == glm::mat4(0.0f));
+    bool rangeMatches = true;
+    for (int i = 2; i < 6; i++) rangeMatches = rangeMatches && matches(matrices[i], small[i].toMat4(), small[i]);
+    CHECK(rangeMatches);
+
+    if (our::test::failures == 0) std::printf("transform batch: all checks passed\n");
+    return our::test::failures;
+}
@@ -0,0 +1,125 @@
+#include "test-utils.hpp"
+
+#include <systems/transparent-sorter.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace our {
+    bool SUPPRESS_SHADER_ERRORS = false; // Normally defined by the game's main.cpp (globals.h declares it)
+}
+
+struct Camera {
+    glm::vec3 center, forward;
+};
+
+// The sort the renderer used before the transparent sorter: std::sort with two dot products per comparison
+static void sortWithComparator(std::vector<our::RenderCommand>& commands, const Camera& camera) {
+    std::sort(commands.begin(), commands.end(), [&camera](const our::RenderCommand& first, const our::RenderCommand& second) {
+        return glm::dot(second.center - camera.center, camera.forward) < glm::dot(first.center - camera.center, camera.forward);
+    });
+}
+
+// Returns the view depth of every command in their order. Two orders are the same if their depths are,
+// which ignores how each sort orders commands at exactly the same depth
+static std::vector<float> getDepths(const std::vector<our::RenderCommand>& commands, const Camera& camera) {
+    std::vector<float> depths;
+    for (auto& command : commands) depths.push_back(glm::dot(command.center - camera.center, camera.forward));
+    return depths;
+}
+
+// Measures the sorts of the transparent commands at 1k and 10k commands scattered around the camera:
+// - the old std::sort with a comparator that computes the depths on every comparison,
+// - the full radix sort of the depth keys (the first frame, or when the commands changed),
+// - the insertion sort fix up of the last order after a small camera move (a step and a turn of 0.1 degree between two frames,
+//   the turn is what reorders the commands: at 10k commands, 0.2 degree already needs more than MAX_FIXUP_SHIFTS moves per command),
+// - the fix up that gives up since the camera turned around, then falls back to the radix sort.
+// Every path starts from a fresh copy of the commands in their gathered order (the renderer gathers them every frame),
+// so the time of that copy is included in all of them and printed on its own too.
+// It checks that every path gives the same back to front order as std::sort and that each path took the expected branch.
+int main() {
+    Camera camera{{0.0f, 5.0f, 0.0f}, {0.0f, 0.0f, -1.0f}};
+    glm::vec3 turned = glm::vec3(glm::rotate(glm::mat4(1.0f), glm::radians(0.1f), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(camera.forward, 0.0f));
+    Camera moved{camera.center + glm::vec3(0.05f, 0.0f, -0.1f), turned};
+    Camera turnedAround{camera.center, -camera.forward};
+
+    std::printf("%8s %10s %12s %12s %12s %12s\n", "commands", "copy us", "std::sort us", "radix us", "fix up us", "fallback us");
+    int failures = 0;
+    for (size_t count : {1000, 10000}) {
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> position(-150.0f, 150.0f);
+        std::vector<our::RenderCommand> gathered(count);
+        for (size_t i = 0; i < count; i++) {
+            auto& command = gathered[i];
+            command.center = {position(random), position(random) * 0.1f, position(random)};
+            // The sorter recognizes the commands of the last frame by their mesh, material and shape
+            command.mesh = nullptr;
+            command.material = nullptr;
+            command.shapeID = (int) i;
+        }
+        int iterations = count < 5000 ? 500 : 50;
+        std::vector<our::RenderCommand> commands;
+        our::TransparentSorter sorter;
+
+        double copyTime = our::test::measureMilliseconds(iterations, [&]() { commands = gathered; }) * 1000.0;
+        double comparatorTime = our::test::measureMilliseconds(iterations, [&]() {
+            commands = gathered;
+            sortWithComparator(commands, camera);
+        }) * 1000.0;
+        auto expected = getDepths(commands, camera);
+
+        // Forgetting the last order makes every sort a full radix sort
+        size_t reused = 0;
+        double radixTime = our::test::measureMilliseconds(iterations, [&]() {
+            commands = gathered;
+            sorter.clear();
+            reused += sorter.sort(commands, camera.center, camera.forward);
+        }) * 1000.0;
+        failures += reused != 0;
+        failures += getDepths(commands, camera) != expected;
+
+        // Alternating between two close cameras: every sort fixes the order of the other camera
+        const Camera* closeCameras[2] = {&camera, &moved};
+        size_t frame = 0;
+        reused = 0;
+        sorter.clear();
+        commands = gathered;
+        sorter.sort(commands, moved.center, moved.forward);
+        double fixupTime = our::test::measureMilliseconds(iterations, [&]() {
+            const Camera& current = *closeCameras[frame++ % 2];
+            commands = gathered;
+            reused += sorter.sort(commands, current.center, current.forward);
+        }) * 1000.0;
+        failures += reused != (size_t) iterations + 1;
+        commands = gathered;
+        sorter.sort(commands, moved.center, moved.forward);
+        commands = gathered;
+        failures += !sorter.sort(commands, camera.center, camera.forward);
+        failures += getDepths(commands, camera) != expected;
+
+        // Alternating between opposite cameras: the last order is reversed, so the fix up gives up every time
+        // (the last sort was for "camera", so it starts with the other one)
+        const Camera* farCameras[2] = {&camera, &turnedAround};
+        frame = 1;
+        reused = 0;
+        double fallbackTime = our::test::measureMilliseconds(iterations, [&]() {
+            const Camera& current = *farCameras[frame++ % 2];
+            commands = gathered;
+            reused += sorter.sort(commands, current.center, current.forward);
+        }) * 1000.0;
+        failures += reused != 0;
+        commands = gathered;
+        sorter.sort(commands, turnedAround.center, turnedAround.forward);
+        commands = gathered;
+        failures += sorter.sort(commands, camera.center, camera.forward);
+        failures += getDepths(commands, camera) != expected;
+
+        std::printf("%8zu %10.2f %12.2f %12.2f %12.2f %12.2f\n", count, copyTime, comparatorTime, radixTime, fixupTime, fallbackTime);
+    }
+    if (failures != 0) std::fprintf(stderr, "%d checks failed: a path gave another order or took an unexpected branch\n", failures);
+    return failures != 0;
+}